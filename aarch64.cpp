@@ -1,12 +1,151 @@
 #include "sys-features.h"
 #include "memory-bandwidth.h"
+#include "simd-kernels.h"
 
 #ifdef AARCH64
 
+#include <arm_neon.h>
+
 namespace smbm {
 load_func_t get_architecture_load_func(GlobalState *g) {
     return gccvec128_load_test;
 }
+
+namespace {
+
+/* tbl indices for 4 lanes of 32bit. out of range indices give 0 */
+struct NEONShuffleLUT {
+    uint8x16_t compress[16], expand[16];
+    int count[16];
+
+    static uint8x16_t to_bytes(int const *lane) {
+        uint8_t b[16];
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 4; k++) {
+                b[j * 4 + k] = (lane[j] < 0) ? 0xff : lane[j] * 4 + k;
+            }
+        }
+        return vld1q_u8(b);
+    }
+
+    NEONShuffleLUT() {
+        int lane[4];
+        for (unsigned m = 0; m < 16; m++) {
+            count[m] = simd_compress_lanes(m, 4, lane);
+            compress[m] = to_bytes(lane);
+            simd_expand_lanes(m, 4, lane);
+            expand[m] = to_bytes(lane);
+        }
+    }
+};
+
+NEONShuffleLUT const &neon_shuffle_lut() {
+    static NEONShuffleLUT lut;
+    return lut;
+}
+
+inline unsigned select_mask_neon(uint32x4_t v) {
+    static const int32_t shift[4] = {0, 1, 2, 3};
+    uint32x4_t bit = vandq_u32(v, vdupq_n_u32(1));
+    return vaddvq_u32(vshlq_u32(bit, vld1q_s32(shift)));
+}
+
+uint64_t dot_neon(SimdKernelArg const *a) {
+    float32x4_t s0 = vdupq_n_f32(0), s1 = s0, s2 = s0, s3 = s0;
+    float const *fa = a->fa, *fb = a->fb;
+
+    for (size_t i = 0; i < a->n; i += 16) {
+        s0 = vfmaq_f32(s0, vld1q_f32(fa + i + 0), vld1q_f32(fb + i + 0));
+        s1 = vfmaq_f32(s1, vld1q_f32(fa + i + 4), vld1q_f32(fb + i + 4));
+        s2 = vfmaq_f32(s2, vld1q_f32(fa + i + 8), vld1q_f32(fb + i + 8));
+        s3 = vfmaq_f32(s3, vld1q_f32(fa + i + 12), vld1q_f32(fb + i + 12));
+    }
+
+    float32x4_t s = vaddq_f32(vaddq_f32(s0, s1), vaddq_f32(s2, s3));
+    return (uint64_t)vaddvq_f32(s);
+}
+
+uint64_t permute_neon(SimdKernelArg const *a) {
+    for (size_t i = 0; i < a->n; i += 4) {
+        uint32x4_t r = vrev64q_u32(vld1q_u32(a->ia + i));
+        vst1q_u32(a->ib + i, vextq_u32(r, r, 2));
+    }
+    return a->ib[0];
+}
+
+uint64_t compress_neon(SimdKernelArg const *a) {
+    auto const &lut = neon_shuffle_lut();
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 4) {
+        uint32x4_t v = vld1q_u32(a->ia + i);
+        unsigned m = select_mask_neon(v);
+        uint8x16_t r = vqtbl1q_u8(vreinterpretq_u8_u32(v), lut.compress[m]);
+        vst1q_u32(a->ib + k, vreinterpretq_u32_u8(r));
+        k += lut.count[m];
+    }
+    return k;
+}
+
+uint64_t expand_neon(SimdKernelArg const *a) {
+    auto const &lut = neon_shuffle_lut();
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 4) {
+        unsigned m = select_mask_neon(vld1q_u32(a->ia + i));
+        uint8x16_t v = vreinterpretq_u8_u32(vld1q_u32(a->ia + k));
+        vst1q_u32(a->ib + i,
+                  vreinterpretq_u32_u8(vqtbl1q_u8(v, lut.expand[m])));
+        k += lut.count[m];
+    }
+    return k;
+}
+
+/* cnt per byte, 4 vectors are summed in bytes before widening */
+uint64_t popcount_neon(SimdKernelArg const *a) {
+    uint8_t const *src = (uint8_t const *)a->words;
+    uint64x2_t acc = vdupq_n_u64(0);
+
+    for (size_t i = 0; i < a->n * 4; i += 64) {
+        uint8x16_t c0 = vcntq_u8(vld1q_u8(src + i + 0));
+        uint8x16_t c1 = vcntq_u8(vld1q_u8(src + i + 16));
+        uint8x16_t c2 = vcntq_u8(vld1q_u8(src + i + 32));
+        uint8x16_t c3 = vcntq_u8(vld1q_u8(src + i + 48));
+        uint8x16_t c = vaddq_u8(vaddq_u8(c0, c1), vaddq_u8(c2, c3));
+        acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(c)));
+    }
+
+    return vaddvq_u64(acc);
+}
+
+/* ext with zero shifts the vector up by 1 and 2 lanes */
+uint64_t prefix_sum_neon(SimdKernelArg const *a) {
+    uint32x4_t zero = vdupq_n_u32(0);
+    uint32x4_t carry = zero;
+
+    for (size_t i = 0; i < a->n; i += 4) {
+        uint32x4_t x = vld1q_u32(a->ia + i);
+        x = vaddq_u32(x, vextq_u32(zero, x, 3));
+        x = vaddq_u32(x, vextq_u32(zero, x, 2));
+        x = vaddq_u32(x, carry);
+        vst1q_u32(a->ib + i, x);
+        carry = vdupq_laneq_u32(x, 3);
+    }
+    return a->ib[a->n - 1];
+}
+
+} // namespace
+
+/* no gather/scatter in NEON */
+void simd_kernels_neon(simd_kernel_t *tbl) {
+    tbl[SK_DOT] = dot_neon;
+    tbl[SK_PERMUTE] = permute_neon;
+    tbl[SK_COMPRESS] = compress_neon;
+    tbl[SK_EXPAND] = expand_neon;
+    tbl[SK_POPCOUNT] = popcount_neon;
+    tbl[SK_PREFIX_SUM] = prefix_sum_neon;
+}
+
 }
 
 #endif
@@ -8,6 +8,9 @@
 #include "thread.h"
 #include "x86funcs.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+
 namespace smbm {
 
 namespace {
@@ -23,41 +26,76 @@ struct ThreadInfo {
 
     GlobalState const *g;
     int tid;
+    int order;
     atomic_int_t *start_barrier;
     int total_thread_num;
     double delay;
+    int nsample;
 
-    /* result */
-    double realtime_sec;
-    uint64_t cycle_delta;
+    /* result, cycle/sec of this thread for each sample of delay sec.
+     * empty when the thread could not open its cycle counter */
+    std::vector<double> freq;
 };
 
+/* available() of both benches: the main thread has a counter, and so can a
+ * busy thread */
+static bool thread_cpucycle_available(GlobalState const *g) {
+    if (!g->is_hw_perf_counter_available()) {
+        return false;
+    }
+    int fd = g->open_thread_cpucycle();
+    if (fd == -1) {
+        return false;
+    }
+    g->close_thread_cpucycle(fd);
+    return true;
+}
+
 static void *thread_func(void *ap) {
     ThreadInfo *ti = (ThreadInfo *)ap;
 
-    ProcessorIndex idx = ti->g->proc_table->logical_index_to_processor(
-        ti->tid, PROC_ORDER_OUTER_TO_INNER);
+    ProcessorIndex idx =
+        ti->g->proc_table->logical_index_to_processor(ti->tid, ti->order);
     bind_self_to_1proc(ti->g->proc_table, idx, true);
 
-    perf_counter_value_t pt0 = 0, pt1;
+    /* the counter of GlobalState belongs to the main thread, each thread
+     * opens its own */
+    int fd = ti->g->open_thread_cpucycle();
     oneshot_timer ot(128);
 
     uint64_t zero = ti->g->getzero();
+    uint64_t x = 0;
+
+    ti->freq.clear();
+    if (fd == -1) {
+        /* still run the load, the other threads see the same machine */
+        fprintf(stderr, "actual-freq: no cycle counter on thread %d, "
+                        "not recorded\n",
+                ti->tid);
+    } else {
+        ti->freq.assign(ti->nsample, 0);
+    }
 
     wait_barrier(ti->start_barrier, ti->total_thread_num);
-    ot.start(ti->g, ti->delay);
 
-    if (ti->tid == 0) {
-        pt0 = ti->g->get_hw_cpucycle();
-    }
+    for (int si = 0; si < ti->nsample; si++) {
+        ot.start(ti->g, ti->delay);
 
-    uint64_t x = ti->func(zero, &ot);
+        perf_counter_value_t pt0 = 0, pt1 = 0;
+        if (fd != -1) {
+            pt0 = ti->g->read_thread_cpucycle(fd);
+        }
 
-    if (ti->tid == 0) {
-        pt1 = ti->g->get_hw_cpucycle();
+        x += ti->func(zero, &ot);
 
-        ti->cycle_delta = pt1 - pt0;
-        ti->realtime_sec = ot.actual_interval_sec(ti->g);
+        if (fd != -1) {
+            pt1 = ti->g->read_thread_cpucycle(fd);
+            ti->freq[si] = (pt1 - pt0) / ot.actual_interval_sec(ti->g);
+        }
+    }
+
+    if (fd != -1) {
+        ti->g->close_thread_cpucycle(fd);
     }
 
     ti->g->dummy_write(ti->tid, x);
@@ -97,12 +135,11 @@ static uint64_t fmul64x2(uint64_t zero, oneshot_timer *ot) {
     return ret[0] + ret[1];
 }
 
-static double run1(ThreadInfo *ti, int nthread,
-                   uint64_t (*func)(uint64_t zero, oneshot_timer *ot)) {
+/* ti[i].func are set by the caller */
+static void run_threads(ThreadInfo *ti, int nthread) {
     (*ti[0].start_barrier) = 0;
 
     for (int i = 0; i < nthread; i++) {
-        ti[i].func = func;
         ti[i].total_thread_num = nthread;
 
         if (i != 0) {
@@ -115,13 +152,34 @@ static double run1(ThreadInfo *ti, int nthread,
     for (int i = 1; i < nthread; i++) {
         wait_thread(ti[i].thread);
     }
+}
+
+/* mean of the per thread frequency, over the threads with a counter */
+static double run1(ThreadInfo *ti, int nthread,
+                   uint64_t (*func)(uint64_t zero, oneshot_timer *ot)) {
+    for (int i = 0; i < nthread; i++) {
+        ti[i].func = func;
+        ti[i].nsample = 1;
+        ti[i].order = PROC_ORDER_OUTER_TO_INNER;
+    }
+
+    run_threads(ti, nthread);
 
-    double real_sec = ti[0].realtime_sec;
-    uint64_t cycle = ti[0].cycle_delta;
+    double sum = 0;
+    int ncounted = 0;
+    for (int i = 0; i < nthread; i++) {
+        if (!ti[i].freq.empty()) {
+            sum += ti[i].freq[0];
+            ncounted++;
+        }
+    }
 
-    double real_freq = cycle / real_sec;
+    if (ncounted == 0) {
+        fprintf(stderr, "actual-freq: no thread has a cycle counter\n");
+        abort();
+    }
 
-    return real_freq;
+    return sum / ncounted;
 }
 
 static constexpr bool T() { return true; }
@@ -157,7 +215,10 @@ static constexpr bool T() { return true; }
 typedef Table2DBenchDesc<double, std::string, uint32_t> parent_t;
 
 struct ActualFreq : public parent_t {
-    ActualFreq() : parent_t("actual-freq", HIGHER_IS_BETTER) {}
+    ActualFreq() : parent_t("actual-freq", HIGHER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_THREADING};
+        add_param("threads", 0, "max number of busy threads (0 = all)");
+    }
 
     result_t run(GlobalState const *g) override {
 #ifdef HAVE_HW_PERF_COUNTER
@@ -166,7 +227,10 @@ struct ActualFreq : public parent_t {
         std::vector<double> delays = {0.01, 0.1, 0.2, 0.4};
 
         int max_thread = g->proc_table->get_active_cpu_count();
-        int use_thread = max_thread - 1;
+        if (param("threads") > 0) {
+            max_thread = std::min(max_thread, (int)param("threads") + 1);
+        }
+        int use_thread = std::max(1, max_thread - 1);
 
         for (int i = 1; i < max_thread; i *= 2) {
             threads.push_back(i);
@@ -198,6 +262,7 @@ struct ActualFreq : public parent_t {
             thread_info_list[i].tid = i;
             thread_info_list[i].start_barrier = &start_barrier;
             thread_info_list[i].delay = 0.25;
+            thread_info_list[i].nsample = 1;
         }
 
         for (int ti = 0; ti < (int)threads.size(); ti++) {
@@ -232,7 +297,144 @@ struct ActualFreq : public parent_t {
 
     bool available(const GlobalState *g) override {
 #ifdef HAVE_HW_PERF_COUNTER
-        return g->is_hw_perf_counter_available();
+        return thread_cpucycle_available(g);
+#else
+        return false;
+#endif
+    }
+};
+
+/* Frequency of each busy core over a long window.
+ *
+ * Busy threads are placed in both PROC_ORDER directions, with scalar only,
+ * vector only (the widest FMA available) and mixed (even threads vector,
+ * odd threads scalar) loads. Every thread samples its own cycle counter
+ * each "interval" sec for "duration" sec, so turbo decay and thermal
+ * throttling show up along the columns. */
+struct ActualFreqTimeline
+    : public Table2DBenchDesc<double, std::string, double> {
+    typedef Table2DBenchDesc<double, std::string, double> timeline_parent_t;
+
+    ActualFreqTimeline()
+        : timeline_parent_t("actual-freq-timeline", HIGHER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_THREADING};
+        add_param("threads", 0, "max number of busy threads (0 = all)");
+        add_param("duration", 2, "length of one run [sec]");
+        add_param("interval", 0.1, "sampling interval [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+#ifdef HAVE_HW_PERF_COUNTER
+        typedef uint64_t (*func_t)(uint64_t zero, oneshot_timer *ot);
+
+        func_t scalar = fadd64;
+        func_t vector = fadd64x2;
+        const char *vector_name = "fadd64x2";
+
+#ifdef X86
+        if (have_avx512f()) {
+            vector = busy_fma64x8;
+            vector_name = "fma64x8";
+        } else if (have_fma()) {
+            vector = busy_fma64x4;
+            vector_name = "fma64x4";
+        }
+#endif
+
+        int max_thread = g->proc_table->get_active_cpu_count();
+        if (param("threads") > 0) {
+            max_thread = std::min(max_thread, (int)param("threads") + 1);
+        }
+        int use_thread = std::max(1, max_thread - 1);
+
+        std::vector<int> threads = {1};
+        if (use_thread / 2 > 1) {
+            threads.push_back(use_thread / 2);
+        }
+        if (use_thread > 1) {
+            threads.push_back(use_thread);
+        }
+
+        double interval = param("interval");
+        int nsample = std::max(1, (int)(param("duration") / interval));
+
+        enum { MIX_SCALAR, MIX_VECTOR, MIX_MIXED, NUM_MIX };
+        const char *order_name[] = {"outer", "inner"};
+
+        /* threads without a counter have no row */
+        std::vector<std::string> row_label;
+        std::vector<std::vector<double>> row_freq;
+
+        atomic_int_t start_barrier;
+        std::vector<ThreadInfo> ti(use_thread);
+
+        for (int mix = 0; mix < NUM_MIX; mix++) {
+            for (int order = 0; order < NPROC_ORDER; order++) {
+                for (int tc : threads) {
+                    for (int i = 0; i < tc; i++) {
+                        bool vec = (mix == MIX_VECTOR) ||
+                                   (mix == MIX_MIXED && (i & 1) == 0);
+
+                        ti[i].g = g;
+                        ti[i].tid = i;
+                        ti[i].order = order;
+                        ti[i].start_barrier = &start_barrier;
+                        ti[i].delay = interval;
+                        ti[i].nsample = nsample;
+                        ti[i].func = vec ? vector : scalar;
+                    }
+
+                    run_threads(&ti[0], tc);
+
+                    for (int i = 0; i < tc; i++) {
+                        if (ti[i].freq.empty()) {
+                            continue;
+                        }
+                        bool vec = ti[i].func == vector;
+
+                        ProcessorIndex idx =
+                            g->proc_table->logical_index_to_processor(i,
+                                                                      order);
+                        char buffer[128];
+                        sprintf(buffer, "%s/%s n=%d pu%d (%s)",
+                                mix == MIX_MIXED
+                                    ? "mixed"
+                                    : (mix == MIX_VECTOR ? "vector"
+                                                         : "scalar"),
+                                order_name[order], tc,
+                                (int)idx.pu_obj->os_index,
+                                vec ? vector_name : "fadd64");
+
+                        row_label.push_back(buffer);
+                        row_freq.push_back(ti[i].freq);
+                    }
+                }
+            }
+        }
+
+        auto table =
+            new table_t("thread", "time[sec]", row_label.size(), nsample);
+        for (int si = 0; si < nsample; si++) {
+            table->column_label[si] = (si + 1) * interval;
+        }
+        for (size_t row = 0; row < row_label.size(); row++) {
+            table->row_label[row] = row_label[row];
+            for (int si = 0; si < nsample; si++) {
+                (*table)[row][si] = row_freq[row][si] / 1e9;
+            }
+        }
+
+        return result_t(table);
+#else
+        return result_t();
+#endif
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+#ifdef HAVE_HW_PERF_COUNTER
+        return thread_cpucycle_available(g);
 #else
         return false;
 #endif
@@ -244,5 +446,8 @@ struct ActualFreq : public parent_t {
 std::unique_ptr<BenchDesc> get_actual_freq_desc() {
     return std::unique_ptr<BenchDesc>(new ActualFreq());
 }
+std::unique_ptr<BenchDesc> get_actual_freq_timeline_desc() {
+    return std::unique_ptr<BenchDesc>(new ActualFreqTimeline());
+}
 
 } // namespace smbm
@@ -0,0 +1,362 @@
+/* AVX/AVX-512 frequency license transition.
+ *
+ * Scalar and heavy vector (256/512bit FMA) phases alternate. Every phase is
+ * cut into short blocks, and each block boundary is timestamped with the
+ * userland timer (rdtscp) and, when available, the perf cycle counter.
+ *
+ * transition : from the start of the vector phase until the blocks settle
+ *              to the steady state time
+ * penalty    : time lost in the transition compared to vector blocks in
+ *              steady state (upper lane power up, license switch stall)
+ * recovery   : from the start of the next scalar phase until the scalar
+ *              blocks are back to the baseline time (license released)
+ *
+ * Values are medians over the cycles. When the scalar phase is shorter than
+ * the recovery time, the next vector phase starts in the vector license and
+ * shows no penalty.
+ *
+ * avx-license-freq reports the steady state core frequency of the scalar
+ * and vector phases (needs the perf cycle counter).
+ */
+
+#include "cpu-feature.h"
+#include "stats.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "x86funcs.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+#ifdef X86
+
+enum class Phase { SCALAR, FMA256, FMA512 };
+
+/* scalar counterpart of fma64x4_block, mulsd + addsd */
+uint64_t scalar_block(uint64_t zero, uint64_t n) {
+    double a = 0.5 + zero;
+    double acc0 = 1.0, acc1 = acc0, acc2 = acc0, acc3 = acc0, acc4 = acc0,
+           acc5 = acc0, acc6 = acc0, acc7 = acc0;
+
+    for (uint64_t i = 0; i < n; i++) {
+        acc0 = acc0 * a + a;
+        acc1 = acc1 * a + a;
+        acc2 = acc2 * a + a;
+        acc3 = acc3 * a + a;
+        acc4 = acc4 * a + a;
+        acc5 = acc5 * a + a;
+        acc6 = acc6 * a + a;
+        acc7 = acc7 * a + a;
+    }
+
+    return (uint64_t)((acc0 + acc1) + (acc2 + acc3) + (acc4 + acc5) +
+                      (acc6 + acc7));
+}
+
+uint64_t run_block(Phase ph, uint64_t zero, uint64_t n) {
+    switch (ph) {
+    case Phase::FMA256:
+        return fma64x4_block(zero, n);
+    case Phase::FMA512:
+        return fma64x8_block(zero, n);
+    default:
+        return scalar_block(zero, n);
+    }
+}
+
+struct Trace {
+    /* stamp[i] .. stamp[i+1] is the i-th block */
+    std::vector<userland_timer_value> stamp;
+    std::vector<uint64_t> cycle;
+
+    size_t nblock() const { return stamp.size() - 1; }
+};
+
+struct Runner {
+    GlobalState const *g;
+    bool use_cycle;
+    uint64_t zero;
+    uint64_t sink;
+
+    Runner(GlobalState const *g) : g(g), sink(0) {
+        use_cycle = g->is_hw_perf_counter_available();
+        zero = g->getzero();
+    }
+
+    uint64_t read_cycle() {
+#ifdef HAVE_HW_PERF_COUNTER
+        if (use_cycle) {
+            return g->get_hw_cpucycle();
+        }
+#endif
+        return 0;
+    }
+
+    /* runs blocks of n iterations for sec. tr is reused between calls, its
+     * capacity is kept */
+    void record(Phase ph, uint64_t n, double sec, Trace *tr) {
+        tr->stamp.clear();
+        tr->cycle.clear();
+
+        auto start = userland_timer_value::get();
+        auto end = g->inc_sec_userland_timer(&start, sec);
+
+        tr->stamp.push_back(start);
+        tr->cycle.push_back(read_cycle());
+
+        while (1) {
+            sink += run_block(ph, zero, n);
+
+            auto t = userland_timer_value::get();
+            tr->stamp.push_back(t);
+            tr->cycle.push_back(read_cycle());
+
+            if (t >= end) {
+                break;
+            }
+        }
+    }
+
+    double block_sec(Trace const &tr, size_t i) {
+        return g->userland_timer_delta_to_sec(tr.stamp[i + 1] - tr.stamp[i]);
+    }
+
+    double elapsed_sec(Trace const &tr, size_t i) {
+        return g->userland_timer_delta_to_sec(tr.stamp[i] - tr.stamp[0]);
+    }
+
+    /* median of the block time over the second half of the trace */
+    double steady_block_sec(Trace const &tr) {
+        std::vector<double> v;
+        for (size_t i = tr.nblock() / 2; i < tr.nblock(); i++) {
+            v.push_back(block_sec(tr, i));
+        }
+        return median(v);
+    }
+
+    /* cycle / sec over the second half of the trace */
+    double steady_freq(Trace const &tr) {
+        size_t b = tr.nblock() / 2, e = tr.nblock();
+        double sec = g->userland_timer_delta_to_sec(tr.stamp[e] - tr.stamp[b]);
+        return (tr.cycle[e] - tr.cycle[b]) / sec;
+    }
+
+    /* iterations per block so that one block takes about sample_sec */
+    uint64_t calibrate(Phase ph, double sample_sec, Trace *tr) {
+        uint64_t probe = 64;
+        record(ph, probe, 0.02, tr);
+
+        double per_iter = steady_block_sec(*tr) / probe;
+        return std::max((uint64_t)1, (uint64_t)(sample_sec / per_iter));
+    }
+
+    /* block time and frequency after the phase has been running long
+     * enough to be in steady state */
+    void steady(Phase ph, uint64_t n, double *block, double *freq,
+                Trace *tr) {
+        record(ph, n, 0.02, tr);
+        *block = steady_block_sec(*tr);
+        *freq = use_cycle ? steady_freq(*tr) : 0;
+    }
+};
+
+/* first block where the median of a window of blocks gets within
+ * limit * ref. the window hides interrupts and VM exits. nblock() if it
+ * never does */
+size_t settle_block(Runner *r, Trace const &tr, double ref, double limit) {
+    size_t w = 8;
+    std::vector<double> win;
+
+    for (size_t i = 0; i + w <= tr.nblock(); i++) {
+        win.clear();
+        for (size_t j = 0; j < w; j++) {
+            win.push_back(r->block_sec(tr, i + j));
+        }
+        if (median(win) <= ref * limit) {
+            return i;
+        }
+    }
+
+    return tr.nblock();
+}
+
+std::vector<Phase> vector_phases() {
+    std::vector<Phase> phases;
+    if (have_fma()) {
+        phases.push_back(Phase::FMA256);
+    }
+    if (have_avx512f()) {
+        phases.push_back(Phase::FMA512);
+    }
+    return phases;
+}
+
+const char *phase_name(Phase ph) {
+    return ph == Phase::FMA256 ? "fma256" : "fma512";
+}
+
+#endif
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct AVXLicenseTransition : public parent_t {
+    AVXLicenseTransition()
+        : parent_t("avx-license-transition", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("cycles", 8, "number of scalar/vector cycles per row");
+        add_param("sample_usec", 2, "length of a timestamped block [usec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+#ifdef X86
+        std::vector<Phase> phases = vector_phases();
+
+        std::vector<double> vec_ms = {0.05, 0.5, 5};
+        std::vector<double> scalar_ms = {0.5, 5};
+
+        int ncycle = std::max(2, (int)param("cycles"));
+        double sample_sec = param("sample_usec") * 1e-6;
+
+        Runner r(g);
+
+        int nrow = phases.size() * vec_ms.size() * scalar_ms.size();
+        auto table = new table_t("phase", "measure", nrow, 3);
+        table->column_label[0] = "penalty[usec]";
+        table->column_label[1] = "transition[usec]";
+        table->column_label[2] = "recovery[usec]";
+
+        Trace tr_v, tr_s;
+        uint64_t n_scalar = r.calibrate(Phase::SCALAR, sample_sec, &tr_s);
+
+        int row = 0;
+        for (auto ph : phases) {
+            double vec_base, vec_freq, scalar_base, scalar_freq;
+            uint64_t n_vec = r.calibrate(ph, sample_sec, &tr_v);
+            r.steady(ph, n_vec, &vec_base, &vec_freq, &tr_v);
+
+            /* also drops the vector license before the first cycle */
+            r.steady(Phase::SCALAR, n_scalar, &scalar_base, &scalar_freq,
+                     &tr_s);
+
+            for (auto vms : vec_ms) {
+                for (auto sms : scalar_ms) {
+                    std::vector<double> penalty, transition, recovery;
+
+                    for (int ci = 0; ci < ncycle; ci++) {
+                        r.record(ph, n_vec, vms * 1e-3, &tr_v);
+                        r.record(Phase::SCALAR, n_scalar, sms * 1e-3, &tr_s);
+
+                        size_t vs = settle_block(&r, tr_v, vec_base, 1.05);
+                        size_t ss = settle_block(&r, tr_s, scalar_base, 1.03);
+
+                        /* excess over the steady state until it settles */
+                        double p = 0;
+                        for (size_t bi = 0; bi < vs; bi++) {
+                            double d = r.block_sec(tr_v, bi) - vec_base;
+                            p += std::max(0.0, d);
+                        }
+
+                        penalty.push_back(p * 1e6);
+                        transition.push_back(r.elapsed_sec(tr_v, vs) * 1e6);
+                        recovery.push_back(r.elapsed_sec(tr_s, ss) * 1e6);
+                    }
+
+                    char buf[128];
+                    sprintf(buf, "%s vec=%.2fms scalar=%.1fms",
+                            phase_name(ph), vms, sms);
+                    table->row_label[row] = buf;
+
+                    (*table)[row][0] = median(penalty);
+                    (*table)[row][1] = median(transition);
+                    (*table)[row][2] = median(recovery);
+                    row++;
+                }
+            }
+        }
+
+        g->dummy_write(0, r.sink);
+
+        return result_t(table);
+#else
+        return result_t();
+#endif
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+#ifdef X86
+        return have_fma();
+#else
+        return false;
+#endif
+    }
+};
+
+/* steady state frequency of each phase, kept out of the transition table
+ * since higher is better here */
+struct AVXLicenseFreq : public parent_t {
+    AVXLicenseFreq() : parent_t("avx-license-freq", HIGHER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("sample_usec", 2, "length of a timestamped block [usec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+#ifdef X86
+        std::vector<Phase> phases = vector_phases();
+        double sample_sec = param("sample_usec") * 1e-6;
+
+        Runner r(g);
+        Trace tr_v, tr_s;
+        uint64_t n_scalar = r.calibrate(Phase::SCALAR, sample_sec, &tr_s);
+
+        auto table = new table_t("phase", "measure", phases.size(), 2);
+        table->column_label[0] = "scalar[GHz]";
+        table->column_label[1] = "vector[GHz]";
+
+        for (size_t row = 0; row < phases.size(); row++) {
+            Phase ph = phases[row];
+            double vec_base, vec_freq, scalar_base, scalar_freq;
+            uint64_t n_vec = r.calibrate(ph, sample_sec, &tr_v);
+            r.steady(ph, n_vec, &vec_base, &vec_freq, &tr_v);
+            r.steady(Phase::SCALAR, n_scalar, &scalar_base, &scalar_freq,
+                     &tr_s);
+
+            table->row_label[row] = phase_name(ph);
+            (*table)[row][0] = scalar_freq / 1e9;
+            (*table)[row][1] = vec_freq / 1e9;
+        }
+
+        g->dummy_write(0, r.sink);
+
+        return result_t(table);
+#else
+        return result_t();
+#endif
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+#ifdef X86
+        return have_fma() && g->is_hw_perf_counter_available();
+#else
+        return false;
+#endif
+    }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_avx_license_transition_desc() {
+    return std::unique_ptr<BenchDesc>(new AVXLicenseTransition());
+}
+std::unique_ptr<BenchDesc> get_avx_license_freq_desc() {
+    return std::unique_ptr<BenchDesc>(new AVXLicenseFreq());
+}
+
+} // namespace smbm
@@ -114,3 +114,220 @@ Loop(int ninsn, bool indirect_branch, int nindirect_brach_target) {
 
     isync(this->em.p, ((char*)this->em.p) + this->inst_len);
 }
+
+static void fill_brk(uint32_t *p, size_t nword) {
+    for (size_t i = 0; i < nword; i++) {
+        /* brk #0 */
+        p[i] = 0xd4200000;
+    }
+}
+
+/* b (target) from p */
+static uint32_t enc_b(uint32_t const *p, uint32_t const *target) {
+    return 0x14000000 | ((target - p) & ((1 << 26) - 1));
+}
+/* bl (target) from p */
+static uint32_t enc_bl(uint32_t const *p, uint32_t const *target) {
+    return 0x94000000 | ((target - p) & ((1 << 26) - 1));
+}
+/* cbnz xN, (target) from p */
+static uint32_t enc_cbnz(uint32_t const *p, uint32_t const *target, int reg) {
+    return 0xb5000000 | (((target - p) & ((1 << 19) - 1)) << 5) | reg;
+}
+
+/* nbranch always taken b, each one at the start of a stride bytes block,
+ * jumping to the next block. gaps are filled with brk. */
+void gen_taken_chain(int nbranch, int stride) {
+    size_t tail = (size_t)nbranch * stride;
+    size_t alloc_size = tail + 4 * 4;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = alloc_size;
+
+    uint32_t *p0 = (uint32_t *)this->em.p;
+    fill_brk(p0, tail / 4);
+
+    for (int i = 0; i < nbranch; i++) {
+        uint32_t *p = p0 + ((size_t)i * stride) / 4;
+        *p = enc_b(p, p + stride / 4);
+    }
+
+    uint32_t *p = p0 + tail / 4;
+
+    /* sub x1, x1, 1 */
+    *(p++) = 0xd1000421;
+    /* cbz x1, +8 */
+    *(p++) = 0xb4000000 | (2 << 5) | 1;
+    /* b loop_start, cbnz can't reach large footprints */
+    *p = enc_b(p, p0);
+    p++;
+    /* ret */
+    *(p++) = 0xd65f03c0;
+
+    isync(this->em.p, ((char *)this->em.p) + this->inst_len);
+}
+
+/* loop { bl f0 } ; f(k) calls f(k+1), f(depth-1) returns.
+ * each function is in its own 16 byte slot. */
+void gen_call_chain(int depth) {
+    size_t func_start = 32;
+    size_t alloc_size = func_start + depth * 16;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = alloc_size;
+
+    uint32_t *p0 = (uint32_t *)this->em.p;
+    fill_brk(p0, alloc_size / 4);
+
+    uint32_t *f0 = p0 + func_start / 4;
+    uint32_t *p = p0;
+
+    /* stp x29, x30, [sp, -16]! */
+    *(p++) = 0xa9bf7bfd;
+
+    uint32_t *loop_start = p;
+    *p = enc_bl(p, f0);
+    p++;
+
+    /* sub x1, x1, 1 */
+    *(p++) = 0xd1000421;
+    *p = enc_cbnz(p, loop_start, 1);
+    p++;
+
+    /* ldp x29, x30, [sp], 16 */
+    *(p++) = 0xa8c17bfd;
+    /* ret */
+    *(p++) = 0xd65f03c0;
+
+    for (int k = 0; k < depth; k++) {
+        p = f0 + k * 4;
+
+        if (k != depth - 1) {
+            *(p++) = 0xa9bf7bfd;
+            *p = enc_bl(p, f0 + (k + 1) * 4);
+            p++;
+            *(p++) = 0xa8c17bfd;
+        }
+
+        *(p++) = 0xd65f03c0;
+    }
+
+    isync(this->em.p, ((char *)this->em.p) + this->inst_len);
+}
+
+/* one indirect br per iteration. the target index is read from the table
+ * (one byte per iteration), every target branches back to the join. */
+void gen_indirect_dispatch(int ntarget) {
+    size_t target_start = 32;
+    size_t table_start = target_start + ntarget * 16;
+    size_t alloc_size = table_start + ntarget * 8;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = table_start;
+
+    uint32_t *p0 = (uint32_t *)this->em.p;
+    fill_brk(p0, table_start / 4);
+    uint64_t *jmp_table = (uint64_t *)(((char *)p0) + table_start);
+
+    uint32_t *p = p0;
+
+    /* adr x3, table */
+    *(p++) = 0x10000000 | ((table_start >> 2) << 5) | 3;
+
+    uint32_t *loop_start = p;
+
+    /* ldrb w5, [x0], 1 */
+    *(p++) = 0x38401400 | (0 << 5) | 5;
+    /* ldr x5, [x3, x5, lsl 3] */
+    *(p++) = 0xf8657865;
+    /* br x5 */
+    *(p++) = 0xd61f00a0;
+
+    uint32_t *join = p;
+
+    /* sub x1, x1, 1 */
+    *(p++) = 0xd1000421;
+    *p = enc_cbnz(p, loop_start, 1);
+    p++;
+    /* ret */
+    *(p++) = 0xd65f03c0;
+
+    for (int ti = 0; ti < ntarget; ti++) {
+        p = p0 + (target_start + ti * 16) / 4;
+        jmp_table[ti] = (uintptr_t)p;
+        *p = enc_b(p, join);
+    }
+
+    isync(this->em.p, ((char *)this->em.p) + this->inst_len);
+}
+
+/* footprint bytes of straight line code or of 64 byte blocks chained by b
+ * in a shuffled order, executed as one loop iteration.
+ *  STRAIGHT_NOP : nop
+ *  STRAIGHT_ALU : add x9..x12, 1 (4 independent chains)
+ *  JUMP_BLOCKS  : 15 nops + b per block */
+void gen_footprint(BranchProbe kind, size_t footprint) {
+    size_t alloc_size = footprint + 4 * 4;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = alloc_size;
+
+    uint32_t *p0 = (uint32_t *)this->em.p;
+    uint32_t *tail = p0 + footprint / 4;
+
+    if (kind == BranchProbe::JUMP_BLOCKS) {
+        size_t block = 64 / 4;
+        size_t nblock = footprint / 64;
+        fill_brk(p0, footprint / 4);
+
+        std::vector<size_t> order(nblock);
+        for (size_t i = 0; i < nblock; i++) {
+            order[i] = i;
+        }
+        std::mt19937 engine(0);
+        std::shuffle(order.begin() + 1, order.end(), engine);
+
+        for (size_t i = 0; i < nblock; i++) {
+            uint32_t *p = p0 + order[i] * block;
+            for (int j = 0; j < 15; j++) {
+                /* nop */
+                *(p++) = 0xd503201f;
+            }
+
+            uint32_t *next = tail;
+            if (i != nblock - 1) {
+                next = p0 + order[i + 1] * block;
+            }
+            *p = enc_b(p, next);
+        }
+
+        this->probe_insn_count = nblock * 16 + 3;
+    } else {
+        for (size_t i = 0; i < footprint / 4; i++) {
+            if (kind == BranchProbe::STRAIGHT_ALU) {
+                /* add x(9+i%4), x(9+i%4), 1 */
+                uint32_t r = 9 + (i & 3);
+                p0[i] = 0x91000400 | (r << 5) | r;
+            } else {
+                /* nop */
+                p0[i] = 0xd503201f;
+            }
+        }
+
+        this->probe_insn_count = footprint / 4 + 3;
+    }
+
+    uint32_t *p = tail;
+
+    /* sub x1, x1, 1 */
+    *(p++) = 0xd1000421;
+    /* cbz x1, +8 */
+    *(p++) = 0xb4000000 | (2 << 5) | 1;
+    /* b loop_start */
+    *p = enc_b(p, p0);
+    p++;
+    /* ret */
+    *(p++) = 0xd65f03c0;
+
+    isync(this->em.p, ((char *)this->em.p) + this->inst_len);
+}
@@ -109,3 +109,213 @@ Loop(int ninsn, bool indirect_branch, int nindirect_brach_target) {
         // abort();
     }
 }
+
+#ifdef WINDOWS
+static constexpr uint8_t first_argument_reg = 0x1;  /* rcx */
+static constexpr uint8_t second_argument_reg = 0x2; /* rdx */
+#else
+static constexpr uint8_t first_argument_reg = 0x7;  /* rdi */
+static constexpr uint8_t second_argument_reg = 0x6; /* rsi */
+#endif
+
+/* tail of probe loops : dec second_argument ; jnz loop_start ; ret */
+static char *gen_loop_tail(char *p, char const *loop_start) {
+    *(p++) = 0xff;
+    *(p++) = 0xc8 | second_argument_reg;
+
+    uint32_t disp = -(int64_t)((p + 6) - loop_start);
+    *(p++) = 0x0f;
+    *(p++) = 0x85;
+    output4(p, disp);
+
+    *(p++) = 0xc3;
+    return p;
+}
+
+/* nbranch always taken jmps, each one at the start of a stride bytes
+ * block, jumping to the next block. gaps are filled with int3. */
+void gen_taken_chain(int nbranch, int stride) {
+    size_t tail = (size_t)nbranch * stride;
+    size_t alloc_size = tail + 2 + 6 + 1;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = alloc_size;
+
+    char *p0 = (char *)this->em.p;
+    memset(p0, 0xcc, tail);
+
+    for (int i = 0; i < nbranch; i++) {
+        char *p = p0 + (size_t)i * stride;
+
+        if (stride >= 5) {
+            /* jmp rel32 */
+            *(p++) = 0xe9;
+            output4(p, stride - 5);
+        } else {
+            /* jmp rel8 */
+            *(p++) = 0xeb;
+            *(p++) = stride - 2;
+        }
+    }
+
+    gen_loop_tail(p0 + tail, p0);
+}
+
+/* loop { call f0 } ; f(k) calls f(k+1), f(depth-1) returns.
+ * each function is in its own 16 byte slot. */
+void gen_call_chain(int depth) {
+    size_t func_start = 16;
+    size_t alloc_size = func_start + depth * 16;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = alloc_size;
+
+    char *p0 = (char *)this->em.p;
+    memset(p0, 0xcc, alloc_size);
+
+    char *p = p0;
+
+    /* call f0 */
+    *(p++) = 0xe8;
+    output4(p, func_start - 5);
+
+    gen_loop_tail(p, p0);
+
+    for (int k = 0; k < depth; k++) {
+        p = p0 + func_start + k * 16;
+
+        if (k != depth - 1) {
+            /* call f(k+1) */
+            *(p++) = 0xe8;
+            output4(p, 16 - 5);
+        }
+
+        /* ret */
+        *(p++) = 0xc3;
+    }
+}
+
+/* one indirect jmp per iteration. the target index is read from the
+ * table (one byte per iteration), every target jumps back to the join. */
+void gen_indirect_dispatch(int ntarget) {
+    size_t target_start = 32;
+    size_t table_start = target_start + ntarget * 16;
+    size_t alloc_size = table_start + ntarget * 8;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = table_start;
+
+    char *p0 = (char *)this->em.p;
+    memset(p0, 0xcc, table_start);
+    uint64_t *jmp_table = (uint64_t *)(p0 + table_start);
+
+    char *p = p0;
+
+    /* lea r9, [rip + table_start] */
+    *(p++) = 0x4c;
+    *(p++) = 0x8d;
+    *(p++) = 0x0d;
+    output4(p, table_start - 7);
+
+    char *loop_start = p;
+
+    /* movzx r8, byte [first_argument] */
+    *(p++) = 0x4c;
+    *(p++) = 0x0f;
+    *(p++) = 0xb6;
+    *(p++) = first_argument_reg;
+
+    /* jmp [r9 + r8*8] */
+    *(p++) = 0x43;
+    *(p++) = 0xff;
+    *(p++) = 0x24;
+    *(p++) = 0xc1;
+
+    char *join = p;
+
+    /* inc first_argument */
+    *(p++) = 0x48;
+    *(p++) = 0xff;
+    *(p++) = 0xc0 | first_argument_reg;
+
+    gen_loop_tail(p, loop_start);
+
+    for (int ti = 0; ti < ntarget; ti++) {
+        p = p0 + target_start + ti * 16;
+        jmp_table[ti] = (uintptr_t)p;
+
+        /* jmp join */
+        *(p++) = 0xe9;
+        output4(p, join - (p + 4));
+    }
+}
+
+/* footprint bytes of straight line code or of 64 byte blocks chained by
+ * jmp in a shuffled order, executed as one loop iteration.
+ *  STRAIGHT_NOP : 4 byte nop
+ *  STRAIGHT_ALU : add r8d..r11d, 1 (4 independent chains, 4 byte each)
+ *  JUMP_BLOCKS  : 14 nops + jmp rel32 per block */
+void gen_footprint(BranchProbe kind, size_t footprint) {
+    size_t alloc_size = footprint + 2 + 6 + 1;
+
+    this->em = alloc_exeutable(alloc_size);
+    this->inst_len = alloc_size;
+
+    char *p0 = (char *)this->em.p;
+    char *p = p0;
+
+    if (kind == BranchProbe::JUMP_BLOCKS) {
+        size_t block = 64;
+        size_t nblock = footprint / block;
+        memset(p0, 0xcc, footprint);
+
+        std::vector<size_t> order(nblock);
+        for (size_t i = 0; i < nblock; i++) {
+            order[i] = i;
+        }
+        std::mt19937 engine(0);
+        std::shuffle(order.begin() + 1, order.end(), engine);
+
+        for (size_t i = 0; i < nblock; i++) {
+            p = p0 + order[i] * block;
+            for (int j = 0; j < 14; j++) {
+                /* nop dword [rax] */
+                *(p++) = 0x0f;
+                *(p++) = 0x1f;
+                *(p++) = 0x40;
+                *(p++) = 0x00;
+            }
+
+            char *next = p0 + footprint;
+            if (i != nblock - 1) {
+                next = p0 + order[i + 1] * block;
+            }
+
+            /* jmp next */
+            *(p++) = 0xe9;
+            output4(p, next - (p + 4));
+        }
+
+        this->probe_insn_count = nblock * 15 + 2;
+    } else {
+        for (size_t i = 0; i < footprint / 4; i++) {
+            if (kind == BranchProbe::STRAIGHT_ALU) {
+                /* add r8d+(i%4), 1 */
+                *(p++) = 0x41;
+                *(p++) = 0x83;
+                *(p++) = 0xc0 | (i & 3);
+                *(p++) = 0x01;
+            } else {
+                /* nop dword [rax] */
+                *(p++) = 0x0f;
+                *(p++) = 0x1f;
+                *(p++) = 0x40;
+                *(p++) = 0x00;
+            }
+        }
+
+        this->probe_insn_count = footprint / 4 + 2;
+    }
+
+    gen_loop_tail(p0 + footprint, p0);
+}
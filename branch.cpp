@@ -5,6 +5,7 @@
 #define _USE_MATH_DEFINES
 #include "barrier.h"
 #include "memalloc.h"
+#include "simple-run.h"
 #include <math.h>
 
 namespace smbm {
@@ -18,11 +19,24 @@ static inline void output4(char *&p, uint32_t v) {
     *(p++) = (v >> (8 * 3)) & 0xff;
 }
 
+/* loops used to probe the branch target buffer / return stack buffer /
+ * indirect predictor and the instruction fetch path, generated by gen_*() in
+ * branch-{x86,aarch64}.h */
+enum class BranchProbe {
+    TAKEN_CHAIN,
+    CALL_CHAIN,
+    INDIRECT_DISPATCH,
+    STRAIGHT_NOP,
+    STRAIGHT_ALU,
+    JUMP_BLOCKS
+};
+
 #ifdef HAVE_DYNAMIC_CODE_GENERATOR
 struct Loop {
     typedef int (*loop_func_t)(const char *table, int loop);
 
     size_t inst_len;
+    size_t probe_insn_count = 0; /* instructions per iteration */
 
     ExecutableMemory em;
 
@@ -39,6 +53,25 @@ struct Loop {
 //#error "loop generator for this architecture is not yet implemented."
 #endif
 
+    Loop(BranchProbe probe, int n, int stride) {
+        switch (probe) {
+        case BranchProbe::TAKEN_CHAIN:
+            gen_taken_chain(n, stride);
+            break;
+        case BranchProbe::CALL_CHAIN:
+            gen_call_chain(n);
+            break;
+        case BranchProbe::INDIRECT_DISPATCH:
+            gen_indirect_dispatch(n);
+            break;
+        case BranchProbe::STRAIGHT_NOP:
+        case BranchProbe::STRAIGHT_ALU:
+        case BranchProbe::JUMP_BLOCKS:
+            gen_footprint(probe, n);
+            break;
+        }
+    }
+
     void invoke(char const *table, int nloop) {
         ((loop_func_t)this->em.p)(table, nloop);
     }
@@ -47,6 +80,8 @@ struct Loop {
 #else
 struct Loop {
     Loop(int ninsn, bool indirect_branch, int nindirect_brach_target) {}
+    Loop(BranchProbe probe, int n, int stride) {}
+    size_t probe_insn_count = 1;
     void invoke(char const *table, int nloop) {}
 };
 
@@ -62,7 +97,7 @@ enum class GenMethod { FULL, ITER, INST, COS };
 
 static ResultValue run1(const GlobalState *g, int ninst, int nloop,
                         GenMethod gm, bool indirect,
-                        int nindirect_brach_target) {
+                        int nindirect_brach_target, int niter) {
     perf_counter_value_t cycle0 = 0, branch0 = 0, cycle1 = 0, branch1 = 0;
     userland_timer_value t0, t1;
     struct ResultValue ret = {};
@@ -145,7 +180,6 @@ static ResultValue run1(const GlobalState *g, int ninst, int nloop,
     }
 #endif
 
-    int niter = 1024;
     for (int i = 0; i < niter; i++) {
         loop.invoke(&table[0], nloop);
     }
@@ -211,7 +245,10 @@ template <bool static_available> struct RandomBranch : public parent_t {
     RandomBranch(GenMethod m, bool use_perf_counter, bool indirect)
         : parent_t(RandomBranch::get_name(m, use_perf_counter, indirect),
                    LOWER_IS_BETTER),
-          gm(m), use_perf_counter(use_perf_counter), indirect(indirect) {}
+          gm(m), use_perf_counter(use_perf_counter), indirect(indirect) {
+        tags = {TAG_CPU};
+        add_param("niter", 1024, "number of generated loop invocations");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         table_t *ret;
@@ -241,9 +278,11 @@ template <bool static_available> struct RandomBranch : public parent_t {
 
         for (int ti : target_table) {
             for (int i : count_table) {
-                auto add_label = [g, &row_label, ret, &row,
+                int niter = param("niter");
+                auto add_label = [g, &row_label, ret, &row, niter,
                                   this](int i0, int i1, int ti) {
-                    auto r = run1(g, i0, i1, this->gm, this->indirect, ti);
+                    auto r = run1(g, i0, i1, this->gm, this->indirect, ti,
+                                  niter);
                     char buf[512];
                     if (this->indirect) {
                         sprintf(buf, "%6d x %6d [nindirect_taregt=%d]", i0, i1,
@@ -285,6 +324,286 @@ template <bool static_available> struct RandomBranch : public parent_t {
     }
 };
 
+/* nsec per loop.invoke(table, nloop) */
+static double run_probe(const GlobalState *g, Loop &loop, char const *table,
+                        int nloop, double duration_sec) {
+    loop.invoke(table, nloop);
+
+    auto r = run_calibrated(
+        g,
+        [&loop, table, nloop](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                loop.invoke(table, nloop);
+            }
+        },
+        duration_sec);
+
+    return r.sec_per_unit() * 1e9;
+}
+
+/* BTB capacity and aliasing : nbranch always taken branches spread over
+ * nbranch*stride bytes of code. time per branch jumps when the branches no
+ * longer fit in the BTB, earlier for strides that alias in its index. */
+struct BTBCapacity : public Table2DBenchDesc<double, uint32_t, uint32_t> {
+    typedef Table2DBenchDesc<double, uint32_t, uint32_t> parent_t;
+
+    BTBCapacity() : parent_t("btb-capacity", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+        add_param("max_branch", 16384, "largest number of taken branches");
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<uint32_t> nbranch_list;
+        for (int n = 64; n <= param("max_branch"); n *= 2) {
+            nbranch_list.push_back(n);
+        }
+
+#ifdef AARCH64
+        std::vector<uint32_t> stride_list = {4, 16, 64, 256, 1024, 4096};
+#else
+        std::vector<uint32_t> stride_list = {2, 16, 64, 256, 1024, 4096};
+#endif
+
+        auto ret = new table_t("taken branches", "stride[byte]",
+                               nbranch_list.size(), stride_list.size());
+        ret->row_label = nbranch_list;
+        ret->column_label = stride_list;
+
+        for (size_t ri = 0; ri < nbranch_list.size(); ri++) {
+            for (size_t ci = 0; ci < stride_list.size(); ci++) {
+                int nbranch = nbranch_list[ri];
+                Loop loop(BranchProbe::TAKEN_CHAIN, nbranch, stride_list[ci]);
+
+                int nloop = std::max(1, 65536 / nbranch);
+                double ns = run_probe(g, loop, nullptr, nloop, param("duration"));
+
+                /* + loop back edge */
+                (*ret)[ri][ci] = ns / ((double)nloop * (nbranch + 1));
+            }
+        }
+
+        return result_t(ret);
+    }
+
+    int double_precision() override { return 3; }
+
+    bool available(GlobalState const *g) override {
+        return static_available_probe;
+    }
+
+#ifdef HAVE_DYNAMIC_CODE_GENERATOR
+    static constexpr bool static_available_probe = true;
+#else
+    static constexpr bool static_available_probe = false;
+#endif
+};
+
+/* return stack buffer depth : call chains of depth 1..64. returns start
+ * to mispredict once the chain is deeper than the RSB. */
+struct RSBDepth : public Table1DBenchDesc<double, int> {
+    typedef Table1DBenchDesc<double, int> parent_t;
+
+    RSBDepth() : parent_t("rsb-depth", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.05, "measurement time per depth [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<int> depth_list = {1,  2,  4,  6,  8,  10, 12, 14,
+                                       16, 18, 20, 22, 24, 26, 28, 30,
+                                       32, 36, 40, 48, 56, 64};
+
+        auto ret = new table_t("call depth", depth_list.size());
+        ret->column_label = "nsec/(call+ret)";
+        ret->row_label = depth_list;
+
+        for (size_t i = 0; i < depth_list.size(); i++) {
+            int depth = depth_list[i];
+            Loop loop(BranchProbe::CALL_CHAIN, depth, 0);
+
+            int nloop = 1024;
+            double ns = run_probe(g, loop, nullptr, nloop, param("duration"));
+
+            (*ret)[i] = ns / ((double)nloop * depth);
+        }
+
+        return result_t(ret);
+    }
+
+    int double_precision() override { return 3; }
+
+    bool available(GlobalState const *g) override {
+        return BTBCapacity::static_available_probe;
+    }
+};
+
+/* indirect predictor : one indirect branch with 1..256 targets, taken in a
+ * cyclic (learnable from history) or uniformly random order */
+struct IndirectTarget
+    : public Table2DBenchDesc<double, uint32_t, std::string> {
+    typedef Table2DBenchDesc<double, uint32_t, std::string> parent_t;
+
+    IndirectTarget() : parent_t("indirect-target", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+        add_param("nloop", 4096, "length of the target sequence");
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<uint32_t> ntarget_list = {1,  2,  4,   8,  16,
+                                              32, 64, 128, 256};
+        std::vector<std::string> pattern_list = {"cyclic", "random"};
+
+        auto ret = new table_t("targets", "pattern", ntarget_list.size(),
+                               pattern_list.size());
+        ret->row_label = ntarget_list;
+        ret->column_label = pattern_list;
+
+        int nloop = param("nloop");
+        std::vector<char> table(nloop);
+
+        for (size_t ri = 0; ri < ntarget_list.size(); ri++) {
+            int ntarget = ntarget_list[ri];
+            Loop loop(BranchProbe::INDIRECT_DISPATCH, ntarget, 0);
+
+            for (size_t ci = 0; ci < pattern_list.size(); ci++) {
+                std::mt19937 engine(0);
+                std::uniform_int_distribution<> dist(0, ntarget - 1);
+
+                for (int i = 0; i < nloop; i++) {
+                    if (ci == 0) {
+                        table[i] = i % ntarget;
+                    } else {
+                        table[i] = dist(engine);
+                    }
+                }
+
+                double ns =
+                    run_probe(g, loop, &table[0], nloop, param("duration"));
+                (*ret)[ri][ci] = ns / nloop;
+            }
+        }
+
+        return result_t(ret);
+    }
+
+    int double_precision() override { return 3; }
+
+    bool available(GlobalState const *g) override {
+        return BTBCapacity::static_available_probe;
+    }
+};
+
+/* front end footprint : 1KiB..8MiB of straight line nop / alu code, and of
+ * 64 byte blocks chained by jumps in a shuffled order (no sequential
+ * prefetch). nsec per instruction steps up as the loop body overflows the
+ * uop cache, L1i, L2 and the iTLB reach.
+ *
+ * icache-footprint-knee runs the same sweep and reports the steps: a row at
+ * least 25% slower than the previous one. The value is the largest
+ * footprint before the step, in KiB. Steps are numbered from the smallest
+ * footprint, so when every level shows, they are uop cache, L1i, L2 and
+ * iTLB in that order. */
+struct ICacheFootprint
+    : public Table2DBenchDesc<double, std::string, std::string> {
+    typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+    bool knee;
+
+    ICacheFootprint(bool knee)
+        : parent_t(knee ? "icache-footprint-knee" : "icache-footprint",
+                   knee ? HIGHER_IS_BETTER : LOWER_IS_BETTER),
+          knee(knee) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+        add_param("max_footprint", 8 * 1024 * 1024,
+                  "largest code footprint [byte]");
+    }
+
+    static std::string size_label(size_t sz) {
+        char buf[64];
+        if (sz >= 1024 * 1024) {
+            sprintf(buf, "%dMiB", (int)(sz / (1024 * 1024)));
+        } else {
+            sprintf(buf, "%dKiB", (int)(sz / 1024));
+        }
+        return buf;
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<size_t> footprint_list;
+        for (size_t sz = 1024; sz <= (size_t)param("max_footprint"); sz *= 2) {
+            footprint_list.push_back(sz);
+        }
+
+        std::vector<std::pair<std::string, BranchProbe>> kind_list = {
+            {"nop", BranchProbe::STRAIGHT_NOP},
+            {"alu", BranchProbe::STRAIGHT_ALU},
+            {"jmp-chain", BranchProbe::JUMP_BLOCKS},
+        };
+
+        auto ret = new table_t("footprint", "code", footprint_list.size(),
+                               kind_list.size());
+
+        for (size_t ri = 0; ri < footprint_list.size(); ri++) {
+            ret->row_label[ri] = size_label(footprint_list[ri]);
+        }
+        for (size_t ci = 0; ci < kind_list.size(); ci++) {
+            ret->column_label[ci] = kind_list[ci].first;
+        }
+
+        for (size_t ri = 0; ri < footprint_list.size(); ri++) {
+            for (size_t ci = 0; ci < kind_list.size(); ci++) {
+                size_t footprint = footprint_list[ri];
+                Loop loop(kind_list[ci].second, footprint, 0);
+
+                int nloop = std::max((size_t)1, (256 * 1024) / footprint);
+                double ns = run_probe(g, loop, nullptr, nloop, param("duration"));
+
+                (*ret)[ri][ci] =
+                    ns / ((double)nloop * loop.probe_insn_count);
+            }
+        }
+
+        if (!knee) {
+            return result_t(ret);
+        }
+
+        std::vector<std::string> step_label;
+        std::vector<double> step_kib;
+        for (size_t ci = 0; ci < kind_list.size(); ci++) {
+            int nstep = 0;
+            for (size_t ri = 1; ri < footprint_list.size(); ri++) {
+                double prev = (*ret)[ri - 1][ci];
+                double cur = (*ret)[ri][ci];
+                if (prev > 0 && cur > prev * 1.25) {
+                    step_label.push_back(kind_list[ci].first + " step " +
+                                         std::to_string(++nstep));
+                    step_kib.push_back(footprint_list[ri - 1] / 1024.0);
+                }
+            }
+        }
+        delete ret;
+
+        /* one row per step found, the cells of a step that is not found
+         * are left out */
+        auto knees = new table_t("step", "measure", step_label.size(), 1);
+        knees->column_label[0] = "footprint[KiB]";
+        for (size_t i = 0; i < step_label.size(); i++) {
+            knees->row_label[i] = step_label[i];
+            (*knees)[i][0] = step_kib[i];
+        }
+        return result_t(knees);
+    }
+
+    int double_precision() override { return knee ? 0 : 4; }
+
+    bool available(GlobalState const *g) override {
+        return BTBCapacity::static_available_probe;
+    }
+};
+
 #ifdef HAVE_DYNAMIC_CODE_GENERATOR
 constexpr bool static_available = true;
 #else
@@ -335,4 +654,20 @@ std::unique_ptr<BenchDesc> get_indirect_branch_hit_desc() {
         new RandomBranch<static_available>(GenMethod::FULL, true, true));
 }
 
+std::unique_ptr<BenchDesc> get_btb_capacity_desc() {
+    return std::unique_ptr<BenchDesc>(new BTBCapacity());
+}
+std::unique_ptr<BenchDesc> get_rsb_depth_desc() {
+    return std::unique_ptr<BenchDesc>(new RSBDepth());
+}
+std::unique_ptr<BenchDesc> get_indirect_target_desc() {
+    return std::unique_ptr<BenchDesc>(new IndirectTarget());
+}
+std::unique_ptr<BenchDesc> get_icache_footprint_desc() {
+    return std::unique_ptr<BenchDesc>(new ICacheFootprint(false));
+}
+std::unique_ptr<BenchDesc> get_icache_footprint_knee_desc() {
+    return std::unique_ptr<BenchDesc>(new ICacheFootprint(true));
+}
+
 } // namespace smbm
@@ -0,0 +1,207 @@
+#include "stats.h"
+#include "sys-microbenchmark.h"
+#include <fstream>
+#include <getopt.h>
+
+using namespace smbm;
+
+enum {
+    ARG_THRESHOLD = 256,
+    ARG_ALPHA,
+    ARG_BASELINE_INDEX,
+    ARG_CANDIDATE_INDEX,
+    ARG_TEST_NAME
+};
+
+/* exit status */
+enum { EXIT_PASS = 0, EXIT_ERROR = 1, EXIT_REGRESSION = 2 };
+
+static void usage() {
+    puts("usage: compare-result [--threshold 0.05] [--alpha 0.05]\n"
+         "                      [--baseline-index 0] [--candidate-index 0]\n"
+         "                      [--test-name name] baseline.json "
+         "candidate.json\n"
+         "  exit status: 0=pass, 1=error, 2=significant regression");
+}
+
+static bool load(ResultListSet &dst, const char *path) {
+    std::ifstream ifs;
+    ifs.open(path);
+    if (!ifs) {
+        perror(path);
+        return false;
+    }
+
+    picojson::value v;
+    ifs >> v;
+    deserialize_result(dst, v);
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    double threshold = 0.05;
+    double alpha = 0.05;
+    int baseline_index = 0;
+    int candidate_index = 0;
+    std::string test_name;
+
+    while (1) {
+        int option_index = 0;
+
+        static struct option long_options[] = {
+            {"threshold", required_argument, 0, ARG_THRESHOLD},
+            {"alpha", required_argument, 0, ARG_ALPHA},
+            {"baseline-index", required_argument, 0, ARG_BASELINE_INDEX},
+            {"candidate-index", required_argument, 0, ARG_CANDIDATE_INDEX},
+            {"test-name", required_argument, 0, ARG_TEST_NAME},
+            {0, 0, 0, 0}};
+
+        int c = getopt_long(argc, argv, "", long_options, &option_index);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case ARG_THRESHOLD:
+            threshold = atof(optarg);
+            break;
+        case ARG_ALPHA:
+            alpha = atof(optarg);
+            break;
+        case ARG_BASELINE_INDEX:
+            baseline_index = atoi(optarg);
+            break;
+        case ARG_CANDIDATE_INDEX:
+            candidate_index = atoi(optarg);
+            break;
+        case ARG_TEST_NAME:
+            test_name = optarg;
+            break;
+        default:
+            usage();
+            return EXIT_ERROR;
+        }
+    }
+
+    if (argc - optind != 2) {
+        usage();
+        return EXIT_ERROR;
+    }
+
+    ResultListSet base_set, cand_set;
+    if (!load(base_set, argv[optind]) || !load(cand_set, argv[optind + 1])) {
+        return EXIT_ERROR;
+    }
+
+    if (baseline_index < 0 || baseline_index >= (int)base_set.lists.size() ||
+        candidate_index < 0 || candidate_index >= (int)cand_set.lists.size()) {
+        puts("result index out of range");
+        return EXIT_ERROR;
+    }
+
+    auto &base = base_set.lists[baseline_index];
+    auto &cand = cand_set.lists[candidate_index];
+
+    printf("baseline  : %s-%s (%s)\n", base.sysinfo.cpuid.c_str(),
+           base.sysinfo.os.c_str(), base.sysinfo.date.c_str());
+    printf("candidate : %s-%s (%s)\n", cand.sysinfo.cpuid.c_str(),
+           cand.sysinfo.os.c_str(), cand.sysinfo.date.c_str());
+
+    int nregression = 0;
+    int nimprovement = 0;
+    int nuntested = 0;
+    int nunreachable = 0;
+
+    auto bench_list = get_all_benchmark_list();
+
+    for (auto &&b : bench_list) {
+        if (test_name != "" && b->name != test_name) {
+            continue;
+        }
+
+        auto bit = base.results.find(b->name);
+        auto cit = cand.results.find(b->name);
+        if (bit == base.results.end() || cit == cand.results.end()) {
+            continue;
+        }
+
+        auto base_cells = bit->second->get_sample_cells();
+        auto cand_cells = cit->second->get_sample_cells();
+
+        std::map<std::string, std::vector<double> const *> cand_map;
+        for (auto &&c : cand_cells) {
+            cand_map[c.label] = &c.samples;
+        }
+
+        printf("== %s (%s is better) ==\n", b->name.c_str(),
+               b->lower_is_better() ? "lower" : "higher");
+
+        for (auto &&c : base_cells) {
+            auto it = cand_map.find(c.label);
+            if (it == cand_map.end()) {
+                continue;
+            }
+
+            auto &s0 = c.samples;
+            auto &s1 = *it->second;
+
+            double m0 = median(s0);
+            double m1 = median(s1);
+
+            if (m0 == 0) {
+                continue;
+            }
+
+            double ratio = m1 / m0;
+            double worse = b->lower_is_better() ? (ratio - 1.0) : (1.0 - ratio);
+
+            const char *verdict = "";
+            double p = 1.0;
+
+            if (s0.size() < 2 || s1.size() < 2) {
+                nuntested++;
+                verdict = "(no samples)";
+            } else if (mann_whitney_u_min_p(s0.size(), s1.size()) >= alpha) {
+                /* no data can pass the test, it would always pass */
+                nuntested++;
+                nunreachable++;
+                verdict = "(too few samples)";
+            } else {
+                p = mann_whitney_u_p(s0, s1);
+
+                if (p < alpha) {
+                    if (worse > threshold) {
+                        verdict = "REGRESSION";
+                        nregression++;
+                    } else if (-worse > threshold) {
+                        verdict = "improvement";
+                        nimprovement++;
+                    }
+                }
+            }
+
+            printf("%40s|%12.4f|%12.4f|%8.3f|p=%6.4f %s\n", c.label.c_str(),
+                   m0, m1, ratio, p, verdict);
+        }
+    }
+
+    printf("regressions: %d, improvements: %d, untested cells: %d\n",
+           nregression, nimprovement, nuntested);
+
+    if (nuntested > nunreachable) {
+        puts("note : cells without per-trial samples are not tested. run "
+             "sys-microbenchmark with '-n trials' to record samples.");
+    }
+    if (nunreachable) {
+        printf("note : %d cells have too few samples to reach p < %g. 4 "
+               "trials per side reach p = 0.029.\n",
+               nunreachable, alpha);
+    }
+
+    if (nregression) {
+        return EXIT_REGRESSION;
+    }
+
+    return EXIT_PASS;
+}
@@ -30,6 +30,26 @@ bool have_clflushopt() { XCPUID_BIT(7, 0, EBX, 23); }
 bool have_rdrand() { CPUID_BIT(1, ECX, 30); }
 bool have_clwb() { XCPUID_BIT(7,0, EBX, 24); }
 bool have_pcommit() { XCPUID_BIT(7,0, EBX, 22); }
+bool have_ssse3() { CPUID_BIT(1, ECX, 9); }
+bool have_sse41() { CPUID_BIT(1, ECX, 19); }
+bool have_sse42() { CPUID_BIT(1, ECX, 20); }
+bool have_popcnt() { CPUID_BIT(1, ECX, 23); }
+bool have_pclmulqdq() { CPUID_BIT(1, ECX, 1); }
+bool have_aes() { CPUID_BIT(1, ECX, 25); }
+bool have_f16c() { CPUID_BIT(1, ECX, 29); }
+bool have_lzcnt() { CPUID_BIT(0x80000001, ECX, 5); }
+bool have_bmi1() { XCPUID_BIT(7, 0, EBX, 3); }
+bool have_bmi2() { XCPUID_BIT(7, 0, EBX, 8); }
+bool have_avx512dq() { XCPUID_BIT(7, 0, EBX, 17); }
+bool have_avx512ifma() { XCPUID_BIT(7, 0, EBX, 21); }
+bool have_avx512cd() { XCPUID_BIT(7, 0, EBX, 28); }
+bool have_avx512bw() { XCPUID_BIT(7, 0, EBX, 30); }
+bool have_avx512vbmi() { XCPUID_BIT(7, 0, ECX, 1); }
+bool have_avx512vbmi2() { XCPUID_BIT(7, 0, ECX, 6); }
+bool have_gfni() { XCPUID_BIT(7, 0, ECX, 8); }
+bool have_avx512vnni() { XCPUID_BIT(7, 0, ECX, 11); }
+bool have_avx512bitalg() { XCPUID_BIT(7, 0, ECX, 12); }
+bool have_avx512vpopcntdq() { XCPUID_BIT(7, 0, ECX, 14); }
 
 #endif
 } // namespace smbm
@@ -15,6 +15,26 @@ bool have_clflushopt();
 bool have_rdrand();
 bool have_clwb();
 bool have_pcommit();
+bool have_ssse3();
+bool have_sse41();
+bool have_sse42();
+bool have_popcnt();
+bool have_pclmulqdq();
+bool have_aes();
+bool have_f16c();
+bool have_lzcnt();
+bool have_bmi1();
+bool have_bmi2();
+bool have_avx512dq();
+bool have_avx512ifma();
+bool have_avx512cd();
+bool have_avx512bw();
+bool have_avx512vbmi();
+bool have_avx512vbmi2();
+bool have_gfni();
+bool have_avx512vnni();
+bool have_avx512bitalg();
+bool have_avx512vpopcntdq();
 #endif
 
 }
@@ -6,6 +6,9 @@
 
 namespace smbm {
 
+const char *const proc_relation_name[NPROC_REL] = {
+    "smt-sibling", "shared-llc", "same-package", "other-package"};
+
 #ifdef HAVE_THREAD
 
 #ifdef HAVE_HWLOC
@@ -95,9 +98,59 @@ static void build_count_tree(hwloc_obj_t node,
     }
 }
 
+/* the outermost data cache above pu */
+static hwloc_obj_t last_level_cache(hwloc_obj_t pu) {
+    hwloc_obj_t llc = nullptr;
+    for (hwloc_obj_t o = pu->parent; o; o = o->parent) {
+        if (hwloc_obj_type_is_dcache(o->type)) {
+            llc = o;
+        }
+    }
+    return llc;
+}
+
+static int pu_relation(hwloc_topology_t topo, hwloc_obj_t a, hwloc_obj_t b) {
+    hwloc_obj_t core = hwloc_get_ancestor_obj_by_type(topo, HWLOC_OBJ_CORE, a);
+    if (core &&
+        core == hwloc_get_ancestor_obj_by_type(topo, HWLOC_OBJ_CORE, b)) {
+        return PROC_REL_SMT_SIBLING;
+    }
+
+    hwloc_obj_t llc = last_level_cache(a);
+    if (llc && llc == last_level_cache(b)) {
+        return PROC_REL_SHARED_LLC;
+    }
+
+    if (hwloc_get_ancestor_obj_by_type(topo, HWLOC_OBJ_PACKAGE, a) ==
+        hwloc_get_ancestor_obj_by_type(topo, HWLOC_OBJ_PACKAGE, b)) {
+        return PROC_REL_SAME_PACKAGE;
+    }
+
+    return PROC_REL_OTHER_PACKAGE;
+}
+
 } // namespace
 
-ProcessorTable::ProcessorTable() {
+ProcessorTable::ProcessorTable() {}
+
+int ProcessorTable::processor_relation(int a, int b, int order) const {
+    load();
+    return pu_relation(topo, table[order][a].pu_obj, table[order][b].pu_obj);
+}
+
+int ProcessorTable::find_related_processor(int logical_index, int order,
+                                           int relation) const {
+    int n = get_active_cpu_count();
+    for (int i = 0; i < n; i++) {
+        if (i != logical_index &&
+            processor_relation(logical_index, i, order) == relation) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ProcessorTable::load_topology() const {
     int r = hwloc_topology_init(&this->topo);
     if (r == -1) {
         perror("hwloc_topolology_init");
@@ -142,23 +195,28 @@ ProcessorTable::ProcessorTable() {
 
         croot->inc();
     }
+
+    this->loaded = true;
 }
 
 ProcessorTable::~ProcessorTable() {
-    hwloc_topology_destroy(this->topo);
-    hwloc_bitmap_free(this->startup_set);
+    if (this->loaded) {
+        hwloc_topology_destroy(this->topo);
+        hwloc_bitmap_free(this->startup_set);
+    }
 }
 
 void bind_self_to_1proc(std::unique_ptr<ProcessorTable> const &tbl,
                         ProcessorIndex idx, bool membind) {
     int r =
-        hwloc_set_cpubind(tbl->topo, idx.pu_obj->cpuset, HWLOC_CPUBIND_THREAD);
+        hwloc_set_cpubind(tbl->get_topo(), idx.pu_obj->cpuset,
+                          HWLOC_CPUBIND_THREAD);
     if (r < 0) {
         perror("set_cpubind");
         exit(1);
     }
     if (membind) {
-        hwloc_set_membind(tbl->topo, idx.pu_obj->cpuset, HWLOC_MEMBIND_BIND,
+        hwloc_set_membind(tbl->get_topo(), idx.pu_obj->cpuset, HWLOC_MEMBIND_BIND,
                           HWLOC_MEMBIND_THREAD | HWLOC_MEMBIND_NOCPUBIND);
         if (r < 0) {
             perror("set_membind");
@@ -175,7 +233,7 @@ void bind_self_to_first(std::unique_ptr<ProcessorTable> const &tbl,
 }
 
 void bind_self_to_all(std::unique_ptr<ProcessorTable> const &tbl) {
-    int r = hwloc_set_cpubind(tbl->topo, tbl->startup_set,
+    int r = hwloc_set_cpubind(tbl->get_topo(), tbl->get_startup_set(),
                               HWLOC_CPUBIND_THREAD | HWLOC_CPUBIND_NOMEMBIND);
     if (r < 0) {
         perror("set_cpubind");
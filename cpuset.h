@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "sys-features.h"
 
@@ -19,6 +20,18 @@ enum {
     NPROC_ORDER,
 };
 
+/* how a processor relates to another one */
+enum {
+    PROC_REL_SMT_SIBLING,   /* same core */
+    PROC_REL_SHARED_LLC,    /* other core, same last level cache */
+    PROC_REL_SAME_PACKAGE,  /* other last level cache, same package */
+    PROC_REL_OTHER_PACKAGE,
+
+    NPROC_REL,
+};
+
+extern const char *const proc_relation_name[NPROC_REL];
+
 #ifdef HAVE_THREAD
 
 #ifdef HAVE_HWLOC
@@ -29,24 +42,53 @@ struct ProcessorIndex {
     {}
 };
 
+/* topology is loaded on first use. the startup cpuset is the binding of
+ * the thread at that time */
 struct ProcessorTable {
-    hwloc_topology_t topo;
-    hwloc_cpuset_t startup_set;
-
-    std::vector<ProcessorIndex> table[NPROC_ORDER];
     const ProcessorIndex logical_index_to_processor(int logical_index, int order) const {
+        load();
         return table[order][logical_index];
     }
 
     int get_active_cpu_count() const {
+        load();
         return (int)table[0].size();
     }
 
+    /* PROC_REL_* of processor b seen from a */
+    int processor_relation(int a, int b, int order) const;
+
+    /* logical index of the first active processor that has the relation
+     * to logical_index, -1 if there is none */
+    int find_related_processor(int logical_index, int order,
+                               int relation) const;
+
+    hwloc_topology_t get_topo() const {
+        load();
+        return topo;
+    }
+    hwloc_cpuset_t get_startup_set() const {
+        load();
+        return startup_set;
+    }
+
     ProcessorTable(const ProcessorTable &rhs)  = delete;
     void operator=(const ProcessorTable &) = delete;
 
     ProcessorTable();
     ~ProcessorTable();
+
+private:
+    mutable std::once_flag load_once;
+    mutable bool loaded = false;
+    mutable hwloc_topology_t topo;
+    mutable hwloc_cpuset_t startup_set;
+    mutable std::vector<ProcessorIndex> table[NPROC_ORDER];
+
+    void load() const {
+        std::call_once(load_once, [this]() { load_topology(); });
+    }
+    void load_topology() const;
 };
 
 #else
@@ -72,6 +114,15 @@ struct ProcessorTable {
         return 1;
     }
 
+    int processor_relation(int a, int b, int order) const {
+        return PROC_REL_SMT_SIBLING;
+    }
+
+    int find_related_processor(int logical_index, int order,
+                               int relation) const {
+        return -1;
+    }
+
     ProcessorTable(const ProcessorTable &rhs)  = delete;
     void operator=(const ProcessorTable &) = delete;
 
@@ -0,0 +1,379 @@
+/* Cost of memory fences with stores in flight.
+ *
+ * Each iteration does N stores, then the fence. The value is the time of
+ * the loop minus the same loop without the fence, per iteration, in cycles
+ * (nsec without perf counter), min of several tries.
+ *
+ * <N> store       : N stores to distinct lines of an L1 resident buffer
+ * <N> miss store  : N stores to lines 4160B apart in a 128MiB buffer, each
+ *                   one misses the caches, the store buffer fills up
+ * contended       : 1 store to a line that a thread on another processor
+ *                   keeps writing (shared LLC or SMT sibling if there is
+ *                   one). 0 with a single processor
+ *
+ * The stores are plain stores. "ldar" / "load acquire" load the fence
+ * line with acquire semantics, "stlr" / "store seq_cst" and "store
+ * release" write it, instead of a fence.
+ */
+
+#include "barrier.h"
+#include "cpu-feature.h"
+#include "cpuset.h"
+#include "memalloc.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "thread.h"
+
+#include <atomic>
+#include <limits.h>
+#include <new>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+struct FenceNone {
+    static void run(std::atomic<uint64_t> *) {}
+};
+
+struct FenceCompiler {
+    static void run(std::atomic<uint64_t> *) { compiler_mb(); }
+};
+
+#define STD_FENCE(NAME, ORDER)                                                 \
+    struct NAME {                                                              \
+        static void run(std::atomic<uint64_t> *) {                             \
+            std::atomic_thread_fence(ORDER);                                   \
+        }                                                                      \
+    };
+
+STD_FENCE(FenceAcquire, std::memory_order_acquire)
+STD_FENCE(FenceRelease, std::memory_order_release)
+STD_FENCE(FenceAcqRel, std::memory_order_acq_rel)
+STD_FENCE(FenceSeqCst, std::memory_order_seq_cst)
+
+struct LoadAcquire {
+    static void run(std::atomic<uint64_t> *p) {
+        uint64_t v = p->load(std::memory_order_acquire);
+        __asm__ __volatile__("" ::"r"(v));
+    }
+};
+
+struct StoreRelease {
+    static void run(std::atomic<uint64_t> *p) {
+        p->store(1, std::memory_order_release);
+    }
+};
+
+struct StoreSeqCst {
+    static void run(std::atomic<uint64_t> *p) {
+        p->store(1, std::memory_order_seq_cst);
+    }
+};
+
+#define FOR_EACH_STD_FENCE(F)                                                  \
+    F("compiler barrier", FenceCompiler)                                       \
+    F("atomic_thread_fence(acquire)", FenceAcquire)                            \
+    F("atomic_thread_fence(release)", FenceRelease)                            \
+    F("atomic_thread_fence(acq_rel)", FenceAcqRel)                             \
+    F("atomic_thread_fence(seq_cst)", FenceSeqCst)                             \
+    F("load acquire", LoadAcquire)                                             \
+    F("store release", StoreRelease)                                           \
+    F("store seq_cst", StoreSeqCst)
+
+#ifdef X86
+
+struct Mfence {
+    static void run(std::atomic<uint64_t> *) {
+        __asm__ __volatile__("mfence" ::: "memory");
+    }
+};
+
+struct Lfence {
+    static void run(std::atomic<uint64_t> *) { rmb(); }
+};
+
+struct Sfence {
+    static void run(std::atomic<uint64_t> *) { wmb(); }
+};
+
+struct LockAdd {
+    static void run(std::atomic<uint64_t> *) {
+        __asm__ __volatile__("lock addl $0, (%%rsp)" ::: "memory", "cc");
+    }
+};
+
+#define FOR_EACH_ARCH_FENCE(F)                                                 \
+    F("mfence", Mfence)                                                        \
+    F("lfence (rmb)", Lfence)                                                  \
+    F("sfence (wmb)", Sfence)                                                  \
+    F("lock add [rsp]", LockAdd)
+
+#elif defined AARCH64
+
+#define ASM_FENCE(NAME, INSN)                                                  \
+    struct NAME {                                                              \
+        static void run(std::atomic<uint64_t> *) {                             \
+            __asm__ __volatile__(INSN ::: "memory");                           \
+        }                                                                      \
+    };
+
+ASM_FENCE(DmbIsh, "dmb ish")
+ASM_FENCE(DmbIshld, "dmb ishld")
+ASM_FENCE(DmbIshst, "dmb ishst")
+ASM_FENCE(DsbIsh, "dsb ish")
+ASM_FENCE(Isb, "isb")
+
+struct Rmb {
+    static void run(std::atomic<uint64_t> *) { rmb(); }
+};
+
+struct Wmb {
+    static void run(std::atomic<uint64_t> *) { wmb(); }
+};
+
+struct Ldar {
+    static void run(std::atomic<uint64_t> *p) {
+        uint64_t v;
+        __asm__ __volatile__("ldar %0, [%1]" : "=r"(v) : "r"(p) : "memory");
+        __asm__ __volatile__("" ::"r"(v));
+    }
+};
+
+struct Stlr {
+    static void run(std::atomic<uint64_t> *p) {
+        __asm__ __volatile__("stlr %0, [%1]" ::"r"((uint64_t)1), "r"(p)
+                             : "memory");
+    }
+};
+
+#define FOR_EACH_ARCH_FENCE(F)                                                 \
+    F("dmb ish", DmbIsh)                                                       \
+    F("dmb ishld", DmbIshld)                                                   \
+    F("dmb ishst", DmbIshst)                                                   \
+    F("dmb ld (rmb)", Rmb)                                                     \
+    F("dmb st (wmb)", Wmb)                                                     \
+    F("dsb ish", DsbIsh)                                                       \
+    F("isb", Isb)                                                              \
+    F("ldar", Ldar)                                                            \
+    F("stlr", Stlr)
+
+#else
+
+#define FOR_EACH_ARCH_FENCE(F)
+
+#endif
+
+/* where the stores go */
+struct StoreTarget {
+    char *buf;
+    size_t stride;
+    uint64_t mask; /* line index mask */
+};
+
+struct Column {
+    std::string name;
+    int nstore;
+    int target; /* TARGET_* */
+};
+
+enum { TARGET_L1, TARGET_MISS, TARGET_SHARED, NTARGET };
+
+template <typename F>
+__attribute__((noinline)) void run_loop(StoreTarget const &t, int nstore,
+                                        std::atomic<uint64_t> *line,
+                                        uint64_t count) {
+    uint64_t pos = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        for (int k = 0; k < nstore; k++) {
+            *(volatile uint64_t *)(t.buf + (pos & t.mask) * t.stride) = i;
+            pos++;
+        }
+        F::run(line);
+    }
+}
+
+/* cycle (or nsec) per iteration, min of ntry */
+template <typename F>
+double measure(GlobalState const *g, StoreTarget const &t, int nstore,
+               std::atomic<uint64_t> *line, uint64_t count) {
+    int ntry = 5;
+    uint64_t min = ULLONG_MAX;
+    bool use_cycle = g->is_hw_perf_counter_available();
+
+    run_loop<F>(t, nstore, line, count);
+
+    for (int i = 0; i < ntry; i++) {
+        uint64_t d;
+        if (use_cycle) {
+#ifdef HAVE_HW_PERF_COUNTER
+            auto c0 = g->get_hw_cpucycle();
+            run_loop<F>(t, nstore, line, count);
+            auto c1 = g->get_hw_cpucycle();
+            d = c1 - c0;
+#else
+            d = 0;
+#endif
+        } else {
+            auto c0 = userland_timer_value::get();
+            run_loop<F>(t, nstore, line, count);
+            auto c1 = userland_timer_value::get();
+            d = c1 - c0;
+        }
+        min = std::min(min, d);
+    }
+
+    if (use_cycle) {
+        return (double)min / count;
+    }
+    return 1e9 * g->userland_timer_delta_to_sec(min) / count;
+}
+
+struct Writer {
+    thread_handle_t thread;
+    GlobalState const *g;
+    int proc;
+    std::atomic<bool> stop;
+    volatile uint64_t *line;
+};
+
+void *writer_main(void *p) {
+    Writer *w = (Writer *)p;
+    auto pi = w->g->proc_table->logical_index_to_processor(
+        w->proc, PROC_ORDER_OUTER_TO_INNER);
+    bind_self_to_1proc(w->g->proc_table, pi, true);
+
+    uint64_t v = 0;
+    while (!w->stop.load(std::memory_order_relaxed)) {
+        *w->line = v++;
+    }
+    return nullptr;
+}
+
+/* a processor near 0 for the writer, -1 if there is only one */
+int writer_processor(GlobalState const *g) {
+    int rels[] = {PROC_REL_SHARED_LLC, PROC_REL_SMT_SIBLING,
+                  PROC_REL_SAME_PACKAGE, PROC_REL_OTHER_PACKAGE};
+    for (int rel : rels) {
+        int p = g->proc_table->find_related_processor(
+            0, PROC_ORDER_OUTER_TO_INNER, rel);
+        if (p >= 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct FenceCost : public parent_t {
+    FenceCost() : parent_t("fence-cost", LOWER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_THREADING};
+        add_param("iters", 1 << 14, "iterations per measurement");
+    }
+
+    result_t run(GlobalState const *g) override {
+        uint64_t count = std::max(256, (int)param("iters"));
+        const char *unit =
+            g->is_hw_perf_counter_available() ? "[cycle]" : "[nsec]";
+
+        std::vector<Column> cols = {
+            {"0 store", 0, TARGET_L1},        {"1 store", 1, TARGET_L1},
+            {"4 store", 4, TARGET_L1},        {"16 store", 16, TARGET_L1},
+            {"64 store", 64, TARGET_L1},      {"16 miss store", 16, TARGET_MISS},
+            {"64 miss store", 64, TARGET_MISS}, {"contended", 1, TARGET_SHARED},
+        };
+
+        size_t miss_stride = 4160, miss_lines = 32768;
+        char *l1_buf = (char *)aligned_calloc(CACHELINE_SIZE, 64 * 64);
+        char *miss_buf =
+            (char *)aligned_calloc(CACHELINE_SIZE, miss_stride * miss_lines);
+        char *shared = (char *)aligned_calloc(CACHELINE_SIZE, CACHELINE_SIZE);
+        auto *line = new (aligned_calloc(CACHELINE_SIZE, CACHELINE_SIZE))
+            std::atomic<uint64_t>(0);
+
+        StoreTarget targets[NTARGET] = {{l1_buf, 64, 63},
+                                        {miss_buf, miss_stride, miss_lines - 1},
+                                        {shared, 0, 0}};
+
+        Writer w;
+        w.g = g;
+        w.proc = writer_processor(g);
+        w.stop = false;
+        w.line = (volatile uint64_t *)shared;
+
+        std::vector<std::string> rows;
+        std::vector<std::vector<double>> values;
+
+        bind_self_to_first(g->proc_table, true);
+
+        auto measure_row = [&](const char *name, auto run) {
+            rows.push_back(name);
+            values.emplace_back(cols.size(), 0.0);
+            for (size_t c = 0; c < cols.size(); c++) {
+                if (cols[c].target == TARGET_SHARED) {
+                    continue;
+                }
+                values.back()[c] = run(targets[cols[c].target], cols[c].nstore);
+            }
+        };
+
+#define ROW(NAME, TYPE)                                                        \
+    measure_row(NAME, [&](StoreTarget const &t, int nstore) {                 \
+        return measure<TYPE>(g, t, nstore, line, count) -                      \
+               measure<FenceNone>(g, t, nstore, line, count);                  \
+    });
+
+        FOR_EACH_ARCH_FENCE(ROW)
+        FOR_EACH_STD_FENCE(ROW)
+
+        /* the contended column, with the writer running */
+        if (w.proc >= 0) {
+            w.thread = spawn_thread(writer_main, &w);
+            size_t c = cols.size() - 1;
+            size_t r = 0;
+
+#define CONTENDED(NAME, TYPE)                                                  \
+    values[r++][c] =                                                           \
+        measure<TYPE>(g, targets[TARGET_SHARED], 1, line, count) -             \
+        measure<FenceNone>(g, targets[TARGET_SHARED], 1, line, count);
+
+            FOR_EACH_ARCH_FENCE(CONTENDED)
+            FOR_EACH_STD_FENCE(CONTENDED)
+
+            w.stop = true;
+            wait_thread(w.thread);
+        }
+
+        auto t = new table_t("fence", "stores", rows.size(), cols.size());
+        for (size_t c = 0; c < cols.size(); c++) {
+            t->column_label[c] = cols[c].name + unit;
+        }
+        for (size_t r = 0; r < rows.size(); r++) {
+            t->row_label[r] = rows[r];
+            for (size_t c = 0; c < cols.size(); c++) {
+                (*t)[r][c] = values[r][c];
+            }
+        }
+
+        aligned_free(l1_buf);
+        aligned_free(miss_buf);
+        aligned_free(shared);
+        aligned_free(line);
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 1; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_fence_cost_desc() {
+    return std::unique_ptr<BenchDesc>(new FenceCost());
+}
+
+} // namespace smbm
@@ -1,6 +1,15 @@
+#include "cpu-feature.h"
+#include "opaque.h"
 #include "simple-run.h"
 #include "sys-microbenchmark.h"
 #include "table.h"
+#include <math.h>
+
+#ifdef X86
+#include <immintrin.h>
+#elif defined AARCH64
+#include <arm_neon.h>
+#endif
 
 namespace smbm {
 
@@ -120,6 +129,19 @@ struct denormal_div
 
 
 
+static bool have_denormal() {
+    long v1 = 1;
+    long v2 = 2;
+    asm volatile (" " :"+r"(v1));
+    asm volatile (" " :"+r"(v2));
+
+    double x = l2d(v1);
+    double y = l2d(v2);
+
+    /* lacks denormal support */
+    return (x + y) != 0;
+}
+
 #define FOR_EACH_TEST(F)                        \
     F(denormal_add)                                 \
     F(normal_add)                                 \
@@ -132,7 +154,10 @@ typedef Table1DBenchDesc<double,std::string> parent_t;
 template <bool static_available>
 struct FPU : public parent_t{
     bool cycle;
-    FPU(bool cycle) : parent_t(cycle?"fpu-cycle":"fpu-realtime", LOWER_IS_BETTER), cycle(cycle) {}
+    FPU(bool cycle) : parent_t(cycle?"fpu-cycle":"fpu-realtime", LOWER_IS_BETTER), cycle(cycle) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.1, "measurement time per test [sec]");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         int count = 0;
@@ -156,16 +181,21 @@ struct FPU : public parent_t{
 #define RUN(F)                                                                 \
     {                                                                          \
         F t;                                                                   \
-        if (cycle)                                                      \
-            (*result)[count++] = run_test_g_cycle(g, &t);               \
-        else                                                            \
-            (*result)[count++] = run_test_g(g, &t);                     \
+        double err = -1;                                                       \
+        if (cycle)                                                             \
+            (*result)[count] =                                                 \
+                run_test_g_cycle(g, &t, param("duration"), &err);              \
+        else                                                                   \
+            (*result)[count] = run_test_g(g, &t, param("duration"), &err);     \
+        result->set_error(count++, err);                                       \
     }
 #else
 #define RUN(F)                                                                 \
     {                                                                          \
-        F t;                                                            \
-        (*result)[count++] = run_test_g(g, &t);                         \
+        F t;                                                                   \
+        double err = -1;                                                       \
+        (*result)[count] = run_test_g(g, &t, param("duration"), &err);         \
+        result->set_error(count++, err);                                       \
     }
 #endif
 
@@ -184,21 +214,408 @@ struct FPU : public parent_t{
             }
         }
 
-        long v1 = 1;
-        long v2 = 2;
-        asm volatile (" " :"+r"(v1));
-        asm volatile (" " :"+r"(v2));
+        return have_denormal();
+    }
+};
+
+/* Special value matrix.
+ *
+ * rows    : op x precision x vector width x operand class
+ * columns : the default FP mode, and denormals flushed (MXCSR FTZ|DAZ on
+ *           x86, FPCR.FZ on AArch64)
+ *
+ * operand classes
+ *   normal       : all operands and the result are normal
+ *   denorm-in    : the first operand is denormal
+ *   denorm-out   : normal operands, denormal result
+ *   mixed-lanes  : denorm-in in lane 0 only, the other lanes normal
+ *   nan, inf     : the first operand is NaN / Inf
+ *
+ * Each cell is the time per op of independent ops (throughput). Combinations
+ * that do not exist (sqrt or f32->f64 can't produce a denormal, scalar has
+ * no lanes) have no row. */
+
+enum class FOp { ADD, MUL, DIV, FMA, SQRT, CVT, NUM_FOP };
+const char *fop_name[] = {"add", "mul", "div", "fma", "sqrt", "cvt"};
+
+enum class OperandClass {
+    NORMAL,
+    DENORMAL_IN,
+    DENORMAL_OUT,
+    MIXED_LANES,
+    NAN_IN,
+    INF_IN,
+    NUM_CLASS
+};
+const char *operand_class_name[] = {"normal",      "denorm-in", "denorm-out",
+                                    "mixed-lanes", "nan",       "inf"};
+
+#ifdef X86
+#define FMA_TARGET __attribute__((target("fma")))
+#else
+#define FMA_TARGET
+#endif
+
+struct OpAdd {
+    template <typename T> static T f(T x, T y, T z) { return x + y; }
+};
+struct OpMul {
+    template <typename T> static T f(T x, T y, T z) { return x * y; }
+};
+struct OpDiv {
+    template <typename T> static T f(T x, T y, T z) { return x / y; }
+};
+
+struct OpFma {
+    FMA_TARGET static float f(float x, float y, float z) {
+        return __builtin_fmaf(x, y, z);
+    }
+    FMA_TARGET static double f(double x, double y, double z) {
+        return __builtin_fma(x, y, z);
+    }
+    FMA_TARGET static v4f f(v4f x, v4f y, v4f z) {
+#ifdef X86
+        return (v4f)_mm_fmadd_ps((__m128)x, (__m128)y, (__m128)z);
+#elif defined AARCH64
+        return (v4f)vfmaq_f32((float32x4_t)z, (float32x4_t)x,
+                              (float32x4_t)y);
+#else
+        return v4f{__builtin_fmaf(x[0], y[0], z[0]),
+                   __builtin_fmaf(x[1], y[1], z[1]),
+                   __builtin_fmaf(x[2], y[2], z[2]),
+                   __builtin_fmaf(x[3], y[3], z[3])};
+#endif
+    }
+    FMA_TARGET static v2d f(v2d x, v2d y, v2d z) {
+#ifdef X86
+        return (v2d)_mm_fmadd_pd((__m128d)x, (__m128d)y, (__m128d)z);
+#elif defined AARCH64
+        return (v2d)vfmaq_f64((float64x2_t)z, (float64x2_t)x,
+                              (float64x2_t)y);
+#else
+        return v2d{__builtin_fma(x[0], y[0], z[0]),
+                   __builtin_fma(x[1], y[1], z[1])};
+#endif
+    }
+};
+
+struct OpSqrt {
+    static float f(float x, float y, float z) { return __builtin_sqrtf(x); }
+    static double f(double x, double y, double z) { return __builtin_sqrt(x); }
+    static v4f f(v4f x, v4f y, v4f z) {
+#ifdef X86
+        return (v4f)_mm_sqrt_ps((__m128)x);
+#elif defined AARCH64
+        return (v4f)vsqrtq_f32((float32x4_t)x);
+#else
+        return v4f{__builtin_sqrtf(x[0]), __builtin_sqrtf(x[1]),
+                   __builtin_sqrtf(x[2]), __builtin_sqrtf(x[3])};
+#endif
+    }
+    static v2d f(v2d x, v2d y, v2d z) {
+#ifdef X86
+        return (v2d)_mm_sqrt_pd((__m128d)x);
+#elif defined AARCH64
+        return (v2d)vsqrtq_f64((float64x2_t)x);
+#else
+        return v2d{__builtin_sqrt(x[0]), __builtin_sqrt(x[1])};
+#endif
+    }
+};
+
+/* to the other precision */
+struct OpCvt {
+    static double f(float x, float y, float z) { return x; }
+    static float f(double x, double y, double z) { return (float)x; }
+    static v2d f(v4f x, v4f y, v4f z) {
+#ifdef X86
+        return (v2d)_mm_cvtps_pd((__m128)x);
+#elif defined AARCH64
+        return (v2d)vcvt_f64_f32(vget_low_f32((float32x4_t)x));
+#else
+        return v2d{x[0], x[1]};
+#endif
+    }
+    static v4f f(v2d x, v2d y, v2d z) {
+#ifdef X86
+        return (v4f)_mm_cvtpd_ps((__m128d)x);
+#elif defined AARCH64
+        return (v4f)vcombine_f32(vcvt_f32_f64((float64x2_t)x),
+                                 vdup_n_f32(0));
+#else
+        return v4f{(float)x[0], (float)x[1], 0, 0};
+#endif
+    }
+};
+
+#define FPU_KERNEL_BODY                                                        \
+    for (uint64_t i = 0; i < n; i++) {                                         \
+        REP8({                                                                 \
+            auto r = OP::f(x, y, z);                                           \
+            hide(r);                                                           \
+            hide(x);                                                           \
+        });                                                                    \
+    }
+
+/* n x 8 independent ops. hide(x) makes every op look new to the compiler,
+ * the CPU sees no dependency */
+template <typename T, typename OP> struct FPUKernel {
+    static void run(uint64_t n, T x, T y, T z) { FPU_KERNEL_BODY }
+};
+template <typename T> struct FPUKernel<T, OpFma> {
+    typedef OpFma OP;
+    FMA_TARGET static void run(uint64_t n, T x, T y, T z) { FPU_KERNEL_BODY }
+};
+
+template <typename E> struct FPLimits;
+template <> struct FPLimits<float> {
+    static constexpr int min_exp = -126;
+    static constexpr const char *name = "f32";
+};
+template <> struct FPLimits<double> {
+    static constexpr int min_exp = -1022;
+    static constexpr const char *name = "f64";
+};
+
+template <typename E> struct Operands {
+    E x, x_other_lanes, y, z;
+};
+
+/* false if op can't meet the class */
+template <typename E>
+bool make_operands(FOp op, OperandClass c, bool vector, Operands<E> *o) {
+    int emin = FPLimits<E>::min_exp;
+    E denormal = ldexp((E)1, emin - 10);
+
+    o->x = 1.5;
+    o->y = 1.25;
+    o->z = 0.5;
+
+    switch (c) {
+    case OperandClass::NORMAL:
+        break;
 
-        double x = l2d(v1);
-        double y = l2d(v2);
+    case OperandClass::DENORMAL_IN:
+        o->x = denormal;
+        break;
 
-        if ((x + y) == 0) {
-            /* lacks denormal support */
+    case OperandClass::MIXED_LANES:
+        if (!vector) {
             return false;
         }
+        o->x = denormal;
+        break;
+
+    case OperandClass::DENORMAL_OUT:
+        switch (op) {
+        case FOp::ADD:
+            /* 1.5 * 2^(emin+1) - 1.25 * 2^(emin+1) = 2^(emin-1) */
+            o->x = ldexp((E)1.5, emin + 1);
+            o->y = ldexp((E)-1.25, emin + 1);
+            break;
+        case FOp::MUL:
+        case FOp::FMA:
+            o->x = ldexp((E)1, emin / 2 - 5);
+            o->y = ldexp((E)1, emin - emin / 2 - 5);
+            o->z = 0;
+            break;
+        case FOp::DIV:
+            o->x = ldexp((E)1, emin + 10);
+            o->y = ldexp((E)1, 20);
+            break;
+        case FOp::CVT:
+            if (sizeof(E) != 8) {
+                return false;
+            }
+            /* normal in f64, denormal in f32 */
+            o->x = ldexp((E)1, FPLimits<float>::min_exp - 4);
+            break;
+        default:
+            return false;
+        }
+        break;
+
+    case OperandClass::NAN_IN:
+        o->x = NAN;
+        break;
+
+    case OperandClass::INF_IN:
+        o->x = INFINITY;
+        break;
+
+    default:
+        return false;
+    }
 
-        return true;
+    o->x_other_lanes = (c == OperandClass::MIXED_LANES) ? (E)1.5 : o->x;
+    return true;
+}
+
+template <typename T, typename E> T fill(E lane0, E rest) {
+    T v;
+    v[0] = lane0;
+    for (size_t i = 1; i < sizeof(T) / sizeof(E); i++) {
+        v[i] = rest;
+    }
+    return v;
+}
+template <> float fill<float, float>(float lane0, float rest) { return lane0; }
+template <> double fill<double, double>(double lane0, double rest) {
+    return lane0;
+}
+
+/* flushes denormal inputs and outputs to zero while alive */
+struct FlushDenormal {
+#ifdef X86
+    unsigned int saved;
+    FlushDenormal() {
+        saved = _mm_getcsr();
+        /* FTZ (bit 15) | DAZ (bit 6) */
+        _mm_setcsr(saved | (1 << 15) | (1 << 6));
+    }
+    ~FlushDenormal() { _mm_setcsr(saved); }
+    static bool available() { return true; }
+#elif defined AARCH64
+    uint64_t saved;
+    FlushDenormal() {
+        asm volatile("mrs %0, fpcr" : "=r"(saved));
+        /* FZ (bit 24) */
+        uint64_t v = saved | (1ULL << 24);
+        asm volatile("msr fpcr, %0" ::"r"(v));
     }
+    ~FlushDenormal() { asm volatile("msr fpcr, %0" ::"r"(saved)); }
+    static bool available() { return true; }
+#else
+    static bool available() { return false; }
+#endif
+};
+
+/* time per op in nsec */
+template <typename T, typename OP>
+double run_special(GlobalState const *g, T x, T y, T z, double duration) {
+    auto r = run_calibrated(
+        g, [x, y, z](uint64_t n) { FPUKernel<T, OP>::run(n, x, y, z); },
+        duration);
+
+    return (r.sec_per_unit() / 8) * 1e9;
+}
+
+template <typename T, typename E>
+double run_fop(GlobalState const *g, FOp op, OperandClass c, bool flush,
+               double duration) {
+    Operands<E> o;
+    bool vector = sizeof(T) != sizeof(E);
+
+    if (!make_operands<E>(op, c, vector, &o)) {
+        return 0;
+    }
+
+    T x = fill<T, E>(o.x, o.x_other_lanes);
+    T y = fill<T, E>(o.y, o.y);
+    T z = fill<T, E>(o.z, o.z);
+
+#if defined X86 || defined AARCH64
+    std::unique_ptr<FlushDenormal> fd;
+    if (flush) {
+        fd.reset(new FlushDenormal());
+    }
+#endif
+
+    switch (op) {
+    case FOp::ADD:
+        return run_special<T, OpAdd>(g, x, y, z, duration);
+    case FOp::MUL:
+        return run_special<T, OpMul>(g, x, y, z, duration);
+    case FOp::DIV:
+        return run_special<T, OpDiv>(g, x, y, z, duration);
+    case FOp::FMA:
+        return run_special<T, OpFma>(g, x, y, z, duration);
+    case FOp::SQRT:
+        return run_special<T, OpSqrt>(g, x, y, z, duration);
+    case FOp::CVT:
+        return run_special<T, OpCvt>(g, x, y, z, duration);
+    default:
+        return 0;
+    }
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> special_parent_t;
+
+struct FPUSpecial : public special_parent_t {
+    FPUSpecial() : special_parent_t("fpu-special", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.02, "measurement time per cell [sec]");
+    }
+
+    /* one row per operand class the op can meet */
+    template <typename T, typename E>
+    void add_rows(GlobalState const *g, std::vector<std::string> *labels,
+                  std::vector<std::vector<double>> *values, FOp op,
+                  int nmode) {
+        bool vector = sizeof(T) != sizeof(E);
+
+        for (int ci = 0; ci < (int)OperandClass::NUM_CLASS; ci++) {
+            Operands<E> o;
+            if (!make_operands<E>(op, (OperandClass)ci, vector, &o)) {
+                continue;
+            }
+
+            char buf[64];
+            sprintf(buf, "%s %s x%d %s", fop_name[(int)op],
+                    FPLimits<E>::name, (int)(sizeof(T) / sizeof(E)),
+                    operand_class_name[ci]);
+            labels->push_back(buf);
+
+            std::vector<double> v;
+            for (int mode = 0; mode < nmode; mode++) {
+                v.push_back(run_fop<T, E>(g, op, (OperandClass)ci, mode == 1,
+                                          param("duration")));
+            }
+            values->push_back(v);
+        }
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<FOp> ops;
+        for (int oi = 0; oi < (int)FOp::NUM_FOP; oi++) {
+#ifdef X86
+            if ((FOp)oi == FOp::FMA && !have_fma()) {
+                continue;
+            }
+#endif
+            ops.push_back((FOp)oi);
+        }
+
+        int nmode = FlushDenormal::available() ? 2 : 1;
+
+        std::vector<std::string> labels;
+        std::vector<std::vector<double>> values;
+        for (auto op : ops) {
+            add_rows<double, double>(g, &labels, &values, op, nmode);
+            add_rows<v2d, double>(g, &labels, &values, op, nmode);
+            add_rows<float, float>(g, &labels, &values, op, nmode);
+            add_rows<v4f, float>(g, &labels, &values, op, nmode);
+        }
+
+        auto t = new table_t("op operand [nsec]", "fp mode", labels.size(),
+                             nmode);
+        t->column_label[0] = "default";
+        if (nmode == 2) {
+            t->column_label[1] = "ftz";
+        }
+        for (size_t ri = 0; ri < labels.size(); ri++) {
+            t->row_label[ri] = labels[ri];
+            for (int mode = 0; mode < nmode; mode++) {
+                (*t)[ri][mode] = values[ri][mode];
+            }
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return have_denormal(); }
 };
 
 } // namespace
@@ -206,6 +623,9 @@ struct FPU : public parent_t{
 std::unique_ptr<BenchDesc> get_fpu_realtime_desc() {
     return std::unique_ptr<BenchDesc>(new FPU<true>(false));
 }
+std::unique_ptr<BenchDesc> get_fpu_special_desc() {
+    return std::unique_ptr<BenchDesc>(new FPUSpecial());
+}
 #ifdef HAVE_HW_PERF_COUNTER
 std::unique_ptr<BenchDesc> get_fpu_cycle_desc() {
     return std::unique_ptr<BenchDesc>(new FPU<true>(true));
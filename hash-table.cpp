@@ -0,0 +1,583 @@
+/* Associative containers.
+ *
+ * std::map, std::unordered_map and three open addressing tables:
+ *
+ * linear    : one state byte per slot, linear probing, max load 3/4
+ * quadratic : same, triangular (quadratic) probing
+ * swiss     : SwissTable style. 7bit hash tags in a control byte array,
+ *             a group of control bytes is matched at once (16 with SSE2 on
+ *             x86, 8 with SWAR elsewhere), max load 7/8
+ *
+ * All the hashed containers use the same hash. Keys are uint64 or 20 char
+ * strings (longer than the SSO buffer), the value is uint64.
+ *
+ * hit / hit-zipf : lookup of present keys, uniform or Zipf
+ * miss           : lookup of absent keys
+ * insert / erase : building the table from empty / erasing every key
+ * iterate        : visiting every element
+ * bytes/elem     : memory allocated by the container after the build,
+ *                  without the heap buffers of the string keys
+ */
+
+#include "simple-run.h"
+#include "stats.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "zipf.h"
+
+#include <map>
+#include <random>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#ifdef X86
+#include <emmintrin.h>
+#endif
+
+namespace smbm {
+
+namespace {
+
+size_t live_bytes = 0;
+
+template <typename T> struct CountingAllocator {
+    typedef T value_type;
+
+    CountingAllocator() {}
+    template <typename U> CountingAllocator(CountingAllocator<U> const &) {}
+
+    T *allocate(size_t n) {
+        live_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, size_t n) {
+        live_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U> bool operator==(CountingAllocator<U> const &) const {
+        return true;
+    }
+    template <typename U> bool operator!=(CountingAllocator<U> const &) const {
+        return false;
+    }
+};
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+struct Hash {
+    size_t operator()(uint64_t k) const { return mix64(k); }
+    size_t operator()(std::string const &k) const {
+        return mix64(std::hash<std::string>()(k));
+    }
+};
+
+template <typename K, typename M> struct StdTable {
+    M m;
+
+    uint64_t *find(K const &k) {
+        auto it = m.find(k);
+        return (it == m.end()) ? nullptr : &it->second;
+    }
+    void insert(K const &k, uint64_t v) { m[k] = v; }
+    void erase(K const &k) { m.erase(k); }
+    template <typename F> void for_each(F const &f) {
+        for (auto &e : m) {
+            f(e.second);
+        }
+    }
+};
+
+template <typename K>
+using StdMap =
+    StdTable<K, std::map<K, uint64_t, std::less<K>,
+                         CountingAllocator<std::pair<const K, uint64_t>>>>;
+
+template <typename K>
+using StdUnorderedMap =
+    StdTable<K, std::unordered_map<
+                    K, uint64_t, Hash, std::equal_to<K>,
+                    CountingAllocator<std::pair<const K, uint64_t>>>>;
+
+template <typename K> struct Slot {
+    K key;
+    uint64_t value;
+};
+
+enum class Probe { LINEAR, QUADRATIC };
+
+template <typename K, Probe P> struct OpenTable {
+    enum : uint8_t { EMPTY, FULL, DELETED };
+
+    std::vector<uint8_t, CountingAllocator<uint8_t>> state;
+    std::vector<Slot<K>, CountingAllocator<Slot<K>>> slots;
+    size_t mask, size, used; /* used counts the tombstones too */
+
+    OpenTable() { init(16); }
+
+    void init(size_t cap) {
+        state.assign(cap, EMPTY);
+        slots = std::vector<Slot<K>, CountingAllocator<Slot<K>>>(cap);
+        mask = cap - 1;
+        size = used = 0;
+    }
+
+    static size_t next(size_t i, size_t step) {
+        return i + ((P == Probe::LINEAR) ? 1 : step);
+    }
+
+    size_t find_index(K const &k) {
+        size_t i = Hash()(k) & mask;
+        for (size_t step = 1;; step++) {
+            uint8_t s = state[i];
+            if (s == EMPTY) {
+                return SIZE_MAX;
+            }
+            if (s == FULL && slots[i].key == k) {
+                return i;
+            }
+            i = next(i, step) & mask;
+        }
+    }
+
+    uint64_t *find(K const &k) {
+        size_t i = find_index(k);
+        return (i == SIZE_MAX) ? nullptr : &slots[i].value;
+    }
+
+    /* grows, or only drops the tombstones when they fill the table */
+    void rehash() {
+        size_t cap = mask + 1;
+        if ((size + 1) * 2 > cap) {
+            cap *= 2;
+        }
+
+        auto old_state = std::move(state);
+        auto old_slots = std::move(slots);
+        init(cap);
+
+        for (size_t i = 0; i < old_state.size(); i++) {
+            if (old_state[i] == FULL) {
+                insert(old_slots[i].key, old_slots[i].value);
+            }
+        }
+    }
+
+    void insert(K const &k, uint64_t v) {
+        if ((used + 1) * 4 > (mask + 1) * 3) {
+            rehash();
+        }
+
+        size_t i = Hash()(k) & mask, tomb = SIZE_MAX;
+        for (size_t step = 1;; step++) {
+            uint8_t s = state[i];
+            if (s == EMPTY) {
+                break;
+            }
+            if (s == FULL && slots[i].key == k) {
+                slots[i].value = v;
+                return;
+            }
+            if (s == DELETED && tomb == SIZE_MAX) {
+                tomb = i;
+            }
+            i = next(i, step) & mask;
+        }
+
+        if (tomb != SIZE_MAX) {
+            i = tomb;
+        } else {
+            used++;
+        }
+        state[i] = FULL;
+        slots[i].key = k;
+        slots[i].value = v;
+        size++;
+    }
+
+    void erase(K const &k) {
+        size_t i = find_index(k);
+        if (i != SIZE_MAX) {
+            state[i] = DELETED;
+            size--;
+        }
+    }
+
+    template <typename F> void for_each(F const &f) {
+        for (size_t i = 0; i <= mask; i++) {
+            if (state[i] == FULL) {
+                f(slots[i].value);
+            }
+        }
+    }
+};
+
+/* control bytes: EMPTY, DELETED, or the 7bit tag (h2) of a full slot. a
+ * match is a bitmask, bit index >> shift is the byte index */
+const int8_t CTRL_EMPTY = -128;
+const int8_t CTRL_DELETED = -2;
+
+#ifdef X86
+struct Group {
+    static constexpr int width = 16;
+    static constexpr int shift = 0;
+    __m128i v;
+
+    Group(int8_t const *p) : v(_mm_loadu_si128((__m128i const *)p)) {}
+
+    uint64_t match(int8_t h2) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), v));
+    }
+    uint64_t match_empty() const { return match(CTRL_EMPTY); }
+    uint64_t match_empty_or_deleted() const { return _mm_movemask_epi8(v); }
+};
+#else
+/* may report false positives in match(), the keys are compared anyway */
+struct Group {
+    static constexpr int width = 8;
+    static constexpr int shift = 3;
+    static constexpr uint64_t lsbs = 0x0101010101010101ULL;
+    static constexpr uint64_t msbs = 0x8080808080808080ULL;
+    uint64_t v;
+
+    Group(int8_t const *p) { memcpy(&v, p, sizeof(v)); }
+
+    uint64_t match(int8_t h2) const {
+        uint64_t x = v ^ (lsbs * (uint8_t)h2);
+        return (x - lsbs) & ~x & msbs;
+    }
+    uint64_t match_empty() const { return v & ~(v << 6) & msbs; }
+    uint64_t match_empty_or_deleted() const { return v & msbs; }
+};
+#endif
+
+template <typename K> struct SwissTable {
+    std::vector<int8_t, CountingAllocator<int8_t>> ctrl;
+    std::vector<Slot<K>, CountingAllocator<Slot<K>>> slots;
+    size_t mask, size, growth_left;
+
+    SwissTable() { init(16); }
+
+    /* ctrl has width extra bytes that mirror the first ones, so a group can
+     * be loaded at any position */
+    void init(size_t cap) {
+        ctrl.assign(cap + Group::width, CTRL_EMPTY);
+        slots = std::vector<Slot<K>, CountingAllocator<Slot<K>>>(cap);
+        mask = cap - 1;
+        size = 0;
+        growth_left = cap - cap / 8;
+    }
+
+    void set_ctrl(size_t i, int8_t c) {
+        ctrl[i] = c;
+        if (i < (size_t)Group::width) {
+            ctrl[mask + 1 + i] = c;
+        }
+    }
+
+    static int lowest(uint64_t m) { return __builtin_ctzll(m) >> Group::shift; }
+
+    size_t find_index(K const &k, size_t h) {
+        int8_t h2 = h & 0x7f;
+        size_t pos = (h >> 7) & mask;
+
+        for (size_t step = Group::width;; step += Group::width) {
+            Group g(&ctrl[pos]);
+            for (uint64_t m = g.match(h2); m; m &= m - 1) {
+                size_t i = (pos + lowest(m)) & mask;
+                if (slots[i].key == k) {
+                    return i;
+                }
+            }
+            if (g.match_empty()) {
+                return SIZE_MAX;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    size_t find_non_full(size_t h) {
+        size_t pos = (h >> 7) & mask;
+
+        for (size_t step = Group::width;; step += Group::width) {
+            uint64_t m = Group(&ctrl[pos]).match_empty_or_deleted();
+            if (m) {
+                return (pos + lowest(m)) & mask;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    uint64_t *find(K const &k) {
+        size_t i = find_index(k, Hash()(k));
+        return (i == SIZE_MAX) ? nullptr : &slots[i].value;
+    }
+
+    void insert_unique(K const &k, uint64_t v, size_t h) {
+        size_t i = find_non_full(h);
+        if (ctrl[i] == CTRL_EMPTY) {
+            growth_left--;
+        }
+        set_ctrl(i, h & 0x7f);
+        slots[i].key = k;
+        slots[i].value = v;
+        size++;
+    }
+
+    /* grows, or only drops the tombstones when they fill the table */
+    void rehash() {
+        size_t cap = mask + 1;
+        if ((size + 1) * 2 > cap) {
+            cap *= 2;
+        }
+
+        auto old_ctrl = std::move(ctrl);
+        auto old_slots = std::move(slots);
+        init(cap);
+
+        for (size_t i = 0; i < old_slots.size(); i++) {
+            if (old_ctrl[i] >= 0) {
+                auto &s = old_slots[i];
+                insert_unique(s.key, s.value, Hash()(s.key));
+            }
+        }
+    }
+
+    void insert(K const &k, uint64_t v) {
+        size_t h = Hash()(k);
+        size_t i = find_index(k, h);
+        if (i != SIZE_MAX) {
+            slots[i].value = v;
+            return;
+        }
+
+        if (growth_left == 0) {
+            rehash();
+        }
+        insert_unique(k, v, h);
+    }
+
+    void erase(K const &k) {
+        size_t i = find_index(k, Hash()(k));
+        if (i != SIZE_MAX) {
+            set_ctrl(i, CTRL_DELETED);
+            size--;
+        }
+    }
+
+    template <typename F> void for_each(F const &f) {
+        for (size_t i = 0; i <= mask; i++) {
+            if (ctrl[i] >= 0) {
+                f(slots[i].value);
+            }
+        }
+    }
+};
+
+enum Container { C_MAP, C_UNORDERED, C_LINEAR, C_QUADRATIC, C_SWISS, C_NUM };
+const char *container_name[] = {"std::map", "std::unordered_map", "linear",
+                                "quadratic", "swiss"};
+
+enum KeyType { K_INT, K_STRING, K_NUM };
+const char *key_type_name[] = {"int", "string"};
+
+enum Measure {
+    M_HIT,
+    M_HIT_ZIPF,
+    M_MISS,
+    M_INSERT,
+    M_ERASE,
+    M_ITERATE,
+    M_BYTES,
+    M_NUM
+};
+const char *measure_name[] = {"hit[ns]",   "hit-zipf[ns]", "miss[ns]",
+                              "insert[ns]", "erase[ns]",    "iterate[ns]",
+                              "bytes/elem"};
+
+inline void make_key(uint64_t *k, uint64_t i) { *k = mix64(i); }
+inline void make_key(std::string *k, uint64_t i) {
+    char buf[32];
+    sprintf(buf, "key-%016llx", (unsigned long long)mix64(i));
+    *k = buf;
+}
+
+template <typename K> struct Workload {
+    std::vector<K> keys, miss;
+    std::vector<uint32_t> uniform, zipf; /* indices into keys */
+
+    Workload(size_t n) : keys(n), miss(n) {
+        /* mix64 is a bijection, so the keys are distinct */
+        for (size_t i = 0; i < n; i++) {
+            make_key(&keys[i], i);
+            make_key(&miss[i], i + n);
+        }
+
+        std::mt19937_64 rand(1);
+        ZipfGenerator z(n);
+        size_t nq = 1 << 20;
+        for (size_t i = 0; i < nq; i++) {
+            uniform.push_back(rand() % n);
+            zipf.push_back(scatter_rank(z(rand), n));
+        }
+    }
+};
+
+template <typename Table, typename K>
+void measure(GlobalState const *g, Workload<K> const &w, double duration,
+             double *out) {
+    size_t n = w.keys.size();
+
+    /* insert and erase, each round starts from an empty table */
+    std::vector<double> ins, era;
+    double total = 0;
+    do {
+        Table t;
+        auto t0 = userland_timer_value::get();
+        for (size_t i = 0; i < n; i++) {
+            t.insert(w.keys[i], i);
+        }
+        auto t1 = userland_timer_value::get();
+        for (size_t i = 0; i < n; i++) {
+            t.erase(w.keys[i]);
+        }
+        auto t2 = userland_timer_value::get();
+
+        double si = g->userland_timer_delta_to_sec(t1 - t0);
+        double se = g->userland_timer_delta_to_sec(t2 - t1);
+        ins.push_back(si * 1e9 / n);
+        era.push_back(se * 1e9 / n);
+        total += si + se;
+    } while (total < duration);
+
+    out[M_INSERT] = median(ins);
+    out[M_ERASE] = median(era);
+
+    size_t base = live_bytes;
+    Table t;
+    for (size_t i = 0; i < n; i++) {
+        t.insert(w.keys[i], i);
+    }
+    out[M_BYTES] = (double)(live_bytes - base) / n;
+
+    size_t mask = w.uniform.size() - 1;
+    auto lookup = [&](std::vector<K> const &keys,
+                      std::vector<uint32_t> const &q) {
+        auto cr = run_calibrated(
+            g,
+            [&](uint64_t count) {
+                uint64_t sum = 0;
+                for (uint64_t i = 0; i < count; i++) {
+                    uint64_t *v = t.find(keys[q[i & mask]]);
+                    sum += v ? *v : 1;
+                }
+                g->dummy_write(0, sum);
+            },
+            duration);
+        return cr.sec_per_unit() * 1e9;
+    };
+
+    out[M_HIT] = lookup(w.keys, w.uniform);
+    out[M_HIT_ZIPF] = lookup(w.keys, w.zipf);
+    out[M_MISS] = lookup(w.miss, w.uniform);
+
+    auto cr = run_calibrated(
+        g,
+        [&](uint64_t count) {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                t.for_each([&sum](uint64_t v) { sum += v; });
+            }
+            g->dummy_write(0, sum);
+        },
+        duration);
+    out[M_ITERATE] = cr.sec_per_unit() * 1e9 / n;
+}
+
+template <typename K>
+void measure_all(GlobalState const *g, size_t n, double duration,
+                 double (*out)[M_NUM]) {
+    Workload<K> w(n);
+    measure<StdMap<K>>(g, w, duration, out[C_MAP]);
+    measure<StdUnorderedMap<K>>(g, w, duration, out[C_UNORDERED]);
+    measure<OpenTable<K, Probe::LINEAR>>(g, w, duration, out[C_LINEAR]);
+    measure<OpenTable<K, Probe::QUADRATIC>>(g, w, duration,
+                                            out[C_QUADRATIC]);
+    measure<SwissTable<K>>(g, w, duration, out[C_SWISS]);
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct HashTable : public parent_t {
+    HashTable() : parent_t("hash-table", LOWER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_MEMORY, TAG_LIBC};
+        add_param("max_elems", 4, "largest number of elements [Mi]");
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<size_t> sizes;
+        size_t max = (size_t)(param("max_elems") * 1024 * 1024);
+        for (size_t n = 1024; n <= max; n *= 16) {
+            sizes.push_back(n);
+        }
+        double duration = param("duration");
+
+        int nrow = K_NUM * C_NUM * sizes.size();
+        auto t = new table_t("container key elements", "measure", nrow,
+                             M_NUM);
+        for (int m = 0; m < M_NUM; m++) {
+            t->column_label[m] = measure_name[m];
+        }
+
+        int row = 0;
+        for (int k = 0; k < K_NUM; k++) {
+            for (size_t n : sizes) {
+                double out[C_NUM][M_NUM];
+                if (k == K_INT) {
+                    measure_all<uint64_t>(g, n, duration, out);
+                } else {
+                    measure_all<std::string>(g, n, duration, out);
+                }
+
+                for (int c = 0; c < C_NUM; c++) {
+                    char buf[128];
+                    if (n >= 1024 * 1024) {
+                        sprintf(buf, "%s %s %dMi", container_name[c],
+                                key_type_name[k], (int)(n / (1024 * 1024)));
+                    } else {
+                        sprintf(buf, "%s %s %dKi", container_name[c],
+                                key_type_name[k], (int)(n / 1024));
+                    }
+                    t->row_label[row] = buf;
+                    for (int m = 0; m < M_NUM; m++) {
+                        (*t)[row][m] = out[c][m];
+                    }
+                    row++;
+                }
+            }
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_hash_table_desc() {
+    return std::unique_ptr<BenchDesc>(new HashTable());
+}
+
+} // namespace smbm
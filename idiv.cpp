@@ -1,6 +1,15 @@
+#include "opaque.h"
+#include "stats.h"
 #include "sys-microbenchmark.h"
 #include "table.h"
 #include <algorithm>
+#include <math.h>
+
+#ifdef X86
+#include <immintrin.h>
+#elif defined AARCH64
+#include <arm_neon.h>
+#endif
 
 namespace smbm {
 
@@ -29,7 +38,8 @@ template <> auto convert_deltaval<false>(GlobalState const *g, uint64_t d) {
 typedef Table2DBenchDesc<double, uint32_t> parent_t;
 
 template <typename int_t, bool is_32, bool use_perf_counter>
-std::unique_ptr<BenchResult> run(GlobalState const *g) {
+std::unique_ptr<BenchResult> run(GlobalState const *g, int nloop,
+                                 int repeat) {
     int n_divider_bit = 63;
     int n_divisor_bit = 63;
 
@@ -50,27 +60,31 @@ std::unique_ptr<BenchResult> run(GlobalState const *g) {
 
     for (int divisor_bit = 0; divisor_bit <= n_divisor_bit; divisor_bit++) {
         for (int divider_bit = 1; divider_bit <= n_divider_bit; divider_bit++) {
-            int_t divisor = (int_t)((1ULL << divisor_bit) - 1);
-            int_t divider = (int_t)((1ULL << divider_bit) - 1);
-            int_t zero = g->getzero();
+            std::vector<double> results;
 
-            auto t0 = get_count<use_perf_counter>(g);
-            int nloop = 2048;
+            for (int ri = 0; ri < repeat; ri++) {
+                int_t divisor = (int_t)((1ULL << divisor_bit) - 1);
+                int_t divider = (int_t)((1ULL << divider_bit) - 1);
+                int_t zero = g->getzero();
 
-            for (int i = 0; i < nloop; i++) {
-                int_t x;
+                auto t0 = get_count<use_perf_counter>(g);
 
-                REP16(x = divisor / divider; x &= zero; divisor |= x;);
-            }
-            auto t1 = get_count<use_perf_counter>(g);
+                for (int i = 0; i < nloop; i++) {
+                    int_t x;
 
-            g->dummy_write(0, divisor);
+                    REP16(x = divisor / divider; x &= zero; divisor |= x;);
+                }
+                auto t1 = get_count<use_perf_counter>(g);
 
-            auto deltaval = convert_deltaval<use_perf_counter>(g, t1 - t0);
+                g->dummy_write(0, divisor);
 
-            double result = deltaval / (nloop * 16.0);
+                auto deltaval =
+                    convert_deltaval<use_perf_counter>(g, t1 - t0);
+
+                results.push_back(deltaval / (nloop * 16.0));
+            }
 
-            (*result_table)[divisor_bit][divider_bit - 1] = result;
+            (*result_table)[divisor_bit][divider_bit - 1] = median(results);
         }
     }
 
@@ -85,15 +99,21 @@ struct IDIV : public parent_t {
                    ? (is_32 ? "idiv32-cycle" : "idiv64-cycle")
                    : (is_32 ? "idiv32-realtime" : "idiv64-realtime"),
                    LOWER_IS_BETTER),
-          is_32(is_32) {}
+          is_32(is_32) {
+        tags = {TAG_CPU};
+        add_param("nloop", 2048, "loop count per cell (x16 divisions)");
+        add_param("repeat", 5, "runs per cell, the median is reported");
+    }
 
     result_t run(GlobalState const *g) override {
+        int nloop = param("nloop");
+        int repeat = std::max(1, (int)param("repeat"));
         if (is_32) {
             return smbm::run < uint32_t, true,
-                   use_perf_counter && static_available > (g);
+                   use_perf_counter && static_available > (g, nloop, repeat);
         } else {
             return smbm::run < uint64_t, false,
-                   use_perf_counter && static_available > (g);
+                   use_perf_counter && static_available > (g, nloop, repeat);
         }
     }
 
@@ -135,4 +155,397 @@ std::unique_ptr<BenchDesc> get_idiv64_cycle_desc() {
 }
 #endif
 
+/* Latency / throughput surface of division, modulo, multiply-high and FP
+ * div/sqrt over the operand magnitude.
+ *
+ * latency    : x = op(a, b); a |= x & zero. the cost of the and/or (or the
+ *              FP add/mul) is measured with op = identity and subtracted
+ * throughput : 8 of the above chains are interleaved
+ *
+ * Operands are all ones in the low bits (integer) or have that many
+ * significant mantissa bits (FP), so the magnitude is what varies. On x86,
+ * 8/16bit div and idiv are issued as such, the other widths are what the
+ * compiler emits for the C operators. 128bit div/mod are the library
+ * routines of the compiler. */
+
+namespace {
+
+#ifdef __SIZEOF_INT128__
+typedef unsigned __int128 u128_t;
+typedef __int128 s128_t;
+#endif
+
+/* a, made dependent on x */
+template <typename T> inline T chain(T a, T x, T zero) {
+    return a | (x & zero);
+}
+inline float chain(float a, float x, float zero) { return a + x * zero; }
+inline double chain(double a, double x, double zero) { return a + x * zero; }
+inline v4f chain(v4f a, v4f x, v4f zero) { return a + x * zero; }
+inline v2d chain(v2d a, v2d x, v2d zero) { return a + x * zero; }
+
+struct OpIdentity {
+    template <typename T> static T f(T a, T b) { return a; }
+};
+
+struct OpDiv {
+    template <typename T> static T f(T a, T b) { return a / b; }
+};
+struct OpMod {
+    template <typename T> static T f(T a, T b) { return a % b; }
+};
+
+#ifdef X86
+/* the C operators promote 8/16bit (and signed in particular) to 32bit */
+template <bool mod> inline uint8_t x86_div(uint8_t a, uint8_t b) {
+    uint16_t ax = a;
+    asm("divb %1" : "+a"(ax) : "q"(b) : "cc");
+    return mod ? (ax >> 8) : (ax & 0xff);
+}
+template <bool mod> inline int8_t x86_div(int8_t a, int8_t b) {
+    int16_t ax = a;
+    asm("idivb %1" : "+a"(ax) : "q"(b) : "cc");
+    return mod ? (ax >> 8) : (ax & 0xff);
+}
+template <bool mod> inline uint16_t x86_div(uint16_t a, uint16_t b) {
+    uint16_t dx = 0;
+    asm("divw %2" : "+a"(a), "+d"(dx) : "r"(b) : "cc");
+    return mod ? dx : a;
+}
+template <bool mod> inline int16_t x86_div(int16_t a, int16_t b) {
+    int16_t dx;
+    asm("cwtd\n\tidivw %2" : "+a"(a), "=&d"(dx) : "r"(b) : "cc");
+    return mod ? dx : a;
+}
+
+#define X86_DIV(T)                                                             \
+    template <> T OpDiv::f<T>(T a, T b) { return x86_div<false>(a, b); }      \
+    template <> T OpMod::f<T>(T a, T b) { return x86_div<true>(a, b); }
+
+X86_DIV(uint8_t)
+X86_DIV(int8_t)
+X86_DIV(uint16_t)
+X86_DIV(int16_t)
+#endif
+
+template <typename T> struct Wider;
+template <> struct Wider<uint8_t> { typedef uint16_t type; };
+template <> struct Wider<int8_t> { typedef int16_t type; };
+template <> struct Wider<uint16_t> { typedef uint32_t type; };
+template <> struct Wider<int16_t> { typedef int32_t type; };
+template <> struct Wider<uint32_t> { typedef uint64_t type; };
+template <> struct Wider<int32_t> { typedef int64_t type; };
+#ifdef __SIZEOF_INT128__
+template <> struct Wider<uint64_t> { typedef u128_t type; };
+template <> struct Wider<int64_t> { typedef s128_t type; };
+#endif
+
+struct OpMulHi {
+    template <typename T> static T f(T a, T b) {
+        typedef typename Wider<T>::type W;
+        return (T)(((W)a * (W)b) >> (sizeof(T) * 8));
+    }
+};
+
+struct OpFDiv {
+    template <typename T> static T f(T a, T b) { return a / b; }
+};
+
+struct OpSqrt {
+    template <typename T> static T f(T a, T b);
+};
+template <> float OpSqrt::f<float>(float a, float b) {
+    return __builtin_sqrtf(a);
+}
+template <> double OpSqrt::f<double>(double a, double b) {
+    return __builtin_sqrt(a);
+}
+template <> v4f OpSqrt::f<v4f>(v4f a, v4f b) {
+#ifdef X86
+    return (v4f)_mm_sqrt_ps((__m128)a);
+#elif defined AARCH64
+    return (v4f)vsqrtq_f32((float32x4_t)a);
+#else
+    return v4f{__builtin_sqrtf(a[0]), __builtin_sqrtf(a[1]),
+               __builtin_sqrtf(a[2]), __builtin_sqrtf(a[3])};
+#endif
+}
+template <> v2d OpSqrt::f<v2d>(v2d a, v2d b) {
+#ifdef X86
+    return (v2d)_mm_sqrt_pd((__m128d)a);
+#elif defined AARCH64
+    return (v2d)vsqrtq_f64((float64x2_t)a);
+#else
+    return v2d{__builtin_sqrt(a[0]), __builtin_sqrt(a[1])};
+#endif
+}
+
+/* operand with `bits` significant bits (1 <= bits <= value_bits) */
+template <typename T> struct Operand {
+    static constexpr int value_bits =
+        sizeof(T) * 8 - (((T)-1 < (T)0) ? 1 : 0);
+    static T make(int bits) {
+        T v = 0;
+        for (int i = 0; i < bits; i++) {
+            v = (T)((v << 1) | 1);
+        }
+        return v;
+    }
+};
+
+template <typename F> struct FPOperand {
+    static constexpr int value_bits = (sizeof(F) == 4) ? 24 : 53;
+    /* in [1, 2) */
+    static F make(int bits) {
+        F m = Operand<uint64_t>::make(bits);
+        return ldexp(m, 1 - bits);
+    }
+};
+template <> struct Operand<float> : public FPOperand<float> {};
+template <> struct Operand<double> : public FPOperand<double> {};
+
+template <typename T, typename E> struct VecOperand {
+    static constexpr int value_bits = Operand<E>::value_bits;
+    static T make(int bits) {
+        T v = {};
+        for (size_t i = 0; i < sizeof(T) / sizeof(E); i++) {
+            v[i] = Operand<E>::make(bits);
+        }
+        return v;
+    }
+};
+template <> struct Operand<v4f> : public VecOperand<v4f, float> {};
+template <> struct Operand<v2d> : public VecOperand<v2d, double> {};
+
+template <typename T> struct Zero {
+    static T get(GlobalState const *g) { return (T)g->getzero(); }
+};
+template <> struct Zero<v4f> {
+    static v4f get(GlobalState const *g) {
+        return v4f{} + (float)g->getzero();
+    }
+};
+template <> struct Zero<v2d> {
+    static v2d get(GlobalState const *g) {
+        return v2d{} + (double)g->getzero();
+    }
+};
+
+template <typename T, typename OP, bool use_perf_counter>
+double run_op_once(GlobalState const *g, bool latency, T a0, T b, int nloop) {
+    T zero = Zero<T>::get(g);
+
+    T a[8];
+    for (int i = 0; i < 8; i++) {
+        a[i] = a0;
+        hide(a[i]);
+    }
+    hide(b);
+
+    auto t0 = get_count<use_perf_counter>(g);
+
+    if (latency) {
+        T x = a[0];
+        for (int i = 0; i < nloop; i++) {
+            REP8(x = OP::f(x, b); x = chain(a[0], x, zero););
+        }
+        a[0] = x;
+    } else {
+        for (int i = 0; i < nloop; i++) {
+#define DIV_THROUGHPUT_LANE(L) a[L] = chain(a[L], OP::f(a[L], b), zero);
+            DIV_THROUGHPUT_LANE(0)
+            DIV_THROUGHPUT_LANE(1)
+            DIV_THROUGHPUT_LANE(2)
+            DIV_THROUGHPUT_LANE(3)
+            DIV_THROUGHPUT_LANE(4)
+            DIV_THROUGHPUT_LANE(5)
+            DIV_THROUGHPUT_LANE(6)
+            DIV_THROUGHPUT_LANE(7)
+        }
+    }
+
+    auto t1 = get_count<use_perf_counter>(g);
+
+    for (int i = 0; i < 8; i++) {
+        hide(a[i]);
+    }
+
+    return convert_deltaval<use_perf_counter>(g, t1 - t0) / (nloop * 8.0);
+}
+
+template <typename T, typename OP, bool use_perf_counter>
+double run_op(GlobalState const *g, bool latency, T a, T b, int nloop,
+              int repeat) {
+    std::vector<double> v;
+
+    run_op_once<T, OP, use_perf_counter>(g, latency, a, b, nloop);
+    for (int i = 0; i < repeat; i++) {
+        v.push_back(
+            run_op_once<T, OP, use_perf_counter>(g, latency, a, b, nloop));
+    }
+
+    return median(v);
+}
+
+struct DivSurfaceConfig {
+    int nloop;
+    int repeat;
+    int nmag; /* dividend magnitudes, k/nmag of the value bits */
+    bool use_cycle;
+};
+
+typedef Table2DBenchDesc<double, std::string, int> surface_parent_t;
+
+struct DivSurfaceRows {
+    std::vector<std::string> label;
+    std::vector<std::vector<double>> value;
+};
+
+template <typename T, typename OP, bool use_perf_counter>
+void add_rows_mode(GlobalState const *g, DivSurfaceConfig const &c,
+                   DivSurfaceRows *rows, const char *op_name,
+                   const char *type_name, bool use_b) {
+    int vb = Operand<T>::value_bits;
+    std::vector<int> b_frac = {1, 4, 8}; /* /8 */
+    if (!use_b) {
+        b_frac = {8};
+    }
+
+    for (int latency = 1; latency >= 0; latency--) {
+        double base = 0;
+        if (latency) {
+            T one = Operand<T>::make(1);
+            base = run_op<T, OpIdentity, use_perf_counter>(
+                g, true, one, one, c.nloop, c.repeat);
+        }
+
+        for (int bf : b_frac) {
+            int b_bits = std::max(1, vb * bf / 8);
+            T b = Operand<T>::make(b_bits);
+
+            char buf[128];
+            if (use_b) {
+                sprintf(buf, "%s %s %s b=%dbit", op_name, type_name,
+                        latency ? "lat" : "tput", b_bits);
+            } else {
+                sprintf(buf, "%s %s %s", op_name, type_name,
+                        latency ? "lat" : "tput");
+            }
+
+            std::vector<double> row;
+            for (int mi = 1; mi <= c.nmag; mi++) {
+                int a_bits = std::max(1, vb * mi / c.nmag);
+                T a = Operand<T>::make(a_bits);
+
+                double v = run_op<T, OP, use_perf_counter>(
+                    g, latency, a, b, c.nloop, c.repeat);
+                row.push_back(std::max(0.0, v - base));
+            }
+
+            rows->label.push_back(buf);
+            rows->value.push_back(row);
+        }
+    }
+}
+
+template <bool use_perf_counter>
+void add_all_rows(GlobalState const *g, DivSurfaceConfig const &c,
+                  DivSurfaceRows *r) {
+#define ADD_INT_ROWS(OP, name, use_b)                                          \
+    add_rows_mode<uint8_t, OP, use_perf_counter>(g, c, r, name, "u8", use_b);  \
+    add_rows_mode<int8_t, OP, use_perf_counter>(g, c, r, name, "s8", use_b);   \
+    add_rows_mode<uint16_t, OP, use_perf_counter>(g, c, r, name, "u16",        \
+                                                  use_b);                      \
+    add_rows_mode<int16_t, OP, use_perf_counter>(g, c, r, name, "s16", use_b); \
+    add_rows_mode<uint32_t, OP, use_perf_counter>(g, c, r, name, "u32",        \
+                                                  use_b);                      \
+    add_rows_mode<int32_t, OP, use_perf_counter>(g, c, r, name, "s32", use_b); \
+    add_rows_mode<uint64_t, OP, use_perf_counter>(g, c, r, name, "u64",        \
+                                                  use_b);                      \
+    add_rows_mode<int64_t, OP, use_perf_counter>(g, c, r, name, "s64", use_b);
+
+    ADD_INT_ROWS(OpDiv, "div", true);
+#ifdef __SIZEOF_INT128__
+    add_rows_mode<u128_t, OpDiv, use_perf_counter>(g, c, r, "div", "u128",
+                                                   true);
+    add_rows_mode<s128_t, OpDiv, use_perf_counter>(g, c, r, "div", "s128",
+                                                   true);
+#endif
+
+    ADD_INT_ROWS(OpMod, "mod", true);
+#ifdef __SIZEOF_INT128__
+    add_rows_mode<u128_t, OpMod, use_perf_counter>(g, c, r, "mod", "u128",
+                                                   true);
+    add_rows_mode<s128_t, OpMod, use_perf_counter>(g, c, r, "mod", "s128",
+                                                   true);
+#endif
+
+#ifdef __SIZEOF_INT128__
+    ADD_INT_ROWS(OpMulHi, "mulhi", true);
+#endif
+
+#define ADD_FP_ROWS(OP, name, use_b)                                           \
+    add_rows_mode<float, OP, use_perf_counter>(g, c, r, name, "f32", use_b);   \
+    add_rows_mode<double, OP, use_perf_counter>(g, c, r, name, "f64", use_b);  \
+    add_rows_mode<v4f, OP, use_perf_counter>(g, c, r, name, "f32x4", use_b);   \
+    add_rows_mode<v2d, OP, use_perf_counter>(g, c, r, name, "f64x2", use_b);
+
+    ADD_FP_ROWS(OpFDiv, "fdiv", true);
+    ADD_FP_ROWS(OpSqrt, "sqrt", false);
+}
+
+struct DivSurface : public surface_parent_t {
+    DivSurface() : surface_parent_t("div-surface", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("nloop", 512, "loop count per cell (x8 operations)");
+        add_param("repeat", 5, "runs per cell, the median is reported");
+        add_param("magnitudes", 8, "number of dividend magnitudes");
+    }
+
+    result_t run(GlobalState const *g) override {
+        DivSurfaceConfig c;
+        c.nloop = std::max(1, (int)param("nloop"));
+        c.repeat = std::max(1, (int)param("repeat"));
+        c.nmag = std::max(1, (int)param("magnitudes"));
+        c.use_cycle = g->is_hw_perf_counter_available();
+
+        DivSurfaceRows rows;
+
+#ifdef HAVE_HW_PERF_COUNTER
+        if (c.use_cycle) {
+            add_all_rows<true>(g, c, &rows);
+        } else {
+            add_all_rows<false>(g, c, &rows);
+        }
+#else
+        add_all_rows<false>(g, c, &rows);
+#endif
+
+        auto table = new table_t(c.use_cycle ? "op [cycle]" : "op [nsec]",
+                                 "a [% of value bits]", rows.label.size(),
+                                 c.nmag);
+        for (int mi = 1; mi <= c.nmag; mi++) {
+            table->column_label[mi - 1] = mi * 100 / c.nmag;
+        }
+        for (size_t ri = 0; ri < rows.label.size(); ri++) {
+            table->row_label[ri] = rows.label[ri];
+            for (int mi = 0; mi < c.nmag; mi++) {
+                (*table)[ri][mi] = rows.value[ri][mi];
+            }
+        }
+
+        return result_t(table);
+    }
+
+    int double_precision() override { return 1; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_div_surface_desc() {
+    return std::unique_ptr<BenchDesc>(new DivSurface());
+}
+
 } // namespace smbm
@@ -0,0 +1,146 @@
+/* AArch64 opcode table for insn-table.cpp.
+ *
+ * Each entry is a base encoding and the register fields it uses. The chain
+ * register goes to Rd and Rn (and Ra), the constant source to Rm.
+ */
+
+enum class Form {
+    RD_RN,       /* op a, a */
+    RD_RN_RM,    /* op a, a, s */
+    RD_RN_RM_RA, /* op a, a, s, a */
+};
+
+struct A64Op {
+    const char *name;
+    RegFile file;
+    uint32_t base;
+    Form form;
+};
+
+// clang-format off
+static const A64Op a64_ops[] = {
+    {"add",          RegFile::GPR, 0x8b000000, Form::RD_RN_RM},
+    {"sub",          RegFile::GPR, 0xcb000000, Form::RD_RN_RM},
+    {"and",          RegFile::GPR, 0x8a000000, Form::RD_RN_RM},
+    {"orr",          RegFile::GPR, 0xaa000000, Form::RD_RN_RM},
+    {"eor",          RegFile::GPR, 0xca000000, Form::RD_RN_RM},
+    {"adc",          RegFile::GPR, 0x9a000000, Form::RD_RN_RM},
+    {"csel",         RegFile::GPR, 0x9a800000, Form::RD_RN_RM},
+    {"lslv",         RegFile::GPR, 0x9ac02000, Form::RD_RN_RM},
+    {"rorv",         RegFile::GPR, 0x9ac02c00, Form::RD_RN_RM},
+    {"mul",          RegFile::GPR, 0x9b007c00, Form::RD_RN_RM},
+    {"madd",         RegFile::GPR, 0x9b000000, Form::RD_RN_RM_RA},
+    {"smulh",        RegFile::GPR, 0x9b407c00, Form::RD_RN_RM},
+    {"umulh",        RegFile::GPR, 0x9bc07c00, Form::RD_RN_RM},
+    {"sdiv",         RegFile::GPR, 0x9ac00c00, Form::RD_RN_RM},
+    {"udiv",         RegFile::GPR, 0x9ac00800, Form::RD_RN_RM},
+    {"clz",          RegFile::GPR, 0xdac01000, Form::RD_RN},
+    {"rbit",         RegFile::GPR, 0xdac00000, Form::RD_RN},
+    {"rev",          RegFile::GPR, 0xdac00c00, Form::RD_RN},
+
+    {"fadd d",       RegFile::VEC, 0x1e602800, Form::RD_RN_RM},
+    {"fmul d",       RegFile::VEC, 0x1e600800, Form::RD_RN_RM},
+    {"fdiv d",       RegFile::VEC, 0x1e601800, Form::RD_RN_RM},
+    {"fmadd d",      RegFile::VEC, 0x1f400000, Form::RD_RN_RM_RA},
+    {"fsqrt d",      RegFile::VEC, 0x1e61c000, Form::RD_RN},
+    {"fadd s",       RegFile::VEC, 0x1e202800, Form::RD_RN_RM},
+
+    {"fadd 4s",      RegFile::VEC, 0x4e20d400, Form::RD_RN_RM},
+    {"fadd 2d",      RegFile::VEC, 0x4e60d400, Form::RD_RN_RM},
+    {"fmul 4s",      RegFile::VEC, 0x6e20dc00, Form::RD_RN_RM},
+    {"fmul 2d",      RegFile::VEC, 0x6e60dc00, Form::RD_RN_RM},
+    {"fmla 4s",      RegFile::VEC, 0x4e20cc00, Form::RD_RN_RM},
+    {"fmla 2d",      RegFile::VEC, 0x4e60cc00, Form::RD_RN_RM},
+    {"fdiv 4s",      RegFile::VEC, 0x6e20fc00, Form::RD_RN_RM},
+    {"fdiv 2d",      RegFile::VEC, 0x6e60fc00, Form::RD_RN_RM},
+    {"fsqrt 4s",     RegFile::VEC, 0x6ea1f800, Form::RD_RN},
+    {"fsqrt 2d",     RegFile::VEC, 0x6ee1f800, Form::RD_RN},
+    {"frecpe 4s",    RegFile::VEC, 0x4ea1d800, Form::RD_RN},
+    {"fmax 4s",      RegFile::VEC, 0x4e20f400, Form::RD_RN_RM},
+    {"fmin 4s",      RegFile::VEC, 0x4ea0f400, Form::RD_RN_RM},
+    {"scvtf 4s",     RegFile::VEC, 0x4e21d800, Form::RD_RN},
+    {"fcvtzs 4s",    RegFile::VEC, 0x4ea1b800, Form::RD_RN},
+
+    {"add 16b",      RegFile::VEC, 0x4e208400, Form::RD_RN_RM},
+    {"add 4s",       RegFile::VEC, 0x4ea08400, Form::RD_RN_RM},
+    {"add 2d",       RegFile::VEC, 0x4ee08400, Form::RD_RN_RM},
+    {"sub 4s",       RegFile::VEC, 0x6ea08400, Form::RD_RN_RM},
+    {"mul 4s",       RegFile::VEC, 0x4ea09c00, Form::RD_RN_RM},
+    {"mla 4s",       RegFile::VEC, 0x4ea09400, Form::RD_RN_RM},
+    {"sqrdmulh 4s",  RegFile::VEC, 0x6ea0b400, Form::RD_RN_RM},
+    {"and 16b",      RegFile::VEC, 0x4e201c00, Form::RD_RN_RM},
+    {"orr 16b",      RegFile::VEC, 0x4ea01c00, Form::RD_RN_RM},
+    {"eor 16b",      RegFile::VEC, 0x6e201c00, Form::RD_RN_RM},
+    {"shl 4s",       RegFile::VEC, 0x4f235400, Form::RD_RN},
+    {"cnt 16b",      RegFile::VEC, 0x4e205800, Form::RD_RN},
+    {"addv 4s",      RegFile::VEC, 0x4eb1b800, Form::RD_RN},
+    {"tbl 16b",      RegFile::VEC, 0x4e000000, Form::RD_RN_RM},
+    {"zip1 4s",      RegFile::VEC, 0x4e803800, Form::RD_RN_RM},
+    {"uzp1 4s",      RegFile::VEC, 0x4e801800, Form::RD_RN_RM},
+    {"ext 16b #8",   RegFile::VEC, 0x6e004000, Form::RD_RN_RM},
+};
+// clang-format on
+
+/* chain registers. x0 is the loop counter of pipe-aarch64.h, v8-v15 are
+ * callee saved */
+static std::vector<int> const insn_gpr_dst = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+static int const insn_gpr_src = 11;
+static std::vector<int> const insn_vec_dst = {0, 1,  2,  3,  4,  5,
+                                              6, 7, 16, 17, 18, 19};
+static int const insn_vec_src = 31;
+
+static void emit_a64(char *&p, A64Op const &op, int a, int s) {
+    uint32_t v = op.base | a | (a << 5);
+
+    if (op.form != Form::RD_RN) {
+        v |= s << 16;
+    }
+    if (op.form == Form::RD_RN_RM_RA) {
+        v |= a << 10;
+    }
+
+    *(uint32_t *)p = v;
+    p += 4;
+}
+
+static void insn_list(std::vector<InsnRow> *rows) {
+    for (auto &&op : a64_ops) {
+        A64Op const *opp = &op;
+        bool fp64 = strstr(op.name, " d") || strstr(op.name, " 2d");
+        bool fma =
+            !strncmp(op.name, "fmla", 4) || !strncmp(op.name, "fmadd", 5);
+        bool div = !strcmp(op.name, "sdiv") || !strcmp(op.name, "udiv");
+        rows->push_back({op.name, op.file,
+                         [opp](char *&p, int a, int s) {
+                             emit_a64(p, *opp, a, s);
+                         },
+                         fp64, fma, div});
+    }
+}
+
+/* chain registers start from 1, the source is 3. sdiv / udiv divide
+ * INT64_MAX by 1, which stays INT64_MAX and never takes the early out of a
+ * small dividend. vector registers are 1.0 in every lane, in the precision
+ * of the row, the source of FMA is 0.0 */
+static void gen_insn_setup(char *&p, InsnRow const &row) {
+    for (int r : insn_gpr_dst) {
+        gen_setimm64(p, r, row.div ? INT64_MAX : 1);
+    }
+    gen_setimm64(p, insn_gpr_src, row.div ? 1 : 3);
+
+    std::vector<int> vregs = insn_vec_dst;
+    vregs.push_back(insn_vec_src);
+
+    for (int r : vregs) {
+        /* fmov vN.2d, #1.0 / fmov vN.4s, #1.0 */
+        *(uint32_t *)p = (row.fp64 ? 0x6f03f600 : 0x4f03f600) | r;
+        p += 4;
+    }
+    if (row.fma) {
+        /* movi vN.2d, #0 */
+        *(uint32_t *)p = 0x6f00e400 | insn_vec_src;
+        p += 4;
+    }
+}
+
+static void gen_insn_cleanup(char *&p) {}
@@ -0,0 +1,500 @@
+/* x86 opcode table for insn-table.cpp.
+ *
+ * Each entry is an encoding (prefix, opcode map, opcode, modrm.reg
+ * extension, imm8, W) plus how the operands form a chain (Dep). Vector
+ * entries are instantiated as legacy SSE xmm, VEX xmm/ymm and EVEX zmm
+ * rows, depending on the forms and the features of the local CPU.
+ */
+
+enum class Dep {
+    DST, /* op a, s (VEX/EVEX : op a, a, s). a is read and written */
+    SRC, /* op a, a. the destination is write only */
+};
+
+enum {
+    F_SSE = 1 << 0,  /* legacy SSE xmm */
+    F_V128 = 1 << 1, /* VEX xmm */
+    F_V256 = 1 << 2, /* VEX ymm */
+    F_INT = 1 << 3,  /* integer op, VEX ymm needs AVX2 */
+
+    F_SSE_AVX = F_SSE | F_V128 | F_V256,
+    F_SSE_AVX2 = F_SSE | F_V128 | F_V256 | F_INT,
+    F_AVX = F_V128 | F_V256,
+};
+
+struct GprOp {
+    const char *name;
+    bool (*feature)(); /* nullptr : x86-64 baseline */
+    bool vex;
+    uint8_t pp; /* mandatory prefix, 0, 0x66, 0xf3 or 0xf2 */
+    uint8_t map; /* 0 : one byte, 1 : 0F, 2 : 0F38, 3 : 0F3A */
+    uint8_t opcode;
+    int8_t ext;  /* modrm.reg extension (/digit), -1 if reg is an operand */
+    int16_t imm; /* imm8, -1 if none */
+    Dep dep;
+};
+
+struct VecOp {
+    const char *name; /* SSE mnemonic, VEX/EVEX rows prepend 'v' */
+    uint8_t pp;
+    uint8_t map;
+    uint8_t opcode;
+    int8_t ext;
+    int16_t imm;
+    bool w;
+    Dep dep;
+    unsigned forms;
+    bool (*feature)();      /* nullptr : SSE2 for F_SSE, AVX for VEX */
+    bool (*evex_feature)(); /* zmm row if set and true */
+};
+
+static bool have_gfni_avx512() { return have_gfni() && have_avx512f(); }
+
+// clang-format off
+static const GprOp gpr_ops[] = {
+    {"add",    nullptr,    false, 0,    0, 0x03, -1, -1, Dep::DST},
+    {"sub",    nullptr,    false, 0,    0, 0x2b, -1, -1, Dep::DST},
+    {"and",    nullptr,    false, 0,    0, 0x23, -1, -1, Dep::DST},
+    {"or",     nullptr,    false, 0,    0, 0x0b, -1, -1, Dep::DST},
+    {"xor",    nullptr,    false, 0,    0, 0x33, -1, -1, Dep::DST},
+    {"adc",    nullptr,    false, 0,    0, 0x13, -1, -1, Dep::DST},
+    {"sbb",    nullptr,    false, 0,    0, 0x1b, -1, -1, Dep::DST},
+    {"mov",    nullptr,    false, 0,    0, 0x8b, -1, -1, Dep::SRC},
+    {"imul",   nullptr,    false, 0,    1, 0xaf, -1, -1, Dep::DST},
+    {"imul-imm", nullptr,  false, 0,    0, 0x6b, -1,  3, Dep::SRC},
+    {"cmovz",  nullptr,    false, 0,    1, 0x44, -1, -1, Dep::DST},
+    {"bsf",    nullptr,    false, 0,    1, 0xbc, -1, -1, Dep::SRC},
+    {"bsr",    nullptr,    false, 0,    1, 0xbd, -1, -1, Dep::SRC},
+    {"shl",    nullptr,    false, 0,    0, 0xc1,  4,  3, Dep::DST},
+    {"shr",    nullptr,    false, 0,    0, 0xc1,  5,  3, Dep::DST},
+    {"sar",    nullptr,    false, 0,    0, 0xc1,  7,  3, Dep::DST},
+    {"rol",    nullptr,    false, 0,    0, 0xc1,  0,  3, Dep::DST},
+    {"ror",    nullptr,    false, 0,    0, 0xc1,  1,  3, Dep::DST},
+    {"not",    nullptr,    false, 0,    0, 0xf7,  2, -1, Dep::DST},
+    {"neg",    nullptr,    false, 0,    0, 0xf7,  3, -1, Dep::DST},
+    {"inc",    nullptr,    false, 0,    0, 0xff,  0, -1, Dep::DST},
+    {"dec",    nullptr,    false, 0,    0, 0xff,  1, -1, Dep::DST},
+    {"popcnt", have_popcnt, false, 0xf3, 1, 0xb8, -1, -1, Dep::SRC},
+    {"lzcnt",  have_lzcnt, false, 0xf3, 1, 0xbd, -1, -1, Dep::SRC},
+    {"tzcnt",  have_bmi1,  false, 0xf3, 1, 0xbc, -1, -1, Dep::SRC},
+    {"crc32",  have_sse42, false, 0xf2, 2, 0xf1, -1, -1, Dep::DST},
+    {"andn",   have_bmi1,  true,  0,    2, 0xf2, -1, -1, Dep::DST},
+    {"bzhi",   have_bmi2,  true,  0,    2, 0xf5, -1, -1, Dep::DST},
+    {"pdep",   have_bmi2,  true,  0xf2, 2, 0xf5, -1, -1, Dep::DST},
+    {"pext",   have_bmi2,  true,  0xf3, 2, 0xf5, -1, -1, Dep::DST},
+    {"shlx",   have_bmi2,  true,  0x66, 2, 0xf7, -1, -1, Dep::DST},
+    {"shrx",   have_bmi2,  true,  0xf2, 2, 0xf7, -1, -1, Dep::DST},
+    {"sarx",   have_bmi2,  true,  0xf3, 2, 0xf7, -1, -1, Dep::DST},
+    {"rorx",   have_bmi2,  true,  0xf2, 3, 0xf0, -1,  3, Dep::SRC},
+};
+
+static const VecOp vec_ops[] = {
+    /* floating point */
+    {"addps",      0,    1, 0x58, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"addpd",      0x66, 1, 0x58, -1, -1,   1, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"addss",      0xf3, 1, 0x58, -1, -1,   0, Dep::DST, F_SSE | F_V128, nullptr, nullptr},
+    {"addsd",      0xf2, 1, 0x58, -1, -1,   1, Dep::DST, F_SSE | F_V128, nullptr, nullptr},
+    {"subps",      0,    1, 0x5c, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"mulps",      0,    1, 0x59, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"mulpd",      0x66, 1, 0x59, -1, -1,   1, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"mulss",      0xf3, 1, 0x59, -1, -1,   0, Dep::DST, F_SSE | F_V128, nullptr, nullptr},
+    {"mulsd",      0xf2, 1, 0x59, -1, -1,   1, Dep::DST, F_SSE | F_V128, nullptr, nullptr},
+    {"divps",      0,    1, 0x5e, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"divpd",      0x66, 1, 0x5e, -1, -1,   1, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"divss",      0xf3, 1, 0x5e, -1, -1,   0, Dep::DST, F_SSE | F_V128, nullptr, nullptr},
+    {"divsd",      0xf2, 1, 0x5e, -1, -1,   1, Dep::DST, F_SSE | F_V128, nullptr, nullptr},
+    {"minps",      0,    1, 0x5d, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"maxpd",      0x66, 1, 0x5f, -1, -1,   1, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"sqrtps",     0,    1, 0x51, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"sqrtpd",     0x66, 1, 0x51, -1, -1,   1, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"rcpps",      0,    1, 0x53, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, nullptr},
+    {"rsqrtps",    0,    1, 0x52, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, nullptr},
+    {"andps",      0,    1, 0x54, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512dq},
+    {"andpd",      0x66, 1, 0x54, -1, -1,   1, Dep::DST, F_SSE_AVX, nullptr, have_avx512dq},
+    {"orps",       0,    1, 0x56, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512dq},
+    {"xorps",      0,    1, 0x57, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512dq},
+    {"shufps",     0,    1, 0xc6, -1, 0x1b, 0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"unpcklps",   0,    1, 0x14, -1, -1,   0, Dep::DST, F_SSE_AVX, nullptr, have_avx512f},
+    {"blendps",    0x66, 3, 0x0c, -1, 0x5,  0, Dep::DST, F_SSE_AVX, have_sse41, nullptr},
+    {"dpps",       0x66, 3, 0x40, -1, 0xff, 0, Dep::DST, F_SSE_AVX, have_sse41, nullptr},
+    {"roundps",    0x66, 3, 0x08, -1, 0x1,  0, Dep::SRC, F_SSE_AVX, have_sse41, nullptr},
+    {"movaps",     0,    1, 0x28, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"cvtdq2ps",   0,    1, 0x5b, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"cvtps2dq",   0x66, 1, 0x5b, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"cvttps2dq",  0xf3, 1, 0x5b, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"cvtps2pd",   0,    1, 0x5a, -1, -1,   0, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+    {"cvtpd2ps",   0x66, 1, 0x5a, -1, -1,   1, Dep::SRC, F_SSE_AVX, nullptr, have_avx512f},
+
+    /* integer */
+    {"paddb",      0x66, 1, 0xfc, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"paddw",      0x66, 1, 0xfd, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"paddd",      0x66, 1, 0xfe, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"paddq",      0x66, 1, 0xd4, -1, -1,   1, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"psubd",      0x66, 1, 0xfa, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"pmullw",     0x66, 1, 0xd5, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pmulld",     0x66, 2, 0x40, -1, -1,   0, Dep::DST, F_SSE_AVX2, have_sse41, have_avx512f},
+    {"pmuludq",    0x66, 1, 0xf4, -1, -1,   1, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"pmuldq",     0x66, 2, 0x28, -1, -1,   1, Dep::DST, F_SSE_AVX2, have_sse41, have_avx512f},
+    {"pmaddwd",    0x66, 1, 0xf5, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pmaddubsw",  0x66, 2, 0x04, -1, -1,   0, Dep::DST, F_SSE_AVX2, have_ssse3, have_avx512bw},
+    {"psadbw",     0x66, 1, 0xf6, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pavgb",      0x66, 1, 0xe0, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pminub",     0x66, 1, 0xda, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pmaxsw",     0x66, 1, 0xee, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pminsd",     0x66, 2, 0x39, -1, -1,   0, Dep::DST, F_SSE_AVX2, have_sse41, have_avx512f},
+    {"pmaxsd",     0x66, 2, 0x3d, -1, -1,   0, Dep::DST, F_SSE_AVX2, have_sse41, have_avx512f},
+    {"pabsd",      0x66, 2, 0x1e, -1, -1,   0, Dep::SRC, F_SSE_AVX2, have_ssse3, have_avx512f},
+    {"pcmpeqd",    0x66, 1, 0x76, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, nullptr},
+    {"pcmpgtd",    0x66, 1, 0x66, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, nullptr},
+    {"pcmpgtq",    0x66, 2, 0x37, -1, -1,   0, Dep::DST, F_SSE_AVX2, have_sse42, nullptr},
+    {"pand",       0x66, 1, 0xdb, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, nullptr},
+    {"pandn",      0x66, 1, 0xdf, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, nullptr},
+    {"por",        0x66, 1, 0xeb, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, nullptr},
+    {"pxor",       0x66, 1, 0xef, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, nullptr},
+    {"movdqa",     0x66, 1, 0x6f, -1, -1,   0, Dep::SRC, F_SSE_AVX2, nullptr, nullptr},
+    {"psllw",      0x66, 1, 0x71,  6, 3,    0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pslld",      0x66, 1, 0x72,  6, 3,    0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"psrld",      0x66, 1, 0x72,  2, 3,    0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"psrad",      0x66, 1, 0x72,  4, 3,    0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"psllq",      0x66, 1, 0x73,  6, 3,    1, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"psrlq",      0x66, 1, 0x73,  2, 3,    1, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"pslldq",     0x66, 1, 0x73,  7, 3,    0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"psrldq",     0x66, 1, 0x73,  3, 3,    0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pshufb",     0x66, 2, 0x00, -1, -1,   0, Dep::DST, F_SSE_AVX2, have_ssse3, have_avx512bw},
+    {"pshufd",     0x66, 1, 0x70, -1, 0x1b, 0, Dep::SRC, F_SSE_AVX2, nullptr, have_avx512f},
+    {"pshuflw",    0xf2, 1, 0x70, -1, 0x1b, 0, Dep::SRC, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"palignr",    0x66, 3, 0x0f, -1, 4,    0, Dep::DST, F_SSE_AVX2, have_ssse3, have_avx512bw},
+    {"pblendw",    0x66, 3, 0x0e, -1, 0x55, 0, Dep::DST, F_SSE_AVX2, have_sse41, nullptr},
+    {"punpcklbw",  0x66, 1, 0x60, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"punpckldq",  0x66, 1, 0x62, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"punpcklqdq", 0x66, 1, 0x6c, -1, -1,   1, Dep::DST, F_SSE_AVX2, nullptr, have_avx512f},
+    {"packssdw",   0x66, 1, 0x6b, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"packuswb",   0x66, 1, 0x67, -1, -1,   0, Dep::DST, F_SSE_AVX2, nullptr, have_avx512bw},
+    {"pmovzxbw",   0x66, 2, 0x30, -1, -1,   0, Dep::SRC, F_SSE_AVX2, have_sse41, have_avx512bw},
+    {"pmovsxdq",   0x66, 2, 0x25, -1, -1,   0, Dep::SRC, F_SSE_AVX2, have_sse41, have_avx512f},
+    {"phminposuw", 0x66, 2, 0x41, -1, -1,   0, Dep::SRC, F_SSE | F_V128, have_sse41, nullptr},
+    {"pclmulqdq",  0x66, 3, 0x44, -1, 0,    0, Dep::DST, F_SSE | F_V128, have_pclmulqdq, nullptr},
+    {"aesenc",     0x66, 2, 0xdc, -1, -1,   0, Dep::DST, F_SSE | F_V128, have_aes, nullptr},
+    {"aesdec",     0x66, 2, 0xde, -1, -1,   0, Dep::DST, F_SSE | F_V128, have_aes, nullptr},
+
+    /* AVX, FMA, AVX2 */
+    {"fmadd231ps",  0x66, 2, 0xb8, -1, -1,   0, Dep::DST, F_AVX, have_fma, have_avx512f},
+    {"fmadd231pd",  0x66, 2, 0xb8, -1, -1,   1, Dep::DST, F_AVX, have_fma, have_avx512f},
+    {"fmadd231ss",  0x66, 2, 0xb9, -1, -1,   0, Dep::DST, F_V128, have_fma, nullptr},
+    {"fmadd231sd",  0x66, 2, 0xb9, -1, -1,   1, Dep::DST, F_V128, have_fma, nullptr},
+    {"fnmadd231ps", 0x66, 2, 0xbc, -1, -1,   0, Dep::DST, F_AVX, have_fma, have_avx512f},
+    {"permilps",    0x66, 3, 0x04, -1, 0x1b, 0, Dep::SRC, F_AVX, nullptr, have_avx512f},
+    {"permilps-var", 0x66, 2, 0x0c, -1, -1,   0, Dep::DST, F_AVX, nullptr, have_avx512f},
+    {"perm2f128",   0x66, 3, 0x06, -1, 0x21, 0, Dep::DST, F_V256, nullptr, nullptr},
+    {"perm2i128",   0x66, 3, 0x46, -1, 0x21, 0, Dep::DST, F_V256, have_avx2, nullptr},
+    {"insertf128",  0x66, 3, 0x18, -1, 1,    0, Dep::DST, F_V256, nullptr, nullptr},
+    {"inserti128",  0x66, 3, 0x38, -1, 1,    0, Dep::DST, F_V256, have_avx2, nullptr},
+    {"permps",      0x66, 2, 0x16, -1, -1,   0, Dep::DST, F_V256, have_avx2, have_avx512f},
+    {"permd",       0x66, 2, 0x36, -1, -1,   0, Dep::DST, F_V256, have_avx2, have_avx512f},
+    {"permq",       0x66, 3, 0x00, -1, 0x1b, 1, Dep::SRC, F_V256, have_avx2, have_avx512f},
+    {"permpd",      0x66, 3, 0x01, -1, 0x1b, 1, Dep::SRC, F_V256, have_avx2, have_avx512f},
+    {"broadcastss", 0x66, 2, 0x18, -1, -1,   0, Dep::SRC, F_AVX, have_avx2, have_avx512f},
+    {"pbroadcastb", 0x66, 2, 0x78, -1, -1,   0, Dep::SRC, F_AVX, have_avx2, have_avx512bw},
+    {"pbroadcastd", 0x66, 2, 0x58, -1, -1,   0, Dep::SRC, F_AVX, have_avx2, have_avx512f},
+    {"psllvd",      0x66, 2, 0x47, -1, -1,   0, Dep::DST, F_AVX, have_avx2, have_avx512f},
+    {"psllvq",      0x66, 2, 0x47, -1, -1,   1, Dep::DST, F_AVX, have_avx2, have_avx512f},
+    {"psrlvd",      0x66, 2, 0x45, -1, -1,   0, Dep::DST, F_AVX, have_avx2, have_avx512f},
+    {"psravd",      0x66, 2, 0x46, -1, -1,   0, Dep::DST, F_AVX, have_avx2, have_avx512f},
+    {"cvtph2ps",    0x66, 2, 0x13, -1, -1,   0, Dep::SRC, F_AVX, have_f16c, have_avx512f},
+
+    /* AVX-512 */
+    {"pternlogd",   0x66, 3, 0x25, -1, 0x96, 0, Dep::DST, 0, nullptr, have_avx512f},
+    {"pternlogq",   0x66, 3, 0x25, -1, 0x96, 1, Dep::DST, 0, nullptr, have_avx512f},
+    {"pandd",       0x66, 1, 0xdb, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"pandq",       0x66, 1, 0xdb, -1, -1,   1, Dep::DST, 0, nullptr, have_avx512f},
+    {"pord",        0x66, 1, 0xeb, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"pxord",       0x66, 1, 0xef, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"movdqa32",    0x66, 1, 0x6f, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512f},
+    {"movdqu8",     0xf2, 1, 0x6f, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512bw},
+    {"prold",       0x66, 1, 0x72,  1, 3,    0, Dep::DST, 0, nullptr, have_avx512f},
+    {"prolvd",      0x66, 2, 0x15, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"permi2d",     0x66, 2, 0x76, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"permt2ps",    0x66, 2, 0x7f, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"permt2w",     0x66, 2, 0x7d, -1, -1,   1, Dep::DST, 0, nullptr, have_avx512bw},
+    {"permw",       0x66, 2, 0x8d, -1, -1,   1, Dep::DST, 0, nullptr, have_avx512bw},
+    {"permb",       0x66, 2, 0x8d, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512vbmi},
+    {"shuff32x4",   0x66, 3, 0x23, -1, 0x1b, 0, Dep::DST, 0, nullptr, have_avx512f},
+    {"shufi64x2",   0x66, 3, 0x43, -1, 0x1b, 1, Dep::DST, 0, nullptr, have_avx512f},
+    {"alignd",      0x66, 3, 0x03, -1, 3,    0, Dep::DST, 0, nullptr, have_avx512f},
+    {"pexpandd",    0x66, 2, 0x89, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512f},
+    {"pconflictd",  0x66, 2, 0xc4, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512cd},
+    {"plzcntd",     0x66, 2, 0x44, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512cd},
+    {"plzcntq",     0x66, 2, 0x44, -1, -1,   1, Dep::SRC, 0, nullptr, have_avx512cd},
+    {"popcntd",     0x66, 2, 0x55, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512vpopcntdq},
+    {"popcntq",     0x66, 2, 0x55, -1, -1,   1, Dep::SRC, 0, nullptr, have_avx512vpopcntdq},
+    {"popcntb",     0x66, 2, 0x54, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512bitalg},
+    {"pmullq",      0x66, 2, 0x40, -1, -1,   1, Dep::DST, 0, nullptr, have_avx512dq},
+    {"rcp14ps",     0x66, 2, 0x4c, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512f},
+    {"rcp14pd",     0x66, 2, 0x4c, -1, -1,   1, Dep::SRC, 0, nullptr, have_avx512f},
+    {"rsqrt14ps",   0x66, 2, 0x4e, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512f},
+    {"getexpps",    0x66, 2, 0x42, -1, -1,   0, Dep::SRC, 0, nullptr, have_avx512f},
+    {"scalefps",    0x66, 2, 0x2c, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512f},
+    {"rndscaleps",  0x66, 3, 0x08, -1, 1,    0, Dep::SRC, 0, nullptr, have_avx512f},
+    {"reduceps",    0x66, 3, 0x56, -1, 1,    0, Dep::SRC, 0, nullptr, have_avx512dq},
+    {"rangeps",     0x66, 3, 0x50, -1, 1,    0, Dep::DST, 0, nullptr, have_avx512dq},
+    {"cvtqq2pd",    0xf3, 1, 0xe6, -1, -1,   1, Dep::SRC, 0, nullptr, have_avx512dq},
+    {"pmadd52luq",  0x66, 2, 0xb4, -1, -1,   1, Dep::DST, 0, nullptr, have_avx512ifma},
+    {"pmadd52huq",  0x66, 2, 0xb5, -1, -1,   1, Dep::DST, 0, nullptr, have_avx512ifma},
+    {"pdpbusd",     0x66, 2, 0x50, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512vnni},
+    {"pdpwssd",     0x66, 2, 0x52, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512vnni},
+    {"pshldd",      0x66, 3, 0x71, -1, 3,    0, Dep::DST, 0, nullptr, have_avx512vbmi2},
+    {"pshldvd",     0x66, 2, 0x71, -1, -1,   0, Dep::DST, 0, nullptr, have_avx512vbmi2},
+    {"gf2p8affineqb", 0x66, 3, 0xce, -1, 0, 1, Dep::DST, 0, nullptr, have_gfni_avx512},
+    {"gf2p8mulb",   0x66, 2, 0xcf, -1, -1,   0, Dep::DST, 0, nullptr, have_gfni_avx512},
+};
+// clang-format on
+
+/* chain registers. rax is the loop counter of pipe-x86.h */
+static std::vector<int> const insn_gpr_dst = {RCX, RDX, RBX, RSI, RDI,
+                                              R8,  R9,  R10, R11, R14};
+static int const insn_gpr_src = R15;
+static std::vector<int> const insn_vec_dst = {0, 1, 2, 3, 4,  5,
+                                              6, 7, 8, 9, 10, 11};
+static int const insn_vec_src = 15;
+
+static void emit_map(char *&p, int map) {
+    if (map >= 1) {
+        *(p++) = 0x0f;
+    }
+    if (map == 2) {
+        *(p++) = 0x38;
+    } else if (map == 3) {
+        *(p++) = 0x3a;
+    }
+}
+
+static void emit_modrm_imm(char *&p, int reg, int rm, int imm) {
+    *(p++) = 0xc0 | ((reg & 7) << 3) | (rm & 7);
+    if (imm >= 0) {
+        *(p++) = imm;
+    }
+}
+
+static int vex_pp(uint8_t pp) {
+    switch (pp) {
+    case 0x66:
+        return 1;
+    case 0xf3:
+        return 2;
+    case 0xf2:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+static void emit_legacy(char *&p, uint8_t pp, int map, uint8_t opcode, bool w,
+                        int reg, int rm, int imm) {
+    if (pp) {
+        *(p++) = pp;
+    }
+
+    uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40) {
+        *(p++) = rex;
+    }
+
+    emit_map(p, map);
+    *(p++) = opcode;
+    emit_modrm_imm(p, reg, rm, imm);
+}
+
+/* 3 byte VEX. vvvv=0 for an unused vvvv (encoded as 1111) */
+static void emit_vex(char *&p, uint8_t pp, int map, uint8_t opcode, bool w,
+                     int l, int reg, int vvvv, int rm, int imm) {
+    *(p++) = 0xc4;
+    *(p++) = (((~reg >> 3) & 1) << 7) | (1 << 6) | (((~rm >> 3) & 1) << 5) |
+             map;
+    *(p++) = (w << 7) | ((~vvvv & 15) << 3) | (l << 2) | vex_pp(pp);
+    *(p++) = opcode;
+    emit_modrm_imm(p, reg, rm, imm);
+}
+
+/* EVEX, 512bit, no masking, registers 0..15 */
+static void emit_evex(char *&p, uint8_t pp, int map, uint8_t opcode, bool w,
+                      int reg, int vvvv, int rm, int imm) {
+    *(p++) = 0x62;
+    *(p++) = (((~reg >> 3) & 1) << 7) | (1 << 6) | (((~rm >> 3) & 1) << 5) |
+             (1 << 4) | map;
+    *(p++) = (w << 7) | ((~vvvv & 15) << 3) | (1 << 2) | vex_pp(pp);
+    *(p++) = (2 << 5) | (1 << 3);
+    *(p++) = opcode;
+    emit_modrm_imm(p, reg, rm, imm);
+}
+
+enum class VecEnc { SSE, VEX128, VEX256, EVEX512 };
+
+static void emit_vec(char *&p, VecOp const &op, VecEnc enc, int a, int s) {
+    int reg = a, vvvv = a, rm = s;
+
+    if (op.ext >= 0) {
+        reg = op.ext;
+        rm = a;
+    } else if (op.dep == Dep::SRC) {
+        vvvv = 0;
+        rm = a;
+    }
+
+    switch (enc) {
+    case VecEnc::SSE:
+        emit_legacy(p, op.pp, op.map, op.opcode, false, reg, rm, op.imm);
+        break;
+    case VecEnc::VEX128:
+    case VecEnc::VEX256:
+        emit_vex(p, op.pp, op.map, op.opcode, op.w, enc == VecEnc::VEX256,
+                 reg, vvvv, rm, op.imm);
+        break;
+    case VecEnc::EVEX512:
+        emit_evex(p, op.pp, op.map, op.opcode, op.w, reg, vvvv, rm, op.imm);
+        break;
+    }
+}
+
+static void emit_gpr(char *&p, GprOp const &op, int a, int s) {
+    int reg = a, vvvv = a, rm = s;
+
+    if (op.ext >= 0) {
+        reg = op.ext;
+        rm = a;
+    } else if (op.dep == Dep::SRC) {
+        vvvv = 0;
+        rm = a;
+    }
+
+    if (op.vex) {
+        emit_vex(p, op.pp, op.map, op.opcode, true, 0, reg, vvvv, rm, op.imm);
+    } else {
+        emit_legacy(p, op.pp, op.map, op.opcode, true, reg, rm, op.imm);
+    }
+}
+
+static void insn_list(std::vector<InsnRow> *rows) {
+    for (auto &&op : gpr_ops) {
+        if (op.feature && !op.feature()) {
+            continue;
+        }
+
+        GprOp const *opp = &op;
+        rows->push_back({op.name, RegFile::GPR, [opp](char *&p, int a, int s) {
+                             emit_gpr(p, *opp, a, s);
+                         }});
+    }
+
+    bool avx = have_avx();
+    bool avx2 = have_avx2();
+
+    for (auto &&op : vec_ops) {
+        bool base = !op.feature || op.feature();
+        std::vector<std::pair<std::string, VecEnc>> forms;
+
+        if ((op.forms & F_SSE) && base) {
+            forms.push_back({std::string(op.name) + " xmm", VecEnc::SSE});
+        }
+        if (avx && base) {
+            if (op.forms & F_V128) {
+                forms.push_back(
+                    {std::string("v") + op.name + " xmm", VecEnc::VEX128});
+            }
+            if ((op.forms & F_V256) && (!(op.forms & F_INT) || avx2)) {
+                forms.push_back(
+                    {std::string("v") + op.name + " ymm", VecEnc::VEX256});
+            }
+        }
+        if (op.evex_feature && op.evex_feature()) {
+            forms.push_back(
+                {std::string("v") + op.name + " zmm", VecEnc::EVEX512});
+        }
+
+        VecOp const *opp = &op;
+        bool fma = strstr(op.name, "madd231") != nullptr;
+        for (auto &&f : forms) {
+            VecEnc enc = f.second;
+            rows->push_back({f.first, RegFile::VEC,
+                             [opp, enc](char *&p, int a, int s) {
+                                 emit_vec(p, *opp, enc, a, s);
+                             },
+                             op.w, fma});
+        }
+    }
+}
+
+/* mov r32, imm32 (zero extended) */
+static void emit_mov_imm32(char *&p, int r, uint32_t imm) {
+    if (r >= 8) {
+        *(p++) = 0x41;
+    }
+    *(p++) = 0xb8 | (r & 7);
+    memcpy(p, &imm, 4);
+    p += 4;
+}
+
+/* chain registers start from 1, the source is 3, so that divisions are not
+ * by zero. vector registers are 1.0 in every lane, in the precision of the
+ * row, so that div, sqrt and rcp chains keep normal operands. the source of
+ * FMA is 0.0, a = a * 0 + a does not grow to Inf. */
+static void gen_insn_setup(char *&p, InsnRow const &row) {
+    for (int r : insn_gpr_dst) {
+        emit_mov_imm32(p, r, 1);
+    }
+    emit_mov_imm32(p, insn_gpr_src, 3);
+
+    uint64_t one = row.fp64 ? 0x3ff0000000000000ULL : 0x3f8000003f800000ULL;
+    int src = insn_vec_src;
+
+    /* mov rax, imm64 (rax is set again by loop_start) */
+    *(p++) = 0x48;
+    *(p++) = 0xb8;
+    memcpy(p, &one, 8);
+    p += 8;
+
+    if (have_avx512f()) {
+        /* vmovq xmm, rax ; vpunpcklqdq xmm, xmm, xmm ;
+         * vinsertf128 ymm, ymm, xmm, 1 ; vinsertf64x4 zmm, zmm, ymm, 1 */
+        emit_vex(p, 0x66, 1, 0x6e, true, 0, src, 0, RAX, -1);
+        emit_vex(p, 0x66, 1, 0x6c, false, 0, src, src, src, -1);
+        emit_vex(p, 0x66, 3, 0x18, false, 1, src, src, src, 1);
+        emit_evex(p, 0x66, 3, 0x1a, true, src, src, src, 1);
+        for (int r : insn_vec_dst) {
+            /* vmovaps zmm, zmm */
+            emit_evex(p, 0, 1, 0x28, false, r, 0, src, -1);
+        }
+        if (row.fma) {
+            /* vxorps ymm, ymm, ymm, clears the upper half of zmm too */
+            emit_vex(p, 0, 1, 0x57, false, 1, src, src, src, -1);
+        }
+    } else if (have_avx()) {
+        emit_vex(p, 0x66, 1, 0x6e, true, 0, src, 0, RAX, -1);
+        emit_vex(p, 0x66, 1, 0x6c, false, 0, src, src, src, -1);
+        emit_vex(p, 0x66, 3, 0x18, false, 1, src, src, src, 1);
+        for (int r : insn_vec_dst) {
+            /* vmovaps ymm, ymm */
+            emit_vex(p, 0, 1, 0x28, false, 1, r, 0, src, -1);
+        }
+        if (row.fma) {
+            /* vxorps ymm, ymm, ymm */
+            emit_vex(p, 0, 1, 0x57, false, 1, src, src, src, -1);
+        }
+    } else {
+        /* movq xmm, rax ; punpcklqdq xmm, xmm */
+        emit_legacy(p, 0x66, 1, 0x6e, true, src, RAX, -1);
+        emit_legacy(p, 0x66, 1, 0x6c, false, src, src, -1);
+        for (int r : insn_vec_dst) {
+            /* movaps xmm, xmm */
+            emit_legacy(p, 0, 1, 0x28, false, r, src, -1);
+        }
+    }
+}
+
+static void gen_insn_cleanup(char *&p) {
+    if (have_avx()) {
+        /* vzeroupper */
+        *(p++) = 0xc5;
+        *(p++) = 0xf8;
+        *(p++) = 0x77;
+    }
+}
@@ -0,0 +1,193 @@
+/* instruction latency / throughput table, generated from the opcode tables
+ * in insn-table-{x86,aarch64}.h.
+ *
+ * latency    : every instruction reads and writes the same register
+ * throughput : the destination rotates over independent registers
+ */
+
+#include "cpu-feature.h"
+#include "memalloc.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include <functional>
+#include <limits.h>
+#include <string.h>
+#include <vector>
+
+#include "barrier.h"
+
+#ifdef X86
+#include "pipe-x86.h"
+#elif defined AARCH64
+#include "pipe-aarch64.h"
+#endif
+
+namespace smbm {
+
+#if ((defined X86) || (defined AARCH64)) && (defined HAVE_DYNAMIC_CODE_GENERATOR)
+#define INSN_TABLE_AVAILABLE
+#endif
+
+namespace {
+
+#ifdef INSN_TABLE_AVAILABLE
+
+enum class RegFile { GPR, VEC };
+
+/* emit() writes one instruction whose result goes to chain register a.
+ * s is a register that is never written. */
+struct InsnRow {
+    std::string name;
+    RegFile file;
+    std::function<void(char *&p, int a, int s)> emit;
+    bool fp64 = false; /* FP operands are double */
+    bool fma = false;  /* a = a * s + a. s is 0.0, so that a does not grow */
+    bool div = false;  /* integer a = a / s. a is large and s is 1 */
+};
+
+#ifdef X86
+#include "insn-table-x86.h"
+#else
+#include "insn-table-aarch64.h"
+#endif
+
+struct InsnLoop {
+    ExecutableMemory m;
+    int ninsn;
+
+    static constexpr int loop_count = 1024;
+    static constexpr size_t code_size = 1024 * 1024;
+
+    InsnLoop() { m = alloc_exeutable(code_size); }
+    ~InsnLoop() { free_executable(&m); }
+
+    void gen(InsnRow const &row, bool latency) {
+        auto &dst = (row.file == RegFile::GPR) ? insn_gpr_dst : insn_vec_dst;
+        int src = (row.file == RegFile::GPR) ? insn_gpr_src : insn_vec_src;
+
+        int nreg = latency ? 1 : dst.size();
+        ninsn = nreg * 8;
+        if (latency) {
+            ninsn = 96;
+        }
+
+        char *p = (char *)m.p;
+        enter_frame(p, callee_saved_int_regs, callee_saved_fp_regs);
+        gen_insn_setup(p, row);
+
+        loop_start(p, loop_count);
+        char *start = p;
+
+        for (int i = 0; i < ninsn; i++) {
+            row.emit(p, dst[i % nreg], src);
+        }
+
+        loop_end(p, start);
+
+        gen_insn_cleanup(p);
+        exit_frame(p, callee_saved_int_regs, callee_saved_fp_regs);
+
+        isync(m.p, p);
+    }
+
+    void run_func() {
+        typedef void (*fp_t)(void);
+        fp_t func = (fp_t)m.p;
+        func();
+    }
+
+    /* cycle (or nsec without perf counter) per instruction, min of ntry */
+    double run(GlobalState const *g) {
+        run_func();
+
+        int ntry = 4;
+        uint64_t min = ULLONG_MAX;
+        bool use_cycle = g->is_hw_perf_counter_available();
+
+        for (int i = 0; i < ntry; i++) {
+            uint64_t d;
+            if (use_cycle) {
+#ifdef HAVE_HW_PERF_COUNTER
+                auto c0 = g->get_hw_cpucycle();
+                run_func();
+                auto c1 = g->get_hw_cpucycle();
+                d = c1 - c0;
+#else
+                d = 0;
+#endif
+            } else {
+                auto c0 = userland_timer_value::get();
+                run_func();
+                auto c1 = userland_timer_value::get();
+                d = c1 - c0;
+            }
+
+            min = std::min(min, d);
+        }
+
+        double n = (double)loop_count * ninsn;
+
+        if (use_cycle) {
+            return min / n;
+        }
+        return (1e9 * g->userland_timer_delta_to_sec(min)) / n;
+    }
+};
+
+#endif
+
+struct InsnTable : public Table2DBenchDesc<double, std::string, std::string> {
+    typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+    InsnTable() : parent_t("insn-table", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+    }
+
+    result_t run(GlobalState const *g) override {
+#ifdef INSN_TABLE_AVAILABLE
+        std::vector<InsnRow> rows;
+        insn_list(&rows);
+
+        const char *unit =
+            g->is_hw_perf_counter_available() ? "[cycle]" : "[nsec]";
+
+        auto ret = new table_t("instruction", "measure", rows.size(), 2);
+        ret->column_label[0] = std::string("latency") + unit;
+        ret->column_label[1] = std::string("recip-throughput") + unit;
+
+        InsnLoop loop;
+
+        for (size_t ri = 0; ri < rows.size(); ri++) {
+            ret->row_label[ri] = rows[ri].name;
+
+            loop.gen(rows[ri], true);
+            (*ret)[ri][0] = loop.run(g);
+
+            loop.gen(rows[ri], false);
+            (*ret)[ri][1] = loop.run(g);
+        }
+
+        return result_t(ret);
+#else
+        return nullptr;
+#endif
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(GlobalState const *g) override {
+#ifdef INSN_TABLE_AVAILABLE
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_insn_table_desc() {
+    return std::unique_ptr<BenchDesc>(new InsnTable());
+}
+
+} // namespace smbm
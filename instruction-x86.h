@@ -13,10 +13,14 @@ struct pause : public no_arg {
     void run(void *) { __asm__ __volatile__("pause" ::: "memory"); }
 };
 struct rdtsc : public no_arg {
-    void run(void *) { __asm__ __volatile__("rdtsc" ::: "memory"); }
+    void run(void *) {
+        __asm__ __volatile__("rdtsc" ::: "eax", "edx", "memory");
+    }
 };
 struct rdtscp : public no_arg {
-    void run(void *) { __asm__ __volatile__("rdtscp" ::: "memory"); }
+    void run(void *) {
+        __asm__ __volatile__("rdtscp" ::: "eax", "ecx", "edx", "memory");
+    }
 };
 struct use_1line {
     void *alloc_arg() {
@@ -27,7 +27,10 @@ namespace {
 typedef Table1DBenchDesc<double, std::string> parent_t;
 
 struct Instruction : public parent_t {
-    Instruction() : parent_t("instruction", LOWER_IS_BETTER) {}
+    Instruction() : parent_t("instruction", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+        add_param("duration", 0.1, "measurement time per test [sec]");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         int count = 0;
@@ -55,7 +58,10 @@ struct Instruction : public parent_t {
 #define RUN(F, T)                                                              \
     if (T()) {                                                                 \
         F t;                                                                   \
-        (*result)[count++] = run_test_unroll32(g, &t);                         \
+        double err = -1;                                                       \
+        (*result)[count] =                                                     \
+            run_test_unroll32(g, &t, param("duration"), &err);                 \
+        result->set_error(count++, err);                                       \
     }
         FOR_EACH_TEST(RUN)
 
@@ -124,10 +124,17 @@ struct IPC : public parent_t {
         : parent_t(use_yield ? "inter-processor-communication-with-yield"
                              : "inter-processor-communication",
                    LOWER_IS_BETTER),
-          use_yield(use_yield) {}
+          use_yield(use_yield) {
+        tags = {TAG_THREADING};
+        add_param("duration", 0.15, "measurement time per pair [sec]");
+        add_param("threads", 0, "number of cpus to test (0 = all)");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         int max_thread = g->proc_table->get_active_cpu_count();
+        if (param("threads") > 0) {
+            max_thread = std::min(max_thread, (int)param("threads"));
+        }
 
         std::vector<uint32_t> threads;
         for (int i = 0; i < max_thread; i++) {
@@ -145,13 +152,13 @@ struct IPC : public parent_t {
 
         ti[0].g = g;
         ti[0].tid = 0;
-        ti[0].delay = 0.15;
+        ti[0].delay = param("duration");
         ti[0].s = &s;
         ti[0].use_yield = use_yield;
 
         ti[1].g = g;
         ti[1].tid = 1;
-        ti[1].delay = 0.15;
+        ti[1].delay = param("duration");
         ti[1].s = &s;
         ti[1].use_yield = use_yield;
 
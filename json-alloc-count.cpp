@@ -0,0 +1,76 @@
+/* allocations of one picojson parse / serialize, for the document shapes
+ * of json-throughput.
+ *
+ * The global operator new is replaced in this executable only, so the
+ * benchmarks in sys-microbenchmark keep the default allocator.
+ */
+
+#include "json-throughput.h"
+#include "json.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+uint64_t allocation_count = 0;
+}
+
+/* operator new[] and the other variants end up here. not inlined, or gcc
+ * sees free() of the pointer from operator new and warns */
+__attribute__((noinline)) void *operator new(size_t sz) {
+    allocation_count++;
+    void *p = malloc(sz ? sz : 1);
+    if (p == nullptr) {
+#ifdef __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+using namespace smbm;
+
+int main(int argc, char **argv) {
+    size_t size_kib = 256;
+    if (argc >= 2) {
+        size_kib = atoi(argv[1]);
+    }
+    if (size_kib == 0) {
+        puts("usage: json-alloc-count [doc_size_KiB]");
+        return 1;
+    }
+
+    printf("%-8s %10s %18s %22s\n", "shape", "size[KiB]", "parse[alloc/doc]",
+           "serialize[alloc/doc]");
+
+    for (int sh = 0; sh < JSON_SHAPE_NUM; sh++) {
+        std::string text = json_gen_text((JSONShape)sh, size_kib * 1024);
+
+        picojson::value doc;
+        uint64_t a0 = allocation_count;
+        std::string err = picojson::parse(doc, text);
+        uint64_t a1 = allocation_count;
+        std::string out = doc.serialize();
+        uint64_t a2 = allocation_count;
+
+        if (!err.empty() || out != text) {
+            fprintf(stderr, "json-alloc-count: %s does not round trip\n",
+                    json_shape_name[sh]);
+            return 1;
+        }
+
+        printf("%-8s %10.1f %18llu %22llu\n", json_shape_name[sh],
+               text.size() / 1024.0, (unsigned long long)(a1 - a0),
+               (unsigned long long)(a2 - a1));
+    }
+
+    return 0;
+}
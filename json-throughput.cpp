@@ -0,0 +1,218 @@
+/* picojson parse / serialize throughput.
+ *
+ * Documents of about doc_size KiB in four shapes:
+ *
+ * deep    : subtrees nested 64 levels deep, alternating objects and arrays
+ * numeric : one large array of doubles, like Table2D::v
+ * strings : records of short and long strings, with escapes and non ASCII
+ * result  : a Table2D result with samples, as written to the result file
+ *
+ * MB/s is over the serialized text. The number of allocations per
+ * document is reported by the json-alloc-count tool, which replaces the
+ * global operator new in its own executable.
+ *
+ * The result document is also read back with Table2D::parse_json_result
+ * and written again, and has to give the same text.
+ */
+
+#include "json-throughput.h"
+#include "json.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+
+#include <random>
+#include <stdlib.h>
+
+namespace smbm {
+
+const char *const json_shape_name[JSON_SHAPE_NUM] = {"deep", "numeric",
+                                                     "strings", "result"};
+
+namespace {
+
+typedef picojson::value v_t;
+
+v_t nest(int depth, double leaf) {
+    if (depth == 0) {
+        return v_t(leaf);
+    }
+    if (depth & 1) {
+        return v_t(picojson::array{nest(depth - 1, leaf), v_t(true)});
+    }
+    picojson::object o;
+    o["k"] = nest(depth - 1, leaf);
+    return v_t(o);
+}
+
+std::string random_string(std::mt19937 &rand, size_t len) {
+    static const char *pieces[] = {"sys",   "bench", "\"q\"", "a\\b",
+                                   "tab\t", "nl\n",  "\xc3\xa9", "\xe2\x82\xac",
+                                   " ",     "0123"};
+    std::string s;
+    while (s.size() < len) {
+        s += pieces[rand() % 10];
+    }
+    return s;
+}
+
+/* n elements of the shape, the caller grows n until the text is large
+ * enough */
+v_t gen_doc(JSONShape sh, size_t n) {
+    std::mt19937 rand(1);
+    std::uniform_real_distribution<double> u(0, 1000);
+
+    switch (sh) {
+    case JSON_SHAPE_DEEP: {
+        picojson::array a;
+        for (size_t i = 0; i < n; i++) {
+            a.push_back(nest(64, i));
+        }
+        return v_t(a);
+    }
+    case JSON_SHAPE_NUMERIC: {
+        picojson::array a;
+        for (size_t i = 0; i < n * 16; i++) {
+            a.push_back(v_t(u(rand)));
+        }
+        picojson::object o;
+        o["values"] = v_t(a);
+        return v_t(o);
+    }
+    case JSON_SHAPE_STRINGS: {
+        picojson::array a;
+        for (size_t i = 0; i < n; i++) {
+            picojson::object o;
+            o["name"] = v_t(random_string(rand, 8));
+            o["description"] = v_t(random_string(rand, 8 + rand() % 120));
+            o["path"] = v_t(random_string(rand, 32));
+            a.push_back(v_t(o));
+        }
+        return v_t(a);
+    }
+    default: {
+        Table2D<double, std::string, std::string> t("row", "column", n, 16);
+        t.samples.resize(t.v.size());
+        for (int r = 0; r < t.d1; r++) {
+            t.row_label[r] = "row-" + std::to_string(r);
+        }
+        for (int c = 0; c < t.d0; c++) {
+            t.column_label[c] = "column-" + std::to_string(c);
+        }
+        for (size_t i = 0; i < t.v.size(); i++) {
+            t.v[i] = u(rand);
+            for (int s = 0; s < 4; s++) {
+                t.samples[i].push_back(u(rand));
+            }
+        }
+        return t.dump_json();
+    }
+    }
+}
+
+void check_result_roundtrip(std::string const &text) {
+    v_t v;
+    std::string err = picojson::parse(v, text);
+    if (!err.empty()) {
+        fprintf(stderr, "json-throughput: %s\n", err.c_str());
+        abort();
+    }
+
+    std::unique_ptr<Table2D<double, std::string, std::string>> t(
+        Table2D<double, std::string, std::string>::parse_json_result(v));
+    if (t->dump_json().serialize() != text) {
+        fprintf(stderr, "json-throughput: result does not round trip\n");
+        abort();
+    }
+}
+
+enum Column { COL_PARSE, COL_SERIALIZE, COL_NUM };
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct JSONThroughput : public parent_t {
+    JSONThroughput() : parent_t("json-throughput", HIGHER_IS_BETTER) {
+        tags = {TAG_LIBC};
+        add_param("doc_size", 256, "document size [KiB]");
+        add_param("duration", 0.1, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        double duration = param("duration");
+        size_t size = (size_t)(param("doc_size") * 1024);
+
+        auto t = new table_t("shape", "measure", JSON_SHAPE_NUM, COL_NUM);
+        t->column_label[COL_PARSE] = "parse[MB/s]";
+        t->column_label[COL_SERIALIZE] = "serialize[MB/s]";
+
+        for (int sh = 0; sh < JSON_SHAPE_NUM; sh++) {
+            std::string text = json_gen_text((JSONShape)sh, size);
+            if (sh == JSON_SHAPE_RESULT) {
+                check_result_roundtrip(text);
+            }
+
+            auto parse = [&text](v_t *v) {
+                std::string err = picojson::parse(*v, text);
+                if (!err.empty()) {
+                    fprintf(stderr, "json-throughput: %s\n", err.c_str());
+                    abort();
+                }
+            };
+
+            v_t doc;
+            parse(&doc);
+            if (doc.serialize() != text) {
+                fprintf(stderr, "json-throughput: %s does not round trip\n",
+                        json_shape_name[sh]);
+                abort();
+            }
+
+            auto cr_parse = run_calibrated(
+                g,
+                [&parse](uint64_t n) {
+                    for (uint64_t i = 0; i < n; i++) {
+                        v_t v;
+                        parse(&v);
+                    }
+                },
+                duration);
+
+            auto cr_serialize = run_calibrated(
+                g,
+                [g, &doc](uint64_t n) {
+                    for (uint64_t i = 0; i < n; i++) {
+                        g->dummy_write(0, doc.serialize().size());
+                    }
+                },
+                duration);
+
+            t->row_label[sh] = json_shape_name[sh];
+            (*t)[sh][COL_PARSE] = text.size() / cr_parse.sec_per_unit() / 1e6;
+            (*t)[sh][COL_SERIALIZE] =
+                text.size() / cr_serialize.sec_per_unit() / 1e6;
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 1; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::string json_gen_text(JSONShape sh, size_t size) {
+    for (size_t n = 1;; n *= 2) {
+        std::string text = gen_doc(sh, n).serialize();
+        if (text.size() >= size) {
+            return text;
+        }
+    }
+}
+
+std::unique_ptr<BenchDesc> get_json_throughput_desc() {
+    return std::unique_ptr<BenchDesc>(new JSONThroughput());
+}
+
+} // namespace smbm
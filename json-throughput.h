@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+namespace smbm {
+
+/* document shapes of json-throughput, shared with json-alloc-count */
+enum JSONShape {
+    JSON_SHAPE_DEEP,
+    JSON_SHAPE_NUMERIC,
+    JSON_SHAPE_STRINGS,
+    JSON_SHAPE_RESULT,
+    JSON_SHAPE_NUM
+};
+
+extern const char *const json_shape_name[JSON_SHAPE_NUM];
+
+/* serialized document of at least size bytes */
+extern std::string json_gen_text(JSONShape sh, size_t size);
+
+} // namespace smbm
@@ -360,7 +360,10 @@ struct sort4 : public sort {
 typedef Table1DBenchDesc<double, std::string> parent_t;
 
 struct LIBC : public parent_t {
-    LIBC() : parent_t("libc", LOWER_IS_BETTER) {}
+    LIBC() : parent_t("libc", LOWER_IS_BETTER) {
+        tags = {TAG_LIBC};
+        add_param("duration", 0.1, "measurement time per test [sec]");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         int count = 0;
@@ -379,7 +382,9 @@ struct LIBC : public parent_t {
 #define RUN(F)                                                                 \
     {                                                                          \
         F t;                                                                   \
-        (*result)[count++] = run_test_g(g, &t);                                \
+        double err = -1;                                                       \
+        (*result)[count] = run_test_g(g, &t, param("duration"), &err);         \
+        result->set_error(count++, err);                                       \
     }
         FOR_EACH_TEST(RUN)
 
@@ -421,7 +421,10 @@ struct throw_catch : public no_arg {
 typedef Table1DBenchDesc<double, std::string> parent_t;
 
 struct LIBCXX : public parent_t {
-    LIBCXX() : parent_t("libc++", LOWER_IS_BETTER) {}
+    LIBCXX() : parent_t("libc++", LOWER_IS_BETTER) {
+        tags = {TAG_LIBC};
+        add_param("duration", 0.1, "measurement time per test [sec]");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         int count = 0;
@@ -440,7 +443,9 @@ struct LIBCXX : public parent_t {
 #define RUN(F)                                                                 \
     {                                                                          \
         F t;                                                                   \
-        (*result)[count++] = run_test_g(g, &t);                                \
+        double err = -1;                                                       \
+        (*result)[count] = run_test_g(g, &t, param("duration"), &err);         \
+        result->set_error(count++, err);                                       \
     }
         FOR_EACH_TEST(RUN)
 
@@ -0,0 +1,396 @@
+/* Last level cache noisy neighbour.
+ *
+ * The victim runs on logical processor 0, over a victim_size buffer:
+ *
+ * latency : dependent loads over a random cycle of the lines, as
+ *           random-access-seq
+ * load    : the fastest load loop of memory-bandwidth, whole buffer
+ *
+ * The aggressors run on the processors that share the last level cache
+ * with processor 0 (SMT sibling or shared LLC, up to `threads`), each one
+ * reads and writes one word per line over its share of the footprint.
+ * Rows are the total aggressor footprint, "0" is the victim alone.
+ *
+ * With resctrl mounted at /sys/fs/resctrl and L3 CAT available, the
+ * "cat" columns repeat the run with the victim and the aggressors in
+ * their own resctrl groups, with the lower half of the L3 ways for the
+ * victim and the upper half for the aggressors. Without resctrl (or
+ * permission), the cat columns are left out.
+ *
+ * Not available when no other processor shares the LLC with processor 0.
+ */
+
+#include "cpu-feature.h"
+#include "cpuset.h"
+#include "memalloc.h"
+#include "memory-bandwidth.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace smbm {
+
+namespace {
+
+#ifdef __linux__
+
+#define RESCTRL_ROOT "/sys/fs/resctrl"
+
+bool read_file(std::string const &path, std::string *out) {
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp == nullptr) {
+        return false;
+    }
+    char buf[4096];
+    size_t n = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+    out->assign(buf, n);
+    return true;
+}
+
+/* resctrl reports a rejected value when the file is closed */
+bool write_file(std::string const &path, std::string const &s) {
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(s.data(), 1, s.size(), fp) == s.size();
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
+}
+
+std::string self_tid() { return std::to_string((long)syscall(SYS_gettid)); }
+
+/* two resctrl groups, splitting the L3 ways in halves */
+struct CATGroups {
+    std::string dir[2] = {RESCTRL_ROOT "/smbm-victim",
+                          RESCTRL_ROOT "/smbm-aggressor"};
+    bool ok = false;
+
+    enum { VICTIM, AGGRESSOR };
+
+    CATGroups() {
+        std::string cbm_str, schemata;
+        if (!read_file(RESCTRL_ROOT "/info/L3/cbm_mask", &cbm_str) ||
+            !read_file(RESCTRL_ROOT "/schemata", &schemata)) {
+            return;
+        }
+
+        unsigned long cbm = strtoul(cbm_str.c_str(), nullptr, 16);
+        int nbits = __builtin_popcountl(cbm);
+        if (nbits < 2) {
+            return;
+        }
+        unsigned long low = (1UL << (nbits / 2)) - 1;
+        unsigned long mask[2] = {low, cbm & ~low};
+
+        /* "L3:0=fff;1=fff", one entry per cache domain */
+        size_t b = schemata.find("L3:");
+        if (b == std::string::npos) {
+            return;
+        }
+        size_t e = schemata.find('\n', b);
+        std::string l3 = schemata.substr(b + 3, e - (b + 3));
+        std::vector<std::string> ids;
+        for (size_t p = 0; p < l3.size();) {
+            size_t eq = l3.find('=', p);
+            if (eq == std::string::npos) {
+                break;
+            }
+            size_t start = l3.find_first_not_of(" ;", p);
+            ids.push_back(l3.substr(start, eq - start));
+            size_t semi = l3.find(';', eq);
+            p = semi == std::string::npos ? l3.size() : semi + 1;
+        }
+
+        for (int gi = 0; gi < 2; gi++) {
+            if (mkdir(dir[gi].c_str(), 0755) < 0 && errno != EEXIST) {
+                perror(("mkdir " + dir[gi]).c_str());
+                cleanup();
+                return;
+            }
+            char buf[32];
+            sprintf(buf, "%lx", mask[gi]);
+            std::string line = "L3:";
+            for (size_t i = 0; i < ids.size(); i++) {
+                line += (i ? ";" : "") + ids[i] + "=" + buf;
+            }
+            if (!write_file(dir[gi] + "/schemata", line + "\n")) {
+                fprintf(stderr, "llc-neighbour: cannot write %s/schemata\n",
+                        dir[gi].c_str());
+                cleanup();
+                return;
+            }
+        }
+        ok = true;
+    }
+
+    void cleanup() {
+        for (auto &d : dir) {
+            rmdir(d.c_str());
+        }
+    }
+
+    ~CATGroups() {
+        if (ok) {
+            cleanup();
+        }
+    }
+
+    /* moves the calling thread, group < 0 is the default group */
+    void join(int group) {
+        std::string path = group < 0 ? std::string(RESCTRL_ROOT "/tasks")
+                                     : dir[group] + "/tasks";
+        if (!write_file(path, self_tid())) {
+            fprintf(stderr, "llc-neighbour: cannot write %s\n", path.c_str());
+        }
+    }
+};
+
+#else
+
+struct CATGroups {
+    bool ok = false;
+    enum { VICTIM, AGGRESSOR };
+    void join(int group) {}
+};
+
+#endif
+
+struct Aggressor {
+    thread_handle_t thread;
+    GlobalState const *g;
+    int proc;
+    uint64_t *buf;
+    size_t words;
+    CATGroups *cat; /* null without CAT */
+    std::atomic<bool> *stop;
+    atomic_int_t *start_barrier;
+    int nthread;
+};
+
+void *aggressor_main(void *p) {
+    Aggressor *a = (Aggressor *)p;
+    auto pi = a->g->proc_table->logical_index_to_processor(
+        a->proc, PROC_ORDER_OUTER_TO_INNER);
+    bind_self_to_1proc(a->g->proc_table, pi, true);
+    if (a->cat) {
+        a->cat->join(CATGroups::AGGRESSOR);
+    }
+    wait_barrier(a->start_barrier, a->nthread);
+
+    size_t step = CACHELINE_SIZE / sizeof(uint64_t);
+    while (!a->stop->load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < a->words; i += step) {
+            a->buf[i]++;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<int> neighbour_processors(GlobalState const *g) {
+    std::vector<int> ret;
+    int n = g->proc_table->get_active_cpu_count();
+    for (int i = 1; i < n; i++) {
+        int rel = g->proc_table->processor_relation(
+            0, i, PROC_ORDER_OUTER_TO_INNER);
+        if (rel == PROC_REL_SMT_SIBLING || rel == PROC_REL_SHARED_LLC) {
+            ret.push_back(i);
+        }
+    }
+    return ret;
+}
+
+enum Column { COL_LATENCY, COL_LOAD, COL_NUM };
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct LLCNeighbour : public parent_t {
+    LLCNeighbour() : parent_t("llc-neighbour", LOWER_IS_BETTER) {
+        tags = {TAG_MEMORY, TAG_THREADING, TAG_OS};
+        add_param("victim_size", 2 * 1024 * 1024, "victim buffer [bytes]");
+        add_param("max_footprint", 256 * 1024 * 1024,
+                  "largest aggressor footprint [bytes]");
+        add_param("threads", 0, "max number of aggressors (0 = all)");
+        add_param("cat", 1, "use resctrl CAT if available (0 / 1)");
+        add_param("duration", 0.1, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        size_t victim_size = std::max(64 * 1024, (int)param("victim_size"));
+        victim_size -= victim_size % CACHELINE_SIZE;
+        size_t max_footprint = (size_t)param("max_footprint");
+        double duration = param("duration");
+
+        auto procs = neighbour_processors(g);
+        if (param("threads") > 0 && procs.size() > param("threads")) {
+            procs.resize((size_t)param("threads"));
+        }
+        int nagg = procs.size();
+
+        std::unique_ptr<CATGroups> cat;
+        if (param("cat") != 0) {
+            cat.reset(new CATGroups());
+            if (!cat->ok) {
+                cat.reset();
+            }
+        }
+        int npass = cat ? 2 : 1;
+
+        /* a random cycle over the lines of the victim buffer */
+        size_t nline = victim_size / CACHELINE_SIZE;
+        size_t step = CACHELINE_SIZE / sizeof(uint32_t);
+        uint32_t *chase =
+            (uint32_t *)aligned_calloc(CACHELINE_SIZE, nline * CACHELINE_SIZE);
+        {
+            std::vector<uint32_t> order(nline);
+            for (size_t i = 0; i < nline; i++) {
+                order[i] = i;
+            }
+            std::mt19937 rand(1);
+            for (size_t i = nline - 1; i > 0; i--) {
+                std::swap(order[i], order[rand() % i]);
+            }
+            for (size_t i = 0; i < nline; i++) {
+                chase[order[i] * step] = order[(i + 1) % nline] * step;
+            }
+        }
+        MemFuncs funcs = get_fastest_memfunc(g);
+
+        size_t per_thread = max_footprint / std::max(1, nagg);
+        std::vector<uint64_t *> bufs(nagg);
+        for (auto &b : bufs) {
+            b = (uint64_t *)aligned_calloc(CACHELINE_SIZE, per_thread);
+            /* fault the pages in now, not on the neighbours while the
+             * victim is timed */
+            memset(b, 1, per_thread);
+        }
+
+        std::vector<size_t> footprints = {0};
+        for (size_t f = 1024 * 1024; f <= max_footprint; f *= 2) {
+            footprints.push_back(f);
+        }
+
+        auto t = new table_t("aggressor footprint", "measure",
+                             footprints.size(), COL_NUM * npass);
+        for (int pass = 0; pass < npass; pass++) {
+            const char *s = pass ? " cat" : "";
+            t->column_label[pass * COL_NUM + COL_LATENCY] =
+                std::string("latency") + s + "[ns]";
+            t->column_label[pass * COL_NUM + COL_LOAD] =
+                std::string("load") + s + "[ns/KiB]";
+        }
+
+        auto pi = g->proc_table->logical_index_to_processor(
+            0, PROC_ORDER_OUTER_TO_INNER);
+        bind_self_to_1proc(g->proc_table, pi, true);
+        g->dummy_write(0, funcs.p_load_fn(chase, victim_size));
+
+        for (int pass = 0; pass < npass; pass++) {
+            CATGroups *c = pass ? cat.get() : nullptr;
+            if (c) {
+                c->join(CATGroups::VICTIM);
+            }
+
+            for (size_t fi = 0; fi < footprints.size(); fi++) {
+                size_t f = footprints[fi];
+                t->row_label[fi] = std::to_string(f / 1024) + "KiB";
+
+                std::atomic<bool> stop(false);
+                atomic_int_t start_barrier;
+                start_barrier = 0;
+                std::vector<Aggressor> ag(f ? nagg : 0);
+                for (size_t i = 0; i < ag.size(); i++) {
+                    ag[i].g = g;
+                    ag[i].proc = procs[i];
+                    ag[i].buf = bufs[i];
+                    ag[i].words = std::max<size_t>(CACHELINE_SIZE, f / std::max(1, nagg)) /
+                                  sizeof(uint64_t);
+                    ag[i].cat = c;
+                    ag[i].stop = &stop;
+                    ag[i].start_barrier = &start_barrier;
+                    ag[i].nthread = ag.size() + 1;
+                    ag[i].thread = spawn_thread(aggressor_main, &ag[i]);
+                }
+                if (ag.size()) {
+                    wait_barrier(&start_barrier, ag.size() + 1);
+                }
+
+                uint32_t pos = 0;
+                auto cr = run_calibrated(
+                    g,
+                    [chase, &pos](uint64_t n) {
+                        uint32_t p = pos;
+                        for (uint64_t i = 0; i < n; i++) {
+                            p = chase[p];
+                        }
+                        pos = p;
+                    },
+                    duration);
+                (*t)[fi][pass * COL_NUM + COL_LATENCY] =
+                    cr.sec_per_unit() * 1e9;
+                g->dummy_write(0, pos);
+
+                cr = run_calibrated(
+                    g,
+                    [g, &funcs, chase, victim_size](uint64_t n) {
+                        for (uint64_t i = 0; i < n; i++) {
+                            g->dummy_write(0,
+                                           funcs.p_load_fn(chase, victim_size));
+                        }
+                    },
+                    duration);
+                (*t)[fi][pass * COL_NUM + COL_LOAD] =
+                    cr.sec_per_unit() * 1e9 / (victim_size / 1024.0);
+
+                stop = true;
+                for (auto &a : ag) {
+                    wait_thread(a.thread);
+                }
+            }
+
+            if (c) {
+                c->join(-1);
+            }
+        }
+
+        bind_self_to_first(g->proc_table, true);
+        for (auto b : bufs) {
+            aligned_free(b);
+        }
+        aligned_free(chase);
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+        return !neighbour_processors(g).empty();
+    }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_llc_neighbour_desc() {
+    return std::unique_ptr<BenchDesc>(new LLCNeighbour());
+}
+
+} // namespace smbm
@@ -1,4 +1,5 @@
 #include "sys-microbenchmark.h"
+#include "cpuset.h"
 #include <iomanip>
 #include <fstream>
 #include <stdio.h>
@@ -11,14 +12,32 @@
 #include <getopt.h>
 
 #ifndef NO_MAIN
+enum {
+    ARG_MAX_TIMER_OVERHEAD = 256,
+    ARG_MAX_ERROR,
+    ARG_MIN_BATCH,
+    ARG_STATE_FILE,
+    ARG_RECALIBRATE
+};
+
 static void
 run(smbm::GlobalState *g,
     smbm::result_set_t *this_obj,
-    std::shared_ptr<smbm::BenchDesc> const &b)
+    std::shared_ptr<smbm::BenchDesc> const &b,
+    int ntrial)
 {
     std::cout << "==== " << b->name << " ====\n";
     {
-        auto result = b->run(g);
+        std::vector<smbm::result_ptr_t> trials;
+        for (int ti = 0; ti < ntrial; ti++) {
+            trials.push_back(b->run(g));
+        }
+
+        auto result = trials[0];
+        if (ntrial > 1) {
+            result->merge_trials(trials);
+        }
+
         std::cout << std::fixed << std::setprecision(b->double_precision());
         result->dump_human_readable(std::cout, b->double_precision());
         (*this_obj)[b->name] = result;
@@ -26,26 +45,70 @@ run(smbm::GlobalState *g,
     std::cout << "\n\n";
 }
 
+static void
+usage(const char *argv0,
+      std::vector<std::shared_ptr<smbm::BenchDesc>> const &bench_list)
+{
+    printf("usage : %s [-R result.json] [-n trials] [-t tag] "
+           "[-p bench.key=value] [test-pattern...]\n",
+           argv0);
+    puts("  test-pattern accepts '*' and '?'");
+    puts("  iteration count calibration:\n"
+         "    --max-timer-overhead 0.01 : timer cost / batch time\n"
+         "    --max-error 0.01 : relative standard error to stop at\n"
+         "    --min-batch 5 : minimum number of measured batches");
+    printf("  measured machine state (timer, ooo ratio) cache:\n"
+           "    --state-file path : default '%s', '' disables it\n"
+           "    --recalibrate : measure again and overwrite the cache\n",
+           smbm::default_state_file().c_str());
+    puts("  tests (unavailable ones are skipped when selected):");
+    for (auto &&b : bench_list) {
+        printf("    %s [", b->name.c_str());
+        for (size_t i = 0; i < b->tags.size(); i++) {
+            printf("%s%s", i ? "," : "", b->tags[i].c_str());
+        }
+        printf("]\n");
+
+        for (auto &&p : b->params) {
+            printf("        %s.%s=%.12g : %s\n", b->name.c_str(),
+                   p.first.c_str(), p.second.value,
+                   p.second.description.c_str());
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     using namespace smbm;
 
     GlobalState g;
-    auto &bench_list = *g.get_active_benchmark_list();
+    auto bench_list = get_all_benchmark_list();
 
     std::string json_path = "result.json";
+    int ntrial = 1;
+    std::vector<std::string> select_tags;
+    std::vector<std::string> param_overrides;
 
     {
         while (1) {
             static struct option long_options[] = {
                 {"help", no_argument, 0, 'h'},
                 {"result", required_argument, 0, 'R'},
+                {"trials", required_argument, 0, 'n'},
+                {"tag", required_argument, 0, 't'},
+                {"param", required_argument, 0, 'p'},
+                {"max-timer-overhead", required_argument, 0,
+                 ARG_MAX_TIMER_OVERHEAD},
+                {"max-error", required_argument, 0, ARG_MAX_ERROR},
+                {"min-batch", required_argument, 0, ARG_MIN_BATCH},
+                {"state-file", required_argument, 0, ARG_STATE_FILE},
+                {"recalibrate", no_argument, 0, ARG_RECALIBRATE},
 
                 {0,0,0,0},
             };
 
             int option_index = 0;
 
-            int c = getopt_long(argc, argv, "hR:",
+            int c = getopt_long(argc, argv, "hR:n:t:p:",
                                 long_options, &option_index);
 
             if (c == -1) {
@@ -55,38 +118,81 @@ int main(int argc, char **argv) {
             switch (c) {
             case 'h':
             default:
-                printf("usage : %s [-R result.json] [test-list]", argv[0]);
-                fflush(stdout);
-                puts("  tests:");
-                for (auto &&b : bench_list) {
-                    printf("    %s\n", b->name.c_str());
-                }
+                usage(argv[0], bench_list);
                 return 0;
 
             case 'R':
                 json_path = optarg;
                 break;
+
+            case 'n':
+                ntrial = std::max(1, atoi(optarg));
+                break;
+
+            case 't':
+                select_tags.push_back(optarg);
+                break;
+
+            case 'p':
+                param_overrides.push_back(optarg);
+                break;
+
+            case ARG_MAX_TIMER_OVERHEAD:
+                g.calib_max_timer_overhead = atof(optarg);
+                break;
+
+            case ARG_MAX_ERROR:
+                g.calib_max_relative_error = atof(optarg);
+                break;
+
+            case ARG_MIN_BATCH:
+                g.calib_min_batch = std::max(2, atoi(optarg));
+                break;
+
+            case ARG_STATE_FILE:
+                g.state_file = optarg;
+                break;
+
+            case ARG_RECALIBRATE:
+                g.recalibrate = true;
+                break;
             }
         }
 
     }
 
+    for (auto &&p : param_overrides) {
+        if (!apply_param_override(bench_list, p)) {
+            fprintf(stderr, "unknown or malformed parameter : %s\n", p.c_str());
+            return 1;
+        }
+    }
+
+    bind_self_to_first(g.proc_table, true);
+
     result_set_t result_obj;
     SysInfo sys_info = get_sysinfo(&g);
 
     warmup_thread(&g);
 
-    if (optind == argc) {
-        for (auto &&b : bench_list) {
-            run(&g, &result_obj, b);
+    /* calibrate (or load) the timers before the first bench, so that the
+     * values are not printed in the middle of its output */
+    print_timer_calibration(g.get_timer_calibration());
+
+    bool select_all = (optind == argc) && select_tags.empty();
+
+    for (auto &&b : bench_list) {
+        bool selected = select_all;
+
+        for (int ai = optind; ai < argc; ai++) {
+            selected |= glob_match(argv[ai], b->name.c_str());
         }
-    } else {
-        for (int ai = 1; ai < argc; ai++) {
-            for (auto &&b : bench_list) {
-                if (b->name == argv[ai]) {
-                    run(&g, &result_obj, b);
-                }
-            }
+        for (auto &&t : select_tags) {
+            selected |= b->has_tag(t);
+        }
+
+        if (selected && b->available(&g)) {
+            run(&g, &result_obj, b, ntrial);
         }
     }
 
@@ -369,7 +369,17 @@ struct MemoryBandwidth : public bw_parent_t {
 
     MemoryBandwidth(bool full_thread)
         : bw_parent_t(full_thread ? "membw_mt" : "membw_1t", HIGHER_IS_BETTER),
-          full_thread(full_thread) {}
+          full_thread(full_thread) {
+        tags = {TAG_MEMORY};
+        if (full_thread) {
+            tags.push_back(TAG_THREADING);
+        }
+
+        add_param("size", 128 * 1024 * 1024,
+                  "total buffer size shared by all threads [bytes]");
+        add_param("duration", 0.1, "measurement time per test [sec]");
+        add_param("threads", 0, "number of threads (0 = auto)");
+    }
 
     virtual result_t run(const GlobalState *g) override {
         int ncopy_test = sizeof(copy_tests) / sizeof(copy_tests[0]);
@@ -420,9 +430,17 @@ struct MemoryBandwidth : public bw_parent_t {
             }
         }
 
-        size_t test_size = 128 * 1024 * 1024 / nthread;
+        if (param("threads") > 0) {
+            nthread = std::min(max_thread, (int)param("threads"));
+        }
+
+        /* each thread gets size / nthread, rounded down to a multiple of
+         * 256 bytes (4 x 64 byte vectors, the widest unrolled loop) */
+        size_t test_size = (size_t)param("size") / nthread;
+        test_size = std::max(test_size & ~(size_t)255, (size_t)256);
 
-        ThreadInfo *threads = init_threads(g, 0, nthread, 0.1, test_size);
+        ThreadInfo *threads =
+            init_threads(g, 0, nthread, param("duration"), test_size);
 
         union fn_union fn;
         int cur = 0;
@@ -512,6 +530,47 @@ struct CacheBandwidthResult : public BenchResult {
         return v_t(list_obj);
     }
 
+    void merge_trials(std::vector<result_ptr_t> const &trials) override {
+        for (auto m : {memop::COPY, memop::LOAD, memop::STORE}) {
+            std::vector<table_t const *> tables;
+            for (auto &&t : trials) {
+                auto p = dynamic_cast<CacheBandwidthResult const *>(t.get());
+                if (p) {
+                    tables.push_back(p->list.at(m).get());
+                }
+            }
+            merge_trial_values<double>(list[m].get(), tables);
+        }
+    }
+
+    std::vector<SampleCell> get_sample_cells() const override {
+        std::vector<SampleCell> ret;
+
+        for (auto m : {memop::COPY, memop::LOAD, memop::STORE}) {
+            const char *prefix = "";
+            switch (m) {
+            case memop::COPY:
+                prefix = "copy ";
+                break;
+            case memop::LOAD:
+                prefix = "load ";
+                break;
+            case memop::STORE:
+                prefix = "store ";
+                break;
+            default:
+                break;
+            }
+
+            for (auto &&c : list.at(m)->get_sample_cells()) {
+                c.label = prefix + c.label;
+                ret.push_back(c);
+            }
+        }
+
+        return ret;
+    }
+
     static CacheBandwidthResult *
     parse_json_result(picojson::value const &value) {
         CacheBandwidthResult *ret = new CacheBandwidthResult;
@@ -533,11 +592,22 @@ struct CacheBandwidth : public BenchDesc {
 
     CacheBandwidth(bool full_thread)
         : BenchDesc(full_thread ? "cache-bandwidth-mt" : "cache-bandwidth-1t"),
-          full_thread(full_thread) {}
+          full_thread(full_thread) {
+        tags = {TAG_MEMORY};
+        if (full_thread) {
+            tags.push_back(TAG_THREADING);
+        }
+
+        add_param("min_size", 2048, "smallest buffer size per thread [bytes]");
+        add_param("max_size", 16 * 1024 * 1024,
+                  "largest buffer size per thread [bytes]");
+        add_param("duration", 0.1, "measurement time per size [sec]");
+        add_param("threads", 0, "number of threads (0 = auto)");
+    }
 
     virtual result_t run(const GlobalState *g) override {
-        size_t start = 2048;
-        size_t max = 16 * 1024 * 1024;
+        size_t start = param("min_size");
+        size_t max = param("max_size");
 
         MemFuncs funcs = get_fastest_memfunc(g);
 
@@ -557,6 +627,11 @@ struct CacheBandwidth : public BenchDesc {
             nthread = g->proc_table->get_active_cpu_count();
         }
 
+        if (param("threads") > 0) {
+            nthread = std::min(g->proc_table->get_active_cpu_count(),
+                               (int)param("threads"));
+        }
+
         list_t *ret = new list_t;
 
         int start_proc = 0;
@@ -565,8 +640,8 @@ struct CacheBandwidth : public BenchDesc {
             std::vector<double> results;
 
             for (auto test_size : size_set) {
-                ThreadInfo *threads =
-                    init_threads(g, start_proc, nthread, 0.1, test_size);
+                ThreadInfo *threads = init_threads(
+                    g, start_proc, nthread, param("duration"), test_size);
                 union fn_union fn;
                 const char *label = "";
 
@@ -1,4 +1,5 @@
 #include "oneshot_timer.h"
+#include "simple-run.h"
 #include "sys-microbenchmark.h"
 #include "table.h"
 #include <algorithm>
@@ -16,13 +17,22 @@ struct MemoryLatency : public parent_t {
     MemoryLatency(bool has_dep)
         : parent_t(has_dep ? "random-access-seq" : "random-access-para",
                    LOWER_IS_BETTER),
-          has_dep(has_dep) {}
+          has_dep(has_dep) {
+        tags = {TAG_MEMORY};
+        add_param("min_size", 128 * sizeof(int), "smallest range [bytes]");
+        add_param("max_size", 256 * 1024 * 1024,
+                  "upper bound of range (exclusive) [bytes]");
+        add_param("duration", 0.2, "measurement time per range [sec]");
+    }
 
     virtual result_t run(GlobalState const *g) override {
         std::vector<int> range_cands;
         std::vector<int> range_label;
 
-        for (int x = 128; x < 64 * 1024 * 1024; x *= 2) {
+        int min_count = param("min_size") / sizeof(int);
+        int max_count = param("max_size") / sizeof(int);
+
+        for (int x = std::max(1, min_count); x < max_count; x *= 2) {
             range_cands.push_back(x);
             range_label.push_back(x * sizeof(int));
         }
@@ -45,39 +55,40 @@ struct MemoryLatency : public parent_t {
             std::shuffle(ptr.begin(), ptr.end(), mt);
 
             int sum = g->getzero();
-            int count = 0;
+            CalibratedRun r;
 
-            oneshot_timer ot(1024);
-            ot.start(g, 0.2);
             if (has_dep) {
                 int pos = 0;
                 int cur = 0;
                 int first = ptr[cur];
-                while (!ot.test_end()) {
-                    int next = ptr[cur];
-                    sum += next;
-                    if (next == first) { // break ring
-                        pos = (pos + 1) % x;
-                        first = ptr[pos];
-                        cur = ptr[first];
-                    } else {
-                        cur = ptr[cur];
+                auto body = [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; i++) {
+                        int next = ptr[cur];
+                        sum += next;
+                        if (next == first) { // break ring
+                            pos = (pos + 1) % x;
+                            first = ptr[pos];
+                            cur = ptr[first];
+                        } else {
+                            cur = ptr[cur];
+                        }
                     }
-                    count++;
-                }
+                };
+                r = run_calibrated(g, body, param("duration"));
             } else {
                 int pos = 0;
-                while (!ot.test_end()) {
-                    sum += v100[ptr[pos]];
-                    pos = (pos + 1) % x;
-                    count++;
-                }
+                auto body = [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; i++) {
+                        sum += v100[ptr[pos]];
+                        pos = (pos + 1) % x;
+                    }
+                };
+                r = run_calibrated(g, body, param("duration"));
             }
             g->dummy_write(0, sum);
 
-            double sec = ot.actual_interval_sec(g);
-
-            result->v[i] = (sec * 1e9) / count;
+            result->v[i] = r.sec_per_unit() * 1e9;
+            result->set_error(i, r.sec_error_per_unit(g) * 1e9);
         }
 
         return result_t(result);
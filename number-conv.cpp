@@ -0,0 +1,405 @@
+/* Number formatting and parsing.
+ *
+ * int32 and double, with stdio (sprintf / sscanf), strtol / strtod,
+ * iostream and <charconv> (to_chars / from_chars, shortest round trip for
+ * double).
+ *
+ * single : one number per call into (from) a small buffer
+ * bulk   : bulk_count numbers, ',' separated, into (from) one buffer
+ *
+ * number-conv-bulk reports bulk as MB/s of text, higher is better.
+ *
+ * Ints have a random number of digits, doubles are random with 17
+ * significant digits. The parsers read the "%d" / "%.17g" text, and the
+ * round trip formats are checked against the parsers.
+ */
+
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+
+#include <algorithm>
+#include <charconv>
+#include <math.h>
+#include <random>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined __cpp_lib_to_chars && __cpp_lib_to_chars >= 201611L
+#define HAVE_FP_CHARCONV
+#endif
+
+namespace smbm {
+
+namespace {
+
+/* write v at p, return the end. p has room for 32 chars */
+typedef char *(*format_int_t)(char *p, int32_t v);
+typedef char *(*format_double_t)(char *p, double v);
+
+/* parse at p, return the end of the number. end is the end of the text */
+typedef char const *(*parse_int_t)(char const *p, char const *end,
+                                   int32_t *v);
+typedef char const *(*parse_double_t)(char const *p, char const *end,
+                                      double *v);
+
+char *format_int_sprintf(char *p, int32_t v) {
+    return p + sprintf(p, "%d", v);
+}
+
+char *format_double_sprintf(char *p, double v) {
+    return p + sprintf(p, "%.17g", v);
+}
+
+char *format_int_ostringstream(char *p, int32_t v) {
+    static std::ostringstream os;
+    os.str("");
+    os << v;
+    auto s = os.str();
+    memcpy(p, s.data(), s.size());
+    return p + s.size();
+}
+
+char *format_double_ostringstream(char *p, double v) {
+    static std::ostringstream os;
+    os.str("");
+    os.precision(17);
+    os << v;
+    auto s = os.str();
+    memcpy(p, s.data(), s.size());
+    return p + s.size();
+}
+
+template <typename T> char *format_to_chars(char *p, T v) {
+    return std::to_chars(p, p + 32, v).ptr;
+}
+
+/* glibc sscanf calls strlen on the input, which over the bulk buffer
+ * makes it quadratic. the field is copied out first, as a reader that
+ * splits the fields would do */
+template <typename T>
+char const *parse_sscanf(char const *p, T *v, const char *fmt) {
+    char buf[64];
+    size_t len = strcspn(p, ",");
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    sscanf(buf, fmt, v);
+    return p + len;
+}
+
+char const *parse_int_sscanf(char const *p, char const *end, int32_t *v) {
+    return parse_sscanf(p, v, "%d");
+}
+
+char const *parse_double_sscanf(char const *p, char const *end,
+                                double *v) {
+    return parse_sscanf(p, v, "%lf");
+}
+
+char const *parse_int_strtol(char const *p, char const *end, int32_t *v) {
+    char *e;
+    *v = strtol(p, &e, 10);
+    return e;
+}
+
+char const *parse_double_strtod(char const *p, char const *end,
+                                double *v) {
+    char *e;
+    *v = strtod(p, &e);
+    return e;
+}
+
+template <typename T>
+char const *parse_istringstream(char const *p, char const *end, T *v) {
+    static std::istringstream is;
+    size_t len = strcspn(p, ",");
+    is.clear();
+    is.str(std::string(p, len));
+    is >> *v;
+    return p + len;
+}
+
+template <typename T>
+char const *parse_from_chars(char const *p, char const *end, T *v) {
+    return std::from_chars(p, std::min(p + 32, end), *v).ptr;
+}
+
+template <typename F> struct Method {
+    const char *name;
+    F func;
+};
+
+std::vector<Method<format_int_t>> format_int_methods() {
+    return {{"format int sprintf", format_int_sprintf},
+            {"format int ostringstream", format_int_ostringstream},
+            {"format int to_chars", format_to_chars<int32_t>}};
+}
+
+std::vector<Method<format_double_t>> format_double_methods() {
+    return {
+        {"format double sprintf(%.17g)", format_double_sprintf},
+        {"format double ostringstream", format_double_ostringstream},
+#ifdef HAVE_FP_CHARCONV
+        {"format double to_chars", format_to_chars<double>},
+#endif
+    };
+}
+
+std::vector<Method<parse_int_t>> parse_int_methods() {
+    return {{"parse int sscanf", parse_int_sscanf},
+            {"parse int strtol", parse_int_strtol},
+            {"parse int istringstream", parse_istringstream<int32_t>},
+            {"parse int from_chars", parse_from_chars<int32_t>}};
+}
+
+std::vector<Method<parse_double_t>> parse_double_methods() {
+    return {
+        {"parse double sscanf", parse_double_sscanf},
+        {"parse double strtod", parse_double_strtod},
+        {"parse double istringstream", parse_istringstream<double>},
+#ifdef HAVE_FP_CHARCONV
+        {"parse double from_chars", parse_from_chars<double>},
+#endif
+    };
+}
+
+struct Numbers {
+    std::vector<int32_t> ints;
+    std::vector<double> doubles;
+
+    /* reference text, ',' separated, and the offset of each number */
+    std::string int_text, double_text;
+    std::vector<size_t> int_pos, double_pos;
+
+    Numbers(size_t n) {
+        std::mt19937_64 rand(1);
+        std::uniform_real_distribution<double> mant(1, 10);
+        char buf[64];
+
+        for (size_t i = 0; i < n; i++) {
+            int digits = 1 + rand() % 9;
+            int64_t m = 1;
+            for (int d = 0; d < digits; d++) {
+                m *= 10;
+            }
+            int32_t v = (int32_t)(rand() % m);
+            ints.push_back((rand() & 1) ? -v : v);
+
+            double e = (double)((int)(rand() % 41) - 20);
+            doubles.push_back(mant(rand) * pow(10, e));
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            int_pos.push_back(int_text.size());
+            sprintf(buf, "%d,", ints[i]);
+            int_text += buf;
+
+            double_pos.push_back(double_text.size());
+            sprintf(buf, "%.17g,", doubles[i]);
+            double_text += buf;
+        }
+    }
+};
+
+/* number-conv has single and bulk, number-conv-bulk has bulk_mbs */
+enum Column { COL_SINGLE, COL_BULK, COL_BULK_MBS, COL_NUM };
+
+template <typename T>
+void check_equal(const char *name, std::vector<T> const &a,
+                 std::vector<T> const &b) {
+    if (a != b) {
+        fprintf(stderr, "number-conv: %s does not round trip\n", name);
+        abort();
+    }
+}
+
+template <typename T, typename F>
+void run_format(GlobalState const *g, Method<F> const &m,
+                std::vector<T> const &values,
+                std::vector<T> (*reparse)(std::string const &),
+                double duration, bool bulk_only, double *out) {
+    size_t n = values.size();
+    size_t mask = 1023;
+
+    if (!bulk_only) {
+        auto cr = run_calibrated(
+            g,
+            [g, &m, &values, mask](uint64_t count) {
+                char buf[64];
+                for (uint64_t i = 0; i < count; i++) {
+                    char *e = m.func(buf, values[i & mask]);
+                    g->dummy_write(0, e[-1]);
+                }
+            },
+            duration);
+        out[COL_SINGLE] = cr.sec_per_unit() * 1e9;
+    }
+
+    /* the last number still has its 32 chars of room */
+    std::vector<char> text(n * 32 + 32);
+    size_t len = 0;
+    auto cr = run_calibrated(
+        g,
+        [&m, &values, &text, &len, n](uint64_t count) {
+            for (uint64_t c = 0; c < count; c++) {
+                char *p = text.data();
+                for (size_t i = 0; i < n; i++) {
+                    p = m.func(p, values[i]);
+                    *p++ = ',';
+                }
+                len = p - text.data();
+            }
+        },
+        duration);
+    out[COL_BULK] = cr.sec_per_unit() * 1e9 / n;
+    out[COL_BULK_MBS] = len / cr.sec_per_unit() / 1e6;
+
+    check_equal(m.name, values, reparse(std::string(text.data(), len)));
+}
+
+template <typename T, typename F>
+void run_parse(GlobalState const *g, Method<F> const &m,
+               std::vector<T> const &values, std::string const &text,
+               std::vector<size_t> const &pos, double duration,
+               bool bulk_only, double *out) {
+    size_t n = values.size();
+    size_t mask = 1023;
+    char const *end = text.c_str() + text.size();
+
+    if (!bulk_only) {
+        auto cr = run_calibrated(
+            g,
+            [g, &m, &text, &pos, mask, end](uint64_t count) {
+                T v;
+                for (uint64_t i = 0; i < count; i++) {
+                    m.func(text.c_str() + pos[i & mask], end, &v);
+                    g->dummy_write(0, v);
+                }
+            },
+            duration);
+        out[COL_SINGLE] = cr.sec_per_unit() * 1e9;
+    }
+
+    std::vector<T> parsed(n);
+    auto cr = run_calibrated(
+        g,
+        [&m, &text, &parsed, n, end](uint64_t count) {
+            for (uint64_t c = 0; c < count; c++) {
+                char const *p = text.c_str();
+                for (size_t i = 0; i < n; i++) {
+                    p = m.func(p, end, &parsed[i]) + 1;
+                }
+            }
+        },
+        duration);
+    out[COL_BULK] = cr.sec_per_unit() * 1e9 / n;
+    out[COL_BULK_MBS] = text.size() / cr.sec_per_unit() / 1e6;
+
+    check_equal(m.name, values, parsed);
+}
+
+/* parses the bulk output of a format method back, with strtol / strtod */
+template <typename T, char const *(*parse)(char const *, char const *, T *)>
+std::vector<T> reparse(std::string const &text) {
+    std::vector<T> ret;
+    char const *p = text.c_str();
+    char const *end = p + text.size();
+    while (*p) {
+        T v;
+        p = parse(p, end, &v) + 1;
+        ret.push_back(v);
+    }
+    return ret;
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct NumberConv : public parent_t {
+    bool bulk_mbs;
+
+    NumberConv(bool bulk_mbs)
+        : parent_t(bulk_mbs ? "number-conv-bulk" : "number-conv",
+                   bulk_mbs ? HIGHER_IS_BETTER : LOWER_IS_BETTER),
+          bulk_mbs(bulk_mbs) {
+        tags = {TAG_LIBC};
+        add_param("bulk_count", 1024 * 1024, "numbers in the bulk buffer");
+        add_param("duration", 0.1, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        size_t n = std::max(1024, (int)param("bulk_count"));
+        double duration = param("duration");
+        Numbers nums(n);
+
+        auto fi = format_int_methods();
+        auto fd = format_double_methods();
+        auto pi = parse_int_methods();
+        auto pd = parse_double_methods();
+        int nrow = fi.size() + fd.size() + pi.size() + pd.size();
+
+        table_t *t;
+        if (bulk_mbs) {
+            t = new table_t("conversion", "measure", nrow, 1);
+            t->column_label[0] = "bulk[MB/s]";
+        } else {
+            t = new table_t("conversion", "measure", nrow, 2);
+            t->column_label[0] = "single[ns/number]";
+            t->column_label[1] = "bulk[ns/number]";
+        }
+
+        int row = 0;
+        double out[COL_NUM] = {};
+        auto put = [&](const char *name) {
+            t->row_label[row] = name;
+            if (bulk_mbs) {
+                (*t)[row][0] = out[COL_BULK_MBS];
+            } else {
+                (*t)[row][0] = out[COL_SINGLE];
+                (*t)[row][1] = out[COL_BULK];
+            }
+            row++;
+        };
+
+        for (auto &m : fi) {
+            run_format(g, m, nums.ints, reparse<int32_t, parse_int_strtol>,
+                       duration, bulk_mbs, out);
+            put(m.name);
+        }
+        for (auto &m : fd) {
+            run_format(g, m, nums.doubles,
+                       reparse<double, parse_double_strtod>, duration,
+                       bulk_mbs, out);
+            put(m.name);
+        }
+        for (auto &m : pi) {
+            run_parse(g, m, nums.ints, nums.int_text, nums.int_pos,
+                      duration, bulk_mbs, out);
+            put(m.name);
+        }
+        for (auto &m : pd) {
+            run_parse(g, m, nums.doubles, nums.double_text, nums.double_pos,
+                      duration, bulk_mbs, out);
+            put(m.name);
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_number_conv_desc() {
+    return std::unique_ptr<BenchDesc>(new NumberConv(false));
+}
+std::unique_ptr<BenchDesc> get_number_conv_bulk_desc() {
+    return std::unique_ptr<BenchDesc>(new NumberConv(true));
+}
+
+} // namespace smbm
@@ -0,0 +1,277 @@
+/* OpenMP worksharing overheads, by scheduling policy.
+ *
+ * A loop of `iters` iterations, iteration i does cost[i] steps of a
+ * dependent FP chain. Columns are the cost patterns:
+ *
+ * empty      : cost 0, only the scheduling overhead
+ * balanced   : cost `work` for every iteration
+ * imbalanced : cost rises linearly from 0 to 2 * `work`, same mean
+ *
+ * Rows:
+ *
+ * schedule(kind,chunk)  : parallel for, schedule(runtime) set by
+ *                         omp_set_schedule, chunk 1 .. 4096
+ * reduction / atomic / critical : sum of the results
+ * taskloop grainsize(g) : tasks from a single thread
+ * nested                : 2 outer threads, nthread / 2 inner threads each,
+ *                         with and without max_active_levels 2
+ * proc_bind(close / spread) : the clause only has an effect when the
+ *                         runtime has places, i.e. OMP_PLACES or
+ *                         OMP_PROC_BIND was set at startup. otherwise the
+ *                         rows are marked "[no places]"
+ */
+
+#include "cpuset.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+#ifdef _OPENMP
+
+struct Loop {
+    int n;
+    uint32_t const *cost;
+    double *out;
+};
+
+inline double work(int i, uint32_t cost) {
+    double x = i;
+    for (uint32_t k = 0; k < cost; k++) {
+        x = x * 0.999 + 1.0;
+    }
+    return x;
+}
+
+void run_schedule(Loop const &l) {
+    int n = l.n;
+#pragma omp parallel for schedule(runtime)
+    for (int i = 0; i < n; i++) {
+        l.out[i] = work(i, l.cost[i]);
+    }
+}
+
+void run_reduction(Loop const &l) {
+    int n = l.n;
+    double sum = 0;
+#pragma omp parallel for reduction(+ : sum)
+    for (int i = 0; i < n; i++) {
+        sum += work(i, l.cost[i]);
+    }
+    l.out[0] = sum;
+}
+
+void run_atomic(Loop const &l) {
+    int n = l.n;
+    double sum = 0;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        double v = work(i, l.cost[i]);
+#pragma omp atomic
+        sum += v;
+    }
+    l.out[0] = sum;
+}
+
+void run_critical(Loop const &l) {
+    int n = l.n;
+    double sum = 0;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        double v = work(i, l.cost[i]);
+#pragma omp critical
+        sum += v;
+    }
+    l.out[0] = sum;
+}
+
+template <int GRAIN> void run_taskloop(Loop const &l) {
+    int n = l.n;
+#pragma omp parallel
+#pragma omp single
+#pragma omp taskloop grainsize(GRAIN)
+    for (int i = 0; i < n; i++) {
+        l.out[i] = work(i, l.cost[i]);
+    }
+}
+
+void run_nested(Loop const &l) {
+    int n = l.n;
+    int inner = std::max(1, omp_get_max_threads() / 2);
+#pragma omp parallel num_threads(2)
+    {
+        int half = n / 2;
+        int begin = omp_get_thread_num() * half;
+        int end = omp_get_thread_num() == 0 ? half : n;
+#pragma omp parallel for num_threads(inner)
+        for (int i = begin; i < end; i++) {
+            l.out[i] = work(i, l.cost[i]);
+        }
+    }
+}
+
+void run_close(Loop const &l) {
+    int n = l.n;
+#pragma omp parallel for proc_bind(close)
+    for (int i = 0; i < n; i++) {
+        l.out[i] = work(i, l.cost[i]);
+    }
+}
+
+void run_spread(Loop const &l) {
+    int n = l.n;
+#pragma omp parallel for proc_bind(spread)
+    for (int i = 0; i < n; i++) {
+        l.out[i] = work(i, l.cost[i]);
+    }
+}
+
+struct Config {
+    std::string name;
+    void (*run)(Loop const &);
+    omp_sched_t kind; /* for run_schedule */
+    int chunk;
+    int max_active_levels;
+};
+
+std::vector<Config> configs() {
+    std::vector<Config> ret;
+    std::pair<const char *, omp_sched_t> kinds[] = {
+        {"static", omp_sched_static},
+        {"dynamic", omp_sched_dynamic},
+        {"guided", omp_sched_guided}};
+
+    ret.push_back({"schedule(static)", run_schedule, omp_sched_static, 0, 1});
+    for (auto &k : kinds) {
+        for (int chunk = 1; chunk <= 4096; chunk *= 4) {
+            ret.push_back({std::string("schedule(") + k.first + "," +
+                               std::to_string(chunk) + ")",
+                           run_schedule, k.second, chunk, 1});
+        }
+    }
+
+    ret.push_back({"reduction(+)", run_reduction, omp_sched_static, 0, 1});
+    ret.push_back({"atomic", run_atomic, omp_sched_static, 0, 1});
+    ret.push_back({"critical", run_critical, omp_sched_static, 0, 1});
+
+    ret.push_back(
+        {"taskloop grainsize(1)", run_taskloop<1>, omp_sched_static, 0, 1});
+    ret.push_back(
+        {"taskloop grainsize(16)", run_taskloop<16>, omp_sched_static, 0, 1});
+    ret.push_back(
+        {"taskloop grainsize(256)", run_taskloop<256>, omp_sched_static, 0, 1});
+    ret.push_back({"taskloop grainsize(4096)", run_taskloop<4096>,
+                   omp_sched_static, 0, 1});
+
+    ret.push_back({"nested 2 x n/2 (inactive)", run_nested, omp_sched_static,
+                   0, 1});
+    ret.push_back({"nested 2 x n/2", run_nested, omp_sched_static, 0, 2});
+
+    const char *places = omp_get_num_places() > 0 ? "" : " [no places]";
+    ret.push_back({std::string("proc_bind(close)") + places, run_close,
+                   omp_sched_static, 0, 1});
+    ret.push_back({std::string("proc_bind(spread)") + places, run_spread,
+                   omp_sched_static, 0, 1});
+
+    return ret;
+}
+
+enum Column { COL_EMPTY, COL_BALANCED, COL_IMBALANCED, COL_NUM };
+
+#endif
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct OpenMPSched : public parent_t {
+    OpenMPSched() : parent_t("omp-sched", LOWER_IS_BETTER) {
+        tags = {TAG_THREADING};
+        add_param("iters", 65536, "loop iterations");
+        add_param("work", 64, "mean FP steps per iteration");
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+#ifdef _OPENMP
+        int n = std::max(1024, (int)param("iters"));
+        uint32_t w = (uint32_t)param("work");
+        double duration = param("duration");
+
+        bind_self_to_all(g->proc_table);
+
+        std::vector<uint32_t> cost[COL_NUM];
+        cost[COL_EMPTY].assign(n, 0);
+        cost[COL_BALANCED].assign(n, w);
+        for (int i = 0; i < n; i++) {
+            cost[COL_IMBALANCED].push_back((uint32_t)(2.0 * w * i / n));
+        }
+        std::vector<double> out(n);
+
+        auto cs = configs();
+        auto t = new table_t("config", "cost", cs.size(), COL_NUM);
+        t->column_label[COL_EMPTY] = "empty[ns/iter]";
+        t->column_label[COL_BALANCED] = "balanced[ns/iter]";
+        t->column_label[COL_IMBALANCED] = "imbalanced[ns/iter]";
+
+        omp_sched_t kind0;
+        int chunk0;
+        omp_get_schedule(&kind0, &chunk0);
+        int levels0 = omp_get_max_active_levels();
+
+        for (size_t r = 0; r < cs.size(); r++) {
+            auto const &c = cs[r];
+            t->row_label[r] = c.name;
+            omp_set_schedule(c.kind, c.chunk);
+            omp_set_max_active_levels(c.max_active_levels);
+
+            for (int col = 0; col < COL_NUM; col++) {
+                Loop l = {n, cost[col].data(), out.data()};
+                auto cr = run_calibrated(
+                    g,
+                    [&c, &l](uint64_t count) {
+                        for (uint64_t i = 0; i < count; i++) {
+                            c.run(l);
+                        }
+                    },
+                    duration);
+                (*t)[r][col] = cr.sec_per_unit() / n * 1e9;
+            }
+        }
+
+        omp_set_schedule(kind0, chunk0);
+        omp_set_max_active_levels(levels0);
+        bind_self_to_first(g->proc_table, true);
+        g->dummy_write(0, out[0]);
+
+        return result_t(t);
+#else
+        return result_t();
+#endif
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+#ifdef _OPENMP
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_omp_sched_desc() {
+    return std::unique_ptr<BenchDesc>(new OpenMPSched());
+}
+
+} // namespace smbm
@@ -147,7 +147,10 @@ struct parallel_barrier_1K : public no_arg {
 typedef Table1DBenchDesc<double, std::string> parent_t;
 
 struct OpenMP : public parent_t {
-    OpenMP() : parent_t("OpenMP", LOWER_IS_BETTER) {}
+    OpenMP() : parent_t("OpenMP", LOWER_IS_BETTER) {
+        tags = {TAG_THREADING};
+        add_param("duration", 0.1, "measurement time per test [sec]");
+    }
 
     virtual result_t run(GlobalState const *g) override {
 
@@ -170,7 +173,9 @@ struct OpenMP : public parent_t {
 #define RUN(F)                                                                 \
     {                                                                          \
         F t;                                                                   \
-        (*result)[count++] = run_test(g, &t);                                  \
+        double err = -1;                                                       \
+        (*result)[count] = run_test(g, &t, param("duration"), &err);           \
+        result->set_error(count++, err);                                       \
     }
         FOR_EACH_TEST(RUN)
 
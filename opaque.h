@@ -0,0 +1,28 @@
+#pragma once
+
+#include "sys-features.h"
+
+namespace smbm {
+
+typedef float v4f __attribute__((vector_size(16)));
+typedef double v2d __attribute__((vector_size(16)));
+
+/* hide(v) keeps the compiler from seeing that v is constant or equal to
+ * another value, without emitting any instruction. the value stays in a
+ * register */
+template <typename T> inline void hide(T &v) { asm volatile("" : "+r"(v)); }
+
+#ifdef X86
+#define FP_HIDE_CONSTRAINT "+x"
+#elif defined AARCH64
+#define FP_HIDE_CONSTRAINT "+w"
+#else
+#define FP_HIDE_CONSTRAINT "+m"
+#endif
+
+inline void hide(float &v) { asm volatile("" : FP_HIDE_CONSTRAINT(v)); }
+inline void hide(double &v) { asm volatile("" : FP_HIDE_CONSTRAINT(v)); }
+inline void hide(v4f &v) { asm volatile("" : FP_HIDE_CONSTRAINT(v)); }
+inline void hide(v2d &v) { asm volatile("" : FP_HIDE_CONSTRAINT(v)); }
+
+} // namespace smbm
@@ -11,6 +11,11 @@ static inline void gen_imul(char *&p, int operand0, int operand1) {
     *(uint32_t*)p = 0x9b007c00 | operand0 | (operand1<<5) | (operand1<<16);
     p += 4;
 }
+/* mul operand0, operand0, operand1 */
+static inline void gen_imul_by(char *&p, int operand0, int operand1) {
+    *(uint32_t*)p = 0x9b007c00 | operand0 | (operand0<<5) | (operand1<<16);
+    p += 4;
+}
 
 
 static inline void gen_ior(char *&p, int operand0, int operand1) {
@@ -33,6 +38,60 @@ static inline void gen_load64(char *&p, int operand0, int operand1) {
     p += 4;
 }
 
+static inline void gen_store64(char *&p, int base, int src) {
+    /* str src, [base] */
+    *(uint32_t*)p = 0xf9000000 | src | (base<<5);
+    p += 4;
+}
+
+static inline void gen_shl_imm(char *&p, int operand0) {
+    /* lsl operand0, operand0, 1 */
+    *(uint32_t*)p = 0xd37ff800 | operand0 | (operand0<<5);
+    p += 4;
+}
+
+static inline void gen_jmp_next(char *&p) {
+    /* b .+4 */
+    *(uint32_t*)p = 0x14000001;
+    p += 4;
+}
+
+static inline void gen_vclear(char *&p, int operand0) {
+    /* movi operand0.2d, 0 */
+    *(uint32_t*)p = 0x6f00e400 | operand0;
+    p += 4;
+}
+
+static inline void gen_vload_splat(char *&p, int operand0, int base,
+                                   int disp8) {
+    /* ldr d0, [base, disp8] ; dup v0.2d, v0.d[0] */
+    *(uint32_t*)p = 0xfd400000 | ((disp8/8)<<10) | (base<<5) | operand0;
+    p += 4;
+    *(uint32_t*)p = 0x4e080400 | operand0 | (operand0<<5);
+    p += 4;
+}
+
+static inline void gen_vdiv(char *&p, int operand0, int operand1) {
+    /* fdiv d0, d0, d1 */
+    *(uint32_t*)p = 0x1e601800 | operand0 | (operand0<<5) | (operand1<<16);
+    p += 4;
+}
+
+static inline void gen_vshuffle(char *&p, int operand0, int operand1) {
+    /* ext v0.16b, v1.16b, v1.16b, 4 */
+    *(uint32_t*)p = 0x6e002000 | operand0 | (operand1<<5) | (operand1<<16);
+    p += 4;
+}
+
+static inline void gen_vfma(char *&p, int operand0, int operand1,
+                            bool use_fma) {
+    /* fmla v0.2d, v1.2d, v1.2d */
+    *(uint32_t*)p = 0x4e60cc00 | operand0 | (operand1<<5) | (operand1<<16);
+    p += 4;
+}
+
+static inline void gen_vzeroupper(char *&p) {}
+
 static inline void gen_nop(char *&p) {
     *(uint32_t*)p = 0xd503201f;
     p += 4;
@@ -77,6 +136,15 @@ static std::vector<int> const simple_regs = {
 static std::initializer_list<int> constexpr callee_saved_int_regs = {};
 static std::initializer_list<int> constexpr callee_saved_fp_regs = {};
 
+/* registers for PairEstimator. pair_base_reg points to scratch memory,
+ * pair_mul_reg holds the constant multiplier of MUL, v8-v15 are callee
+ * saved */
+static int const pair_base_reg = 3;
+static int const pair_mul_reg = 12;
+static std::vector<int> const pair_gpr_pool = {4, 5, 6, 7, 8, 9, 10, 11};
+static std::vector<int> const pair_vec_pool = {0,  1,  2,  3,  4,  5,  6,  7,
+                                               16, 17, 18, 19, 20, 21, 22, 23};
+
 static void loop_start(char *&p, int loop_count) {
     /* mov x0, loop_count */
     gen_setimm64(p, 0, loop_count);
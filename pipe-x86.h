@@ -27,8 +27,8 @@ static inline void gen_iadd(char *&p, int operand0, int operand1) {
     // op0 = reg
     // op1 = modrm
 
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
 
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = operand1 & 7;
@@ -39,8 +39,8 @@ static inline void gen_iadd(char *&p, int operand0, int operand1) {
 }
 
 static inline void gen_imul(char *&p, int operand0, int operand1) {
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
 
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = operand1 & 7;
@@ -51,9 +51,14 @@ static inline void gen_imul(char *&p, int operand0, int operand1) {
     *(p++) = 0xc0 | op0_modrm | op1_modrm;
 }
 
+/* operand0 *= operand1, the same as gen_imul on x86 */
+static inline void gen_imul_by(char *&p, int operand0, int operand1) {
+    gen_imul(p, operand0, operand1);
+}
+
 static inline void gen_ior(char *&p, int operand0, int operand1) {
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
 
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = operand1 & 7;
@@ -66,8 +71,8 @@ static inline void gen_ior(char *&p, int operand0, int operand1) {
 static inline void gen_iclear(char *&p, int operand0) {
     int operand1 = operand0;
 
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
 
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = operand1 & 7;
@@ -80,8 +85,8 @@ static inline void gen_iclear(char *&p, int operand0) {
 static inline void gen_imm0(char *&p, int operand0) {
     int operand1 = operand0;
 
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
 
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = operand1 & 7;
@@ -92,8 +97,8 @@ static inline void gen_imm0(char *&p, int operand0) {
 }
 
 static inline void gen_fadd(char *&p, int operand0, int operand1) {
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = (operand1 & 7);
 
@@ -106,8 +111,8 @@ static inline void gen_fadd(char *&p, int operand0, int operand1) {
 
 static inline void gen_int_to_fp(char *&p, int operand0, int operand1) {
     /* movq */
-    int op0_r = (operand0 >> 3) << 0;
-    int op1_b = (operand1 >> 3) << 2;
+    int op0_r = (operand0 >> 3) << 2;
+    int op1_b = (operand1 >> 3) << 0;
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = (operand1 & 7);
 
@@ -119,8 +124,8 @@ static inline void gen_int_to_fp(char *&p, int operand0, int operand1) {
 }
 
 static inline void gen_load64(char *&p, int operand0, int operand1) {
-    int rex_r = (operand1 >> 3) << 0;
-    int rex_b = (operand0 >> 3) << 2;
+    int rex_r = (operand0 >> 3) << 2;
+    int rex_b = (operand1 >> 3) << 0;
 
     int op0_modrm = (operand0 & 7) << 3;
     int op1_modrm = (operand1 & 7);
@@ -130,6 +135,97 @@ static inline void gen_load64(char *&p, int operand0, int operand1) {
     *(p++) = 0x00 | op0_modrm | op1_modrm;
 }
 
+static inline void gen_store64(char *&p, int base, int src) {
+    /* mov [base], src */
+    int rex_r = (src >> 3) << 2;
+    int rex_b = (base >> 3) << 0;
+
+    *(p++) = 0x48 | rex_r | rex_b;
+    *(p++) = 0x89;
+    *(p++) = 0x00 | ((src & 7) << 3) | (base & 7);
+}
+
+static inline void gen_shl_imm(char *&p, int operand0) {
+    /* shl operand0, 1 */
+    *(p++) = 0x48 | (operand0 >> 3);
+    *(p++) = 0xc1;
+    *(p++) = 0xe0 | (operand0 & 7);
+    *(p++) = 1;
+}
+
+static inline void gen_jmp_next(char *&p) {
+    /* jmp +0 (always taken) */
+    *(p++) = 0xeb;
+    *(p++) = 0x00;
+}
+
+static inline void gen_sse(char *&p, uint8_t pp, uint8_t opcode, int operand0,
+                           int operand1) {
+    *(p++) = pp;
+    if ((operand0 | operand1) & 8) {
+        *(p++) = 0x40 | ((operand0 >> 3) << 2) | (operand1 >> 3);
+    }
+    *(p++) = 0x0f;
+    *(p++) = opcode;
+    *(p++) = 0xc0 | ((operand0 & 7) << 3) | (operand1 & 7);
+}
+
+static inline void gen_vclear(char *&p, int operand0) {
+    /* pxor operand0, operand0 */
+    gen_sse(p, 0x66, 0xef, operand0, operand0);
+}
+
+static inline void gen_vload_splat(char *&p, int operand0, int base,
+                                   int disp8) {
+    /* movsd operand0, [base + disp8] ; unpcklpd operand0, operand0.
+     * base is not rsp/r12 (no SIB) */
+    *(p++) = 0xf2;
+    if ((operand0 | base) & 8) {
+        *(p++) = 0x40 | ((operand0 >> 3) << 2) | (base >> 3);
+    }
+    *(p++) = 0x0f;
+    *(p++) = 0x10;
+    *(p++) = 0x40 | ((operand0 & 7) << 3) | (base & 7);
+    *(p++) = disp8;
+
+    gen_sse(p, 0x66, 0x14, operand0, operand0);
+}
+
+static inline void gen_vdiv(char *&p, int operand0, int operand1) {
+    /* divsd operand0, operand1 */
+    gen_sse(p, 0xf2, 0x5e, operand0, operand1);
+}
+
+static inline void gen_vshuffle(char *&p, int operand0, int operand1) {
+    /* pshufd operand0, operand1, 0x1b */
+    gen_sse(p, 0x66, 0x70, operand0, operand1);
+    *(p++) = 0x1b;
+}
+
+static inline void gen_vfma(char *&p, int operand0, int operand1,
+                            bool use_fma) {
+    if (!use_fma) {
+        /* mulpd operand0, operand1 */
+        gen_sse(p, 0x66, 0x59, operand0, operand1);
+        return;
+    }
+
+    /* vfmadd231pd xmm0, xmm0, xmm1. VEX.128 keeps the upper halves clean,
+     * so mixing it with the legacy SSE ops above has no transition penalty */
+    *(p++) = 0xc4;
+    *(p++) = (((~operand0 >> 3) & 1) << 7) | (1 << 6) |
+             (((~operand1 >> 3) & 1) << 5) | 2;
+    *(p++) = (1 << 7) | ((~operand0 & 15) << 3) | 1;
+    *(p++) = 0xb8;
+    *(p++) = 0xc0 | ((operand0 & 7) << 3) | (operand1 & 7);
+}
+
+static inline void gen_vzeroupper(char *&p) {
+    *(p++) = 0xc5;
+    *(p++) = 0xf8;
+    *(p++) = 0x77;
+}
+
 static inline void gen_nop(char *&p) { *(p++) = 0x90; }
 
 static inline void gen_setimm64(char *&p, int operand, uint64_t val) {
@@ -276,6 +372,15 @@ static std::initializer_list<int> constexpr callee_saved_fp_regs = {};
 
 #endif
 
+/* registers for PairEstimator. pair_base_reg points to scratch memory,
+ * pair_mul_reg holds the constant multiplier of MUL */
+static int const pair_base_reg = RBX;
+static int const pair_mul_reg = RCX;
+static std::vector<int> const pair_gpr_pool = {RSI, RDI, R8,  R9,
+                                               R10, R11, R14, R15};
+static std::vector<int> const pair_vec_pool = {0, 1, 2,  3,  4,  5,  6,  7,
+                                               8, 9, 10, 11, 12, 13, 14, 15};
+
 static void loop_start(char *&p, int loop_count) {
     /* mov rax, loop_count */
     *(p++) = 0x48;
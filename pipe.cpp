@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <limits.h>
 #include <random>
+#include <string.h>
 
 #include "barrier.h"
 
@@ -34,6 +35,9 @@ enum class Buffer {
     ROB,
     INT_PRF,
     FP_PRF,
+    LOAD_BUFFER,
+    STORE_BUFFER,
+    SCHEDULER,
     // INT_WINDOW,
     // FP_WINDOW,
 
@@ -48,14 +52,35 @@ enum class SchedPipe {
     NUM_PIPE,
 };
 
-const char *name_table[] = {"ROB", "INT PRF",
-                            "FP PRF"}; //, "INT_WINDOW", "FP_WINDOW"};
+const char *name_table[] = {"ROB",          "INT PRF",     "FP PRF",
+                            "LOAD BUFFER",  "STORE BUFFER",
+                            "SCHEDULER"}; //, "INT_WINDOW", "FP_WINDOW"};
 const char *pipe_name_table[] = {"INT_ADD", "INT_MUL", "FP", "LD"};
 
+/* op classes of the port interference matrix */
+enum class OpClass {
+    ALU,
+    SHIFT,
+    MUL,
+    DIV,
+    LOAD,
+    STORE,
+    BRANCH,
+    VEC_FMA,
+    SHUFFLE,
+
+    NUM_OP_CLASS
+};
+
+const char *op_class_name_table[] = {"ALU",   "SHIFT",  "MUL",
+                                     "DIV",   "LOAD",   "STORE",
+                                     "BRANCH", "VEC_FMA", "SHUFFLE"};
+
 struct Loop {
     ExecutableMemory m;
     virtual void body(char *&p) = 0;
     virtual void setup(char *&p) {}
+    virtual void teardown(char *&p) {}
     Loop() { m = alloc_exeutable(1024 * 1024 * 16); }
     virtual ~Loop() { free_executable(&m); }
 
@@ -78,6 +103,7 @@ struct Loop {
         if (lc > 1) {
             loop_end(p, loop_start);
         }
+        teardown(p);
         exit_frame(p, callee_saved_int_regs, callee_saved_fp_regs);
 
         isync(m.p, p);
@@ -139,6 +165,17 @@ struct BufferEstimator : public Loop {
             case Buffer::FP_PRF:
                 gen_fadd(p, reg, reg);
                 break;
+            case Buffer::LOAD_BUFFER:
+                /* L1 hit, independent of the missing chain */
+                gen_load64(p, reg, p2_reg);
+                break;
+            case Buffer::STORE_BUFFER:
+                gen_store64(p, p2_reg, reg);
+                break;
+            case Buffer::SCHEDULER:
+                /* waits for the missing load in the scheduler */
+                gen_iadd(p, reg, cur_ld);
+                break;
                 //            case Buffer::INT_WINDOW:
                 //                if (i == 0) {
                 //                    gen_iadd(p, simple_regs[4], cur_ld);
@@ -353,6 +390,144 @@ struct SchedEstimator : public Loop {
     }
 };
 
+/* Port interference : two op classes are interleaved 1:1, each over its own
+ * half of the register pool. with t(A), t(B) the time of the ops alone and
+ * t(AB) the time of the mix,
+ *
+ *   (t(AB) - max(t(A), t(B))) / min(t(A), t(B))
+ *
+ * is ~0 when A and B run on disjoint ports and ~1 when they are serialized
+ * on the same ones. */
+struct PairEstimator : public Loop {
+    static constexpr int op_per_loop = 64;
+    static constexpr int reg_per_op = 4;
+
+    OpClass op0, op1;
+    bool pair;
+    bool use_fma;
+    uint64_t *scratch;
+
+    /* scratch[one_slot] holds 1.0, the initial value of the vector pool.
+     * scratch[0] is the target of LOAD and STORE */
+    static constexpr int one_slot = 8;
+
+    PairEstimator(OpClass op0, OpClass op1, bool pair, uint64_t *scratch)
+        : op0(op0), op1(op1), pair(pair), scratch(scratch) {
+        double one = 1.0;
+        memcpy(&scratch[one_slot], &one, sizeof(one));
+#ifdef X86
+        use_fma = have_fma();
+#else
+        use_fma = true;
+#endif
+    }
+
+    void setup(char *&p) override {
+        gen_setimm64(p, pair_base_reg, (uintptr_t)scratch);
+        /* odd, so that MUL never reaches 0, and not 1. squaring a register
+         * would reach 1 within 62 steps, MUL multiplies by this instead */
+        gen_setimm64(p, pair_mul_reg, 0x5851f42d4c957f2dULL);
+        uint64_t seed = 0x9e3779b97f4a7c15ULL;
+        for (int r : pair_gpr_pool) {
+            gen_setimm64(p, r, seed);
+            seed += 0x2545f4914f6cdd1cULL;
+        }
+        /* 1.0, so that DIV divides normal numbers, not 0/0 */
+        for (int r : pair_vec_pool) {
+            gen_vload_splat(p, r, pair_base_reg, one_slot * sizeof(uint64_t));
+        }
+    }
+
+    void teardown(char *&p) override {
+#ifdef X86
+        if (use_fma) {
+            gen_vzeroupper(p);
+        }
+#endif
+    }
+
+    /* half : 0 or 1, which half of the register pools */
+    void gen_op(char *&p, OpClass c, int half, int i) {
+        int gpr = pair_gpr_pool[half * reg_per_op + i % reg_per_op];
+        int vec_per_op = pair_vec_pool.size() / 2;
+        int vec = pair_vec_pool[half * vec_per_op + i % vec_per_op];
+
+        switch (c) {
+        case OpClass::ALU:
+            gen_iadd(p, gpr, gpr);
+            break;
+        case OpClass::SHIFT:
+            gen_shl_imm(p, gpr);
+            break;
+        case OpClass::MUL:
+            gen_imul_by(p, gpr, pair_mul_reg);
+            break;
+        case OpClass::DIV:
+            gen_vdiv(p, vec, vec);
+            break;
+        case OpClass::LOAD:
+            gen_load64(p, gpr, pair_base_reg);
+            break;
+        case OpClass::STORE:
+            gen_store64(p, pair_base_reg, gpr);
+            break;
+        case OpClass::BRANCH:
+            gen_jmp_next(p);
+            break;
+        case OpClass::VEC_FMA:
+            gen_vfma(p, vec, vec, use_fma);
+            break;
+        case OpClass::SHUFFLE:
+            gen_vshuffle(p, vec, vec);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void body(char *&p) override {
+        for (int i = 0; i < op_per_loop; i++) {
+            gen_op(p, op0, 0, i);
+            if (pair) {
+                gen_op(p, op1, 1, i);
+            }
+        }
+    }
+
+    /* cycle (or nsec) per loop */
+    double run(GlobalState const *g) {
+        run_func();
+
+        int ntry = 4;
+        uint64_t min = -1ULL;
+        bool use_cycle = g->is_hw_perf_counter_available();
+
+        for (int i = 0; i < ntry; i++) {
+            uint64_t d = 0;
+            if (use_cycle) {
+#ifdef HAVE_HW_PERF_COUNTER
+                auto c0 = g->get_hw_cpucycle();
+                run_func();
+                auto c1 = g->get_hw_cpucycle();
+                d = c1 - c0;
+#endif
+            } else {
+                auto c0 = userland_timer_value::get();
+                run_func();
+                auto c1 = userland_timer_value::get();
+                d = c1 - c0;
+            }
+            min = std::min(d, min);
+        }
+
+        if (use_cycle) {
+            return min / (double)loop_count();
+        }
+        return (1e9 * g->userland_timer_delta_to_sec(min)) /
+               (double)loop_count();
+    }
+};
+
 static inline int reverse_bit(int bits, int nbits) {
     int ret = 0;
     for (int i = 0; i < nbits; i++) {
@@ -368,7 +543,9 @@ static inline int reverse_bit(int bits, int nbits) {
 typedef Table1DBenchDesc<int, std::string> parent_t;
 
 struct CPUCorePipeline : public parent_t {
-    CPUCorePipeline() : parent_t("cpucore_pipeline", HIGHER_IS_BETTER) {}
+    CPUCorePipeline() : parent_t("cpucore_pipeline", HIGHER_IS_BETTER) {
+        tags = {TAG_CPU};
+    }
 
 #ifdef STATIC_AVAILABLE
     virtual result_t run(GlobalState const *g) override {
@@ -586,10 +763,68 @@ struct CPUCorePipeline : public parent_t {
     }
 };
 
+typedef Table2DBenchDesc<double, std::string, std::string> port_parent_t;
+
+struct CPUCorePortInterference : public port_parent_t {
+    CPUCorePortInterference()
+        : port_parent_t("cpucore_port_interference", LOWER_IS_BETTER) {
+        tags = {TAG_CPU};
+    }
+
+#ifdef STATIC_AVAILABLE
+    virtual result_t run(GlobalState const *g) override {
+        int nclass = (int)OpClass::NUM_OP_CLASS;
+        std::vector<uint64_t> scratch(16);
+
+        std::vector<double> alone(nclass);
+        for (int ci = 0; ci < nclass; ci++) {
+            PairEstimator pe((OpClass)ci, (OpClass)ci, false, &scratch[0]);
+            pe.gen();
+            alone[ci] = pe.run(g);
+        }
+
+        auto table = new table_t("op", "op", nclass, nclass);
+        for (int ci = 0; ci < nclass; ci++) {
+            table->row_label[ci] = op_class_name_table[ci];
+            table->column_label[ci] = op_class_name_table[ci];
+        }
+
+        for (int ri = 0; ri < nclass; ri++) {
+            for (int ci = 0; ci < nclass; ci++) {
+                PairEstimator pe((OpClass)ri, (OpClass)ci, true, &scratch[0]);
+                pe.gen();
+                double t = pe.run(g);
+
+                double hi = std::max(alone[ri], alone[ci]);
+                double lo = std::min(alone[ri], alone[ci]);
+
+                (*table)[ri][ci] = lo > 0 ? std::max(0.0, (t - hi) / lo) : 0;
+            }
+        }
+
+        return result_t(table);
+    }
+#else
+    virtual result_t run(GlobalState const *g) override { return result_t(); }
+#endif
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+#ifndef STATIC_AVAILABLE
+        return false;
+#endif
+        return true;
+    }
+};
+
 } // namespace
 
 std::unique_ptr<BenchDesc> get_cpucore_pipeline_desc() {
     return std::unique_ptr<BenchDesc>(new CPUCorePipeline());
 }
+std::unique_ptr<BenchDesc> get_cpucore_port_interference_desc() {
+    return std::unique_ptr<BenchDesc>(new CPUCorePortInterference());
+}
 
 } // namespace smbm
@@ -0,0 +1,271 @@
+/* Hardware and software prefetch.
+ *
+ * The buffer (size bytes, beyond the LLC by default) is split in one region
+ * per stream, and each step loads one word from every stream. Columns are
+ * the number of concurrent streams.
+ *
+ * random[ns/line] : each stream visits the lines of its region in random
+ *                   order, as random-access-para. the baseline
+ * fwd/bwd <n>B    : constant stride of n bytes, up or down. the value is
+ *                   ns/line relative to random (< 1 : the prefetcher helps)
+ * ... t0/nta +<d> : the same with __builtin_prefetch d accesses ahead, with
+ *                   high (prefetcht0) or no (prefetchnta) temporal locality
+ *
+ * With a stride smaller than a cache line, ns/line counts 64/stride loads
+ * as one line.
+ */
+
+#include "cpu-feature.h"
+#include "memalloc.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+
+#include <algorithm>
+#include <random>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+enum Hint { HINT_NONE, HINT_T0, HINT_NTA };
+
+const char *const hint_name[] = {"", "t0", "nta"};
+
+/* __builtin_prefetch wants constant arguments */
+template <int H> inline void prefetch(char const *p) {
+    if (H == HINT_T0) {
+        __builtin_prefetch(p, 0, 3);
+    } else if (H == HINT_NTA) {
+        __builtin_prefetch(p, 0, 0);
+    }
+}
+
+struct Streams {
+    char *buf;
+    size_t region;   /* bytes per stream */
+    int nstream;
+    uint32_t *order; /* [nstream][nline], line index in the region */
+    size_t nline;
+};
+
+/* off is the position in every region, in bytes. stride may be negative */
+template <int H>
+uint64_t run_strided(Streams const *s, ptrdiff_t stride, ptrdiff_t dist,
+                     ptrdiff_t *off, uint64_t n) {
+    ptrdiff_t region = s->region;
+    ptrdiff_t o = *off;
+    ptrdiff_t pf = o + dist;
+    if (pf >= region) {
+        pf -= region;
+    } else if (pf < 0) {
+        pf += region;
+    }
+
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        char const *p = s->buf;
+        for (int j = 0; j < s->nstream; j++) {
+            prefetch<H>(p + pf);
+            sum += *(uint64_t const *)(p + o);
+            p += region;
+        }
+
+        o += stride;
+        pf += stride;
+        if (o >= region) {
+            o -= region;
+        } else if (o < 0) {
+            o += region;
+        }
+        if (pf >= region) {
+            pf -= region;
+        } else if (pf < 0) {
+            pf += region;
+        }
+    }
+    *off = o;
+    return sum;
+}
+
+template <int H>
+uint64_t run_random(Streams const *s, size_t dist, size_t *pos, uint64_t n) {
+    size_t nline = s->nline;
+    size_t p = *pos;
+    size_t pf = (p + dist) % nline;
+
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        char const *b = s->buf;
+        uint32_t const *order = s->order;
+        for (int j = 0; j < s->nstream; j++) {
+            prefetch<H>(b + (size_t)order[pf] * CACHELINE_SIZE);
+            sum += *(uint64_t const *)(b + (size_t)order[p] * CACHELINE_SIZE);
+            b += s->region;
+            order += nline;
+        }
+
+        if (++p == nline) {
+            p = 0;
+        }
+        if (++pf == nline) {
+            pf = 0;
+        }
+    }
+    *pos = p;
+    return sum;
+}
+
+struct Pattern {
+    std::string label;
+    int stride; /* bytes, 0 is random */
+    bool backward;
+    int hint;
+    int dist; /* accesses ahead */
+};
+
+std::vector<Pattern> patterns() {
+    std::vector<Pattern> ret;
+    ret.push_back({"random[ns/line]", 0, false, HINT_NONE, 0});
+
+    for (int bwd = 0; bwd < 2; bwd++) {
+        for (int stride = 8; stride <= 8192; stride *= 2) {
+            ret.push_back({std::string(bwd ? "bwd " : "fwd ") +
+                               std::to_string(stride) + "B",
+                           stride, bwd != 0, HINT_NONE, 0});
+        }
+    }
+
+    /* the line stream the prefetcher follows, a page crossing stride it
+     * usually does not, and random */
+    for (int stride : {64, 4096, 0}) {
+        for (int hint : {HINT_T0, HINT_NTA}) {
+            for (int dist : {4, 16, 64}) {
+                std::string base =
+                    stride ? "fwd " + std::to_string(stride) + "B" : "random";
+                ret.push_back({base + " " + hint_name[hint] + " +" +
+                                   std::to_string(dist),
+                               stride, false, hint, dist});
+            }
+        }
+    }
+    return ret;
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct Prefetcher : public parent_t {
+    Prefetcher() : parent_t("prefetcher", LOWER_IS_BETTER) {
+        tags = {TAG_MEMORY};
+        add_param("size", 256 * 1024 * 1024, "buffer size [bytes]");
+        add_param("max_streams", 64, "largest number of streams");
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        size_t size = (size_t)param("size");
+        int max_streams = std::max(1, (int)param("max_streams"));
+        double duration = param("duration");
+
+        std::vector<int> nstreams;
+        for (int s = 1; s <= max_streams; s *= 2) {
+            nstreams.push_back(s);
+        }
+        auto pats = patterns();
+
+        /* regions stay page aligned and hold the largest stride */
+        size = std::max<size_t>(size, (size_t)nstreams.back() * 16 * 1024);
+        char *buf = (char *)aligned_calloc(4096, size);
+        /* untouched pages all map to the zero page */
+        memset(buf, 1, size);
+        std::vector<uint32_t> order(size / CACHELINE_SIZE);
+
+        auto t = new table_t("pattern", "streams", pats.size(),
+                             nstreams.size());
+        for (size_t pi = 0; pi < pats.size(); pi++) {
+            t->row_label[pi] = pats[pi].label;
+        }
+
+        for (size_t si = 0; si < nstreams.size(); si++) {
+            Streams s;
+            s.buf = buf;
+            s.nstream = nstreams[si];
+            s.region = size / s.nstream / 4096 * 4096;
+            s.nline = s.region / CACHELINE_SIZE;
+            s.order = order.data();
+            t->column_label[si] = std::to_string(s.nstream);
+
+            std::mt19937 rand(1);
+            for (int j = 0; j < s.nstream; j++) {
+                uint32_t *o = s.order + j * s.nline;
+                for (size_t i = 0; i < s.nline; i++) {
+                    o[i] = i;
+                }
+                std::shuffle(o, o + s.nline, rand);
+            }
+
+            double random_ns = 0;
+            for (size_t pi = 0; pi < pats.size(); pi++) {
+                Pattern const &p = pats[pi];
+                double ns = measure(g, &s, p, duration) / s.nstream * 1e9;
+                if (p.stride == 0) {
+                    if (p.hint == HINT_NONE) {
+                        random_ns = ns;
+                        (*t)[pi][si] = ns;
+                        continue;
+                    }
+                } else if (p.stride < CACHELINE_SIZE) {
+                    ns *= CACHELINE_SIZE / p.stride;
+                }
+                (*t)[pi][si] = ns / random_ns;
+            }
+        }
+
+        aligned_free(buf);
+
+        return result_t(t);
+    }
+
+    /* sec per step */
+    double measure(GlobalState const *g, Streams const *s, Pattern const &p,
+                   double duration) {
+        uint64_t sum = 0;
+        CalibratedRun r;
+
+        if (p.stride == 0) {
+            size_t pos = 0;
+            size_t dist = std::min<size_t>(p.dist, s->nline - 1);
+            auto f = p.hint == HINT_T0    ? run_random<HINT_T0>
+                     : p.hint == HINT_NTA ? run_random<HINT_NTA>
+                                          : run_random<HINT_NONE>;
+            r = run_calibrated(
+                g, [&](uint64_t n) { sum += f(s, dist, &pos, n); }, duration);
+        } else {
+            ptrdiff_t stride = p.backward ? -p.stride : p.stride;
+            ptrdiff_t off = p.backward ? s->region - sizeof(uint64_t) : 0;
+            ptrdiff_t dist = (ptrdiff_t)p.dist * stride % (ptrdiff_t)s->region;
+            auto f = p.hint == HINT_T0    ? run_strided<HINT_T0>
+                     : p.hint == HINT_NTA ? run_strided<HINT_NTA>
+                                          : run_strided<HINT_NONE>;
+            r = run_calibrated(
+                g, [&](uint64_t n) { sum += f(s, stride, dist, &off, n); },
+                duration);
+        }
+
+        g->dummy_write(0, sum);
+        return r.sec_per_unit();
+    }
+
+    int double_precision() override { return 2; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_prefetcher_desc() {
+    return std::unique_ptr<BenchDesc>(new Prefetcher());
+}
+
+} // namespace smbm
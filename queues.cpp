@@ -0,0 +1,616 @@
+/* Inter-thread message queues.
+ *
+ * spsc  : single producer / single consumer ring, producer and consumer
+ *         cache the index of the other side
+ * mpsc  : bounded ring with a sequence per slot (Vyukov), producers claim
+ *         a whole batch with one fetch_add, the consumer needs no RMW
+ * mpmc  : Vyukov's bounded MPMC queue, one CAS per message on both sides
+ * mutex : ring under a std::mutex, with not_empty / not_full condvars
+ *
+ * Messages of msg_size bytes are copied in and out of the slots. Rows are
+ * queue x placement x message size, placement is where the consumer runs
+ * relative to the producer on logical processor 0 (same processor, SMT
+ * sibling, shared LLC, same package, other package, as found by
+ * ProcessorTable). "all" uses every processor, half of them consumers for
+ * the multi consumer queues, one consumer otherwise.
+ *
+ * queues         : b<N>[Mmsg/s], throughput with messages pushed and
+ *                  popped N at a time. mpmc pushes and pops the batch one
+ *                  message at a time
+ * queues-latency : latency[ns], one way, half of a ping-pong round trip
+ *                  through two queues with one message in flight. only the
+ *                  one producer / one consumer placements
+ *
+ * A waiting side spins, and gives up its time slice after 1024 spins, so
+ * that the same processor placement makes progress.
+ */
+
+#include "cpu-feature.h"
+#include "cpuset.h"
+#include "memalloc.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+inline void backoff(int *spin) {
+    if (++*spin < 1024) {
+        yield_thread();
+    } else {
+        std::this_thread::yield();
+        *spin = 0;
+    }
+}
+
+/* msg_size bytes per slot, plus an optional sequence word in front */
+struct Slots {
+    char *buf;
+    size_t stride;
+    size_t mask;
+
+    Slots(size_t cap, size_t msg_size, size_t header)
+        : stride((header + msg_size + 7) & ~(size_t)7), mask(cap - 1) {
+        buf = (char *)aligned_calloc(CACHELINE_SIZE, stride * cap);
+    }
+    ~Slots() { aligned_free(buf); }
+
+    char *slot(uint64_t pos) const { return buf + (pos & mask) * stride; }
+};
+
+struct SPSCRing {
+    static constexpr bool MULTI_PRODUCER = false;
+    static constexpr bool MULTI_CONSUMER = false;
+
+    Slots s;
+    size_t cap, msg_size;
+
+    /* producer side */
+    alignas(CACHELINE_SIZE) std::atomic<uint64_t> tail;
+    uint64_t head_cache;
+
+    /* consumer side */
+    alignas(CACHELINE_SIZE) std::atomic<uint64_t> head;
+    uint64_t tail_cache;
+
+    SPSCRing(size_t cap, size_t msg_size)
+        : s(cap, msg_size, 0), cap(cap), msg_size(msg_size), tail(0),
+          head_cache(0), head(0), tail_cache(0) {}
+
+    void push(char const *msgs, int n) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        int spin = 0;
+        while (t + n - head_cache > cap) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t + n - head_cache > cap) {
+                backoff(&spin);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            memcpy(s.slot(t + i), msgs + i * msg_size, msg_size);
+        }
+        tail.store(t + n, std::memory_order_release);
+    }
+
+    int pop(char *out, int max) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (tail_cache == h) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (tail_cache == h) {
+                return 0;
+            }
+        }
+        int n = (int)std::min<uint64_t>(max, tail_cache - h);
+        for (int i = 0; i < n; i++) {
+            memcpy(out + i * msg_size, s.slot(h + i), msg_size);
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    void close() {}
+};
+
+typedef std::atomic<uint64_t> seq_t;
+
+/* slot `pos` is free for the lap when seq == pos, full when seq == pos + 1 */
+struct SeqSlots : public Slots {
+    SeqSlots(size_t cap, size_t msg_size)
+        : Slots(cap, msg_size, sizeof(seq_t)) {
+        for (size_t i = 0; i < cap; i++) {
+            new (seq(i)) seq_t(i);
+        }
+    }
+
+    seq_t *seq(uint64_t pos) const { return (seq_t *)slot(pos); }
+    char *payload(uint64_t pos) const { return slot(pos) + sizeof(seq_t); }
+};
+
+struct MPSCRing {
+    static constexpr bool MULTI_PRODUCER = true;
+    static constexpr bool MULTI_CONSUMER = false;
+
+    SeqSlots s;
+    size_t cap, msg_size;
+
+    alignas(CACHELINE_SIZE) std::atomic<uint64_t> tail;
+    alignas(CACHELINE_SIZE) uint64_t head;
+
+    MPSCRing(size_t cap, size_t msg_size)
+        : s(cap, msg_size), cap(cap), msg_size(msg_size), tail(0), head(0) {}
+
+    void push(char const *msgs, int n) {
+        uint64_t pos = tail.fetch_add(n, std::memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            uint64_t p = pos + i;
+            int spin = 0;
+            while (s.seq(p)->load(std::memory_order_acquire) != p) {
+                backoff(&spin);
+            }
+            memcpy(s.payload(p), msgs + i * msg_size, msg_size);
+            s.seq(p)->store(p + 1, std::memory_order_release);
+        }
+    }
+
+    int pop(char *out, int max) {
+        int n = 0;
+        while (n < max &&
+               s.seq(head)->load(std::memory_order_acquire) == head + 1) {
+            memcpy(out + n * msg_size, s.payload(head), msg_size);
+            s.seq(head)->store(head + cap, std::memory_order_release);
+            head++;
+            n++;
+        }
+        return n;
+    }
+
+    void close() {}
+};
+
+struct MPMCRing {
+    static constexpr bool MULTI_PRODUCER = true;
+    static constexpr bool MULTI_CONSUMER = true;
+
+    SeqSlots s;
+    size_t cap, msg_size;
+
+    alignas(CACHELINE_SIZE) std::atomic<uint64_t> tail;
+    alignas(CACHELINE_SIZE) std::atomic<uint64_t> head;
+
+    MPMCRing(size_t cap, size_t msg_size)
+        : s(cap, msg_size), cap(cap), msg_size(msg_size), tail(0), head(0) {}
+
+    void push1(char const *msg) {
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        int spin = 0;
+        while (1) {
+            int64_t dif =
+                (int64_t)(s.seq(pos)->load(std::memory_order_acquire) - pos);
+            if (dif == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                /* full */
+                backoff(&spin);
+                pos = tail.load(std::memory_order_relaxed);
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        memcpy(s.payload(pos), msg, msg_size);
+        s.seq(pos)->store(pos + 1, std::memory_order_release);
+    }
+
+    bool pop1(char *out) {
+        uint64_t pos = head.load(std::memory_order_relaxed);
+        while (1) {
+            int64_t dif = (int64_t)(
+                s.seq(pos)->load(std::memory_order_acquire) - (pos + 1));
+            if (dif == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        memcpy(out, s.payload(pos), msg_size);
+        s.seq(pos)->store(pos + cap, std::memory_order_release);
+        return true;
+    }
+
+    void push(char const *msgs, int n) {
+        for (int i = 0; i < n; i++) {
+            push1(msgs + i * msg_size);
+        }
+    }
+
+    int pop(char *out, int max) {
+        int n = 0;
+        while (n < max && pop1(out + n * msg_size)) {
+            n++;
+        }
+        return n;
+    }
+
+    void close() {}
+};
+
+struct MutexQueue {
+    static constexpr bool MULTI_PRODUCER = true;
+    static constexpr bool MULTI_CONSUMER = true;
+
+    Slots s;
+    size_t cap, msg_size;
+
+    std::mutex m;
+    std::condition_variable not_empty, not_full;
+    uint64_t head = 0, tail = 0;
+    bool closed = false;
+
+    MutexQueue(size_t cap, size_t msg_size)
+        : s(cap, msg_size, 0), cap(cap), msg_size(msg_size) {}
+
+    void push(char const *msgs, int n) {
+        std::unique_lock<std::mutex> lk(m);
+        not_full.wait(lk, [this, n] { return tail + n - head <= cap; });
+        for (int i = 0; i < n; i++) {
+            memcpy(s.slot(tail + i), msgs + i * msg_size, msg_size);
+        }
+        tail += n;
+        lk.unlock();
+        not_empty.notify_one();
+    }
+
+    /* blocks until there is a message, 0 only when closed */
+    int pop(char *out, int max) {
+        std::unique_lock<std::mutex> lk(m);
+        not_empty.wait(lk, [this] { return tail != head || closed; });
+        int n = (int)std::min<uint64_t>(max, tail - head);
+        for (int i = 0; i < n; i++) {
+            memcpy(out + i * msg_size, s.slot(head + i), msg_size);
+        }
+        head += n;
+        lk.unlock();
+        not_full.notify_all();
+        return n;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lk(m);
+        closed = true;
+        not_empty.notify_all();
+    }
+};
+
+struct Placement {
+    std::string name;
+    std::vector<int> producers, consumers; /* logical processor index */
+};
+
+template <typename Q> struct Shared {
+    GlobalState const *g;
+    Q *q;
+    size_t msg_size;
+    int batch;
+    uint64_t per_producer;
+    uint64_t total;
+    int nconsumer;
+
+    atomic_int_t start_barrier;
+    std::atomic<uint64_t> consumed;
+    std::atomic<uint64_t> sum;
+};
+
+template <typename Q> struct ThreadInfo {
+    thread_handle_t thread;
+    Shared<Q> *s;
+    int proc;
+    int id;
+    bool producer;
+    int nthread;
+};
+
+void bind_proc(GlobalState const *g, int proc) {
+    auto pi = g->proc_table->logical_index_to_processor(
+        proc, PROC_ORDER_OUTER_TO_INNER);
+    bind_self_to_1proc(g->proc_table, pi, true);
+}
+
+template <typename Q> void *queue_thread(void *p) {
+    ThreadInfo<Q> *ti = (ThreadInfo<Q> *)p;
+    Shared<Q> *s = ti->s;
+    std::vector<char> buf(s->msg_size * s->batch);
+
+    bind_proc(s->g, ti->proc);
+    wait_barrier(&s->start_barrier, ti->nthread);
+
+    if (ti->producer) {
+        /* the first word of a message is its number, 1 .. total */
+        uint64_t v = ti->id * s->per_producer + 1;
+        for (uint64_t i = 0; i < s->per_producer; i += s->batch) {
+            int n = (int)std::min<uint64_t>(s->batch, s->per_producer - i);
+            for (int j = 0; j < n; j++) {
+                memcpy(&buf[j * s->msg_size], &v, sizeof(v));
+                v++;
+            }
+            s->q->push(buf.data(), n);
+        }
+        return nullptr;
+    }
+
+    uint64_t sum = 0;
+    uint64_t local = 0;
+    int spin = 0;
+    while (1) {
+        int n = s->q->pop(buf.data(), s->batch);
+        if (n == 0) {
+            if (s->consumed.load(std::memory_order_relaxed) == s->total) {
+                break;
+            }
+            backoff(&spin);
+            continue;
+        }
+        for (int j = 0; j < n; j++) {
+            uint64_t v;
+            memcpy(&v, &buf[j * s->msg_size], sizeof(v));
+            sum += v;
+        }
+        if (s->nconsumer == 1) {
+            local += n;
+            if (local == s->total) {
+                break;
+            }
+        } else if (s->consumed.fetch_add(n) + n == s->total) {
+            /* wakes up the consumers blocked in the mutex queue */
+            s->q->close();
+            break;
+        }
+    }
+    s->sum += sum;
+    return nullptr;
+}
+
+/* messages / sec */
+template <typename Q>
+double run_throughput(GlobalState const *g, Placement const &pl, size_t cap,
+                      size_t msg_size, int batch, uint64_t total) {
+    Q q(cap, msg_size);
+    Shared<Q> s;
+    int nproducer = pl.producers.size();
+    s.g = g;
+    s.q = &q;
+    s.msg_size = msg_size;
+    s.batch = batch;
+    s.per_producer = total / nproducer;
+    s.total = s.per_producer * nproducer;
+    s.nconsumer = pl.consumers.size();
+    s.start_barrier = 0;
+    s.consumed = 0;
+    s.sum = 0;
+
+    int nthread = nproducer + s.nconsumer;
+    std::vector<ThreadInfo<Q>> ti(nthread);
+    for (int i = 0; i < nthread; i++) {
+        ti[i].s = &s;
+        ti[i].producer = i < nproducer;
+        ti[i].id = ti[i].producer ? i : i - nproducer;
+        ti[i].proc = ti[i].producer ? pl.producers[i]
+                                    : pl.consumers[i - nproducer];
+        ti[i].nthread = nthread + 1;
+        ti[i].thread = spawn_thread(queue_thread<Q>, &ti[i]);
+    }
+
+    wait_barrier(&s.start_barrier, nthread + 1);
+    auto t0 = userland_timer_value::get();
+    for (int i = 0; i < nthread; i++) {
+        wait_thread(ti[i].thread);
+    }
+    auto t1 = userland_timer_value::get();
+
+    if (s.sum != s.total * (s.total + 1) / 2) {
+        fprintf(stderr, "queues: lost or duplicated messages\n");
+        abort();
+    }
+
+    return s.total / g->userland_timer_delta_to_sec(t1 - t0);
+}
+
+template <typename Q> struct PingPong {
+    GlobalState const *g;
+    Q *to_b, *to_a;
+    size_t msg_size;
+    int rounds;
+    int proc_b;
+};
+
+template <typename Q> void *pingpong_b(void *p) {
+    PingPong<Q> *pp = (PingPong<Q> *)p;
+    std::vector<char> msg(pp->msg_size);
+    bind_proc(pp->g, pp->proc_b);
+    for (int r = 0; r < pp->rounds; r++) {
+        int spin = 0;
+        while (pp->to_b->pop(msg.data(), 1) == 0) {
+            backoff(&spin);
+        }
+        pp->to_a->push(msg.data(), 1);
+    }
+    return nullptr;
+}
+
+/* sec, one way */
+template <typename Q>
+double run_latency(GlobalState const *g, int proc_a, int proc_b, size_t cap,
+                   size_t msg_size, int rounds) {
+    Q to_b(cap, msg_size), to_a(cap, msg_size);
+    PingPong<Q> pp = {g, &to_b, &to_a, msg_size, rounds, proc_b};
+    std::vector<char> msg(msg_size);
+
+    bind_proc(g, proc_a);
+    thread_handle_t t = spawn_thread(pingpong_b<Q>, &pp);
+
+    auto t0 = userland_timer_value::get();
+    for (int r = 0; r < rounds; r++) {
+        to_b.push(msg.data(), 1);
+        int spin = 0;
+        while (to_a.pop(msg.data(), 1) == 0) {
+            backoff(&spin);
+        }
+    }
+    auto t1 = userland_timer_value::get();
+
+    wait_thread(t);
+    bind_self_to_first(g->proc_table, true);
+
+    return g->userland_timer_delta_to_sec(t1 - t0) / rounds / 2;
+}
+
+const int batches[] = {1, 16, 256};
+const size_t msg_sizes[] = {8, 64, 256};
+const int NBATCH = sizeof(batches) / sizeof(batches[0]);
+const int NSIZE = sizeof(msg_sizes) / sizeof(msg_sizes[0]);
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct Queues : public parent_t {
+    bool latency;
+
+    Queues(bool latency)
+        : parent_t(latency ? "queues-latency" : "queues",
+                   latency ? LOWER_IS_BETTER : HIGHER_IS_BETTER),
+          latency(latency) {
+        tags = {TAG_THREADING};
+        add_param("capacity", 1024, "queue capacity [messages], power of 2");
+        if (latency) {
+            add_param("rounds", 1 << 14, "ping-pong round trips");
+        } else {
+            add_param("messages", 1 << 20, "messages per throughput run");
+        }
+    }
+
+    std::vector<Placement> placements(GlobalState const *g) {
+        std::vector<Placement> ret;
+        ret.push_back({"same-processor", {0}, {0}});
+        for (int rel = 0; rel < NPROC_REL; rel++) {
+            int p = g->proc_table->find_related_processor(
+                0, PROC_ORDER_OUTER_TO_INNER, rel);
+            if (p >= 0) {
+                ret.push_back({proc_relation_name[rel], {0}, {p}});
+            }
+        }
+        return ret;
+    }
+
+    /* every processor, for the multi producer queues */
+    Placement all(GlobalState const *g, bool multi_consumer) {
+        int n = g->proc_table->get_active_cpu_count();
+        int ncons = multi_consumer ? n / 2 : 1;
+        Placement pl{"all", {}, {}};
+        for (int i = 0; i < n; i++) {
+            if (i < n - ncons) {
+                pl.producers.push_back(i);
+            } else {
+                pl.consumers.push_back(i);
+            }
+        }
+        return pl;
+    }
+
+    template <typename Q>
+    void run_queue(GlobalState const *g, const char *name, table_t *t,
+                   int *row) {
+        size_t cap = 1;
+        while (cap < param("capacity") || cap < (size_t)batches[NBATCH - 1]) {
+            cap *= 2;
+        }
+
+        auto pls = placements(g);
+        if (!latency && Q::MULTI_PRODUCER &&
+            g->proc_table->get_active_cpu_count() >= 3) {
+            pls.push_back(all(g, Q::MULTI_CONSUMER));
+        }
+
+        for (auto const &pl : pls) {
+            for (int si = 0; si < NSIZE; si++) {
+                size_t sz = msg_sizes[si];
+                t->row_label[*row] = std::string(name) + " " + pl.name + " " +
+                                     std::to_string(sz) + "B";
+                if (latency) {
+                    int rounds = std::max(1, (int)param("rounds"));
+                    (*t)[*row][0] =
+                        run_latency<Q>(g, pl.producers[0], pl.consumers[0],
+                                       cap, sz, rounds) *
+                        1e9;
+                } else {
+                    uint64_t total =
+                        std::max(1 << 10, (int)param("messages"));
+                    for (int bi = 0; bi < NBATCH; bi++) {
+                        (*t)[*row][bi] = run_throughput<Q>(g, pl, cap, sz,
+                                                           batches[bi], total) /
+                                         1e6;
+                    }
+                }
+                (*row)++;
+            }
+        }
+    }
+
+    result_t run(GlobalState const *g) override {
+        int nrow = 0;
+        int nall =
+            !latency && g->proc_table->get_active_cpu_count() >= 3 ? 1 : 0;
+        int npl = placements(g).size();
+        nrow += npl * NSIZE;                 /* spsc */
+        nrow += 3 * (npl + nall) * NSIZE;    /* mpsc, mpmc, mutex */
+
+        table_t *t;
+        if (latency) {
+            t = new table_t("queue", "measure", nrow, 1);
+            t->column_label[0] = "latency[ns]";
+        } else {
+            t = new table_t("queue", "measure", nrow, NBATCH);
+            for (int bi = 0; bi < NBATCH; bi++) {
+                t->column_label[bi] =
+                    "b" + std::to_string(batches[bi]) + "[Mmsg/s]";
+            }
+        }
+
+        int row = 0;
+        run_queue<SPSCRing>(g, "spsc", t, &row);
+        run_queue<MPSCRing>(g, "mpsc", t, &row);
+        run_queue<MPMCRing>(g, "mpmc", t, &row);
+        run_queue<MutexQueue>(g, "mutex", t, &row);
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_queues_desc() {
+    return std::unique_ptr<BenchDesc>(new Queues(false));
+}
+std::unique_ptr<BenchDesc> get_queues_latency_desc() {
+    return std::unique_ptr<BenchDesc>(new Queues(true));
+}
+
+} // namespace smbm
@@ -0,0 +1,303 @@
+/* SIMD kernel throughput.
+ *
+ * Each kernel (see simd-kernels.h) has a plain C version and, where the ISA
+ * has a natural way to do it, SSE / AVX2 / AVX-512 / NEON versions. The
+ * ISA versions are used only when cpu-feature reports the extensions they
+ * need. Rows are kernel x ISA, columns the size of one array, from L1 to
+ * DRAM. gather is run with sequential, random and cache resident (random
+ * in the first 16KiB) indices.
+ */
+
+#include "cpu-feature.h"
+#include "memalloc.h"
+#include "simd-kernels.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+
+#include <random>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+uint64_t dot_c(SimdKernelArg const *a) {
+    float sum = 0;
+    for (size_t i = 0; i < a->n; i++) {
+        sum += a->fa[i] * a->fb[i];
+    }
+    return (uint64_t)sum;
+}
+
+uint64_t gather_c(SimdKernelArg const *a) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < a->n; i++) {
+        sum += a->ia[a->idx[i]];
+    }
+    return sum;
+}
+
+uint64_t scatter_c(SimdKernelArg const *a) {
+    for (size_t i = 0; i < a->n; i++) {
+        a->ib[a->idx[i]] = a->ia[i];
+    }
+    return a->ib[0];
+}
+
+uint64_t permute_c(SimdKernelArg const *a) {
+    for (size_t i = 0; i < a->n; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            a->ib[i + j] = a->ia[i + 7 - j];
+        }
+    }
+    return a->ib[0];
+}
+
+uint64_t compress_c(SimdKernelArg const *a) {
+    size_t k = 0;
+    for (size_t i = 0; i < a->n; i++) {
+        uint32_t v = a->ia[i];
+        a->ib[k] = v;
+        k += v & 1;
+    }
+    return k;
+}
+
+uint64_t expand_c(SimdKernelArg const *a) {
+    size_t k = 0;
+    for (size_t i = 0; i < a->n; i++) {
+        uint32_t sel = a->ia[i] & 1;
+        a->ib[i] = sel ? a->ia[k] : 0;
+        k += sel;
+    }
+    return k;
+}
+
+uint64_t popcount_c(SimdKernelArg const *a) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < a->n / 2; i++) {
+        sum += __builtin_popcountll(a->words[i]);
+    }
+    return sum;
+}
+
+#ifdef X86
+__attribute__((target("popcnt"))) uint64_t popcount_popcnt(
+    SimdKernelArg const *a) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < a->n / 2; i++) {
+        sum += __builtin_popcountll(a->words[i]);
+    }
+    return sum;
+}
+#endif
+
+uint64_t prefix_sum_c(SimdKernelArg const *a) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < a->n; i++) {
+        sum += a->ia[i];
+        a->ib[i] = sum;
+    }
+    return sum;
+}
+
+const char *kernel_name[] = {"dot",      "gather",   "scatter",
+                             "permute",  "compress", "expand",
+                             "popcount", "prefix-sum"};
+const char *isa_name[] = {"c", "sse", "avx2", "avx512", "neon"};
+
+enum GatherIndex { GI_SEQ, GI_RANDOM, GI_RESIDENT, GI_NUM };
+const char *gather_index_name[] = {"seq", "rand", "l1"};
+
+struct Row {
+    SimdKernel kernel;
+    SimdIsa isa;
+    simd_kernel_t func;
+    GatherIndex gi;
+    std::string label;
+};
+
+struct Buffers {
+    size_t n;
+    float *fa, *fb;
+    uint32_t *ia, *ib;
+    uint32_t *idx[GI_NUM];
+
+    Buffers(size_t n) : n(n) {
+        size_t sz = n * 4;
+        fa = (float *)aligned_calloc(64, sz);
+        fb = (float *)aligned_calloc(64, sz);
+        ia = (uint32_t *)aligned_calloc(64, sz);
+        ib = (uint32_t *)aligned_calloc(64, sz);
+        for (int gi = 0; gi < GI_NUM; gi++) {
+            idx[gi] = (uint32_t *)aligned_calloc(64, sz);
+        }
+
+        std::mt19937 rand(1);
+        size_t resident = std::min(n, (size_t)4096);
+
+        for (size_t i = 0; i < n; i++) {
+            fa[i] = (rand() % 1024) / 1024.0f;
+            fb[i] = (rand() % 1024) / 1024.0f;
+            ia[i] = rand();
+            idx[GI_SEQ][i] = i;
+            idx[GI_RANDOM][i] = rand() % n;
+            idx[GI_RESIDENT][i] = rand() % resident;
+        }
+    }
+
+    ~Buffers() {
+        aligned_free(fa);
+        aligned_free(fb);
+        aligned_free(ia);
+        aligned_free(ib);
+        for (int gi = 0; gi < GI_NUM; gi++) {
+            aligned_free(idx[gi]);
+        }
+    }
+
+    SimdKernelArg arg(GatherIndex gi) {
+        SimdKernelArg a;
+        a.fa = fa;
+        a.fb = fb;
+        a.ia = ia;
+        a.ib = ib;
+        a.idx = idx[gi];
+        a.words = (uint64_t const *)ia;
+        a.n = n;
+        return a;
+    }
+};
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct SimdKernels : public parent_t {
+    SimdKernels() : parent_t("simd-kernels", LOWER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_MEMORY};
+        add_param("max_size", 64, "size of the largest array [MiB]");
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+    }
+
+    std::vector<Row> rows() {
+        simd_kernel_t tbl[ISA_NUM][SK_NUM] = {};
+
+        simd_kernels_scalar(tbl[ISA_SCALAR]);
+#ifdef X86
+        if (have_ssse3() && have_sse41()) {
+            simd_kernels_sse(tbl[ISA_SSE]);
+        }
+        if (have_avx2() && have_fma()) {
+            simd_kernels_avx2(tbl[ISA_AVX2]);
+        }
+        if (have_avx512f()) {
+            simd_kernels_avx512(tbl[ISA_AVX512]);
+            if (!have_avx512vpopcntdq()) {
+                tbl[ISA_AVX512][SK_POPCOUNT] = nullptr;
+            }
+        }
+#endif
+#ifdef AARCH64
+        simd_kernels_neon(tbl[ISA_NEON]);
+#endif
+
+        std::vector<Row> ret;
+        for (int k = 0; k < SK_NUM; k++) {
+            for (int isa = 0; isa < ISA_NUM; isa++) {
+                auto f = tbl[isa][k];
+                if (!f) {
+                    continue;
+                }
+
+                int ngi = (k == SK_GATHER) ? GI_NUM : 1;
+                for (int gi = 0; gi < ngi; gi++) {
+                    std::string label = kernel_name[k];
+                    if (k == SK_GATHER) {
+                        label += std::string("-") + gather_index_name[gi];
+                    }
+                    label += std::string(" ") + isa_name[isa];
+
+                    ret.push_back({(SimdKernel)k, (SimdIsa)isa, f,
+                                   (GatherIndex)gi, label});
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    result_t run(GlobalState const *g) override {
+        auto row_list = rows();
+
+        std::vector<size_t> sizes;
+        size_t max_size = (size_t)(param("max_size") * 1024 * 1024);
+        for (size_t sz = 16 * 1024; sz <= max_size; sz *= 8) {
+            sizes.push_back(sz);
+        }
+
+        auto t = new table_t("kernel [nsec/element]", "array size",
+                             row_list.size(), sizes.size());
+        for (size_t ri = 0; ri < row_list.size(); ri++) {
+            t->row_label[ri] = row_list[ri].label;
+        }
+
+        for (size_t si = 0; si < sizes.size(); si++) {
+            char buf[64];
+            if (sizes[si] >= 1024 * 1024) {
+                sprintf(buf, "%dMiB", (int)(sizes[si] / (1024 * 1024)));
+            } else {
+                sprintf(buf, "%dKiB", (int)(sizes[si] / 1024));
+            }
+            t->column_label[si] = buf;
+
+            Buffers buf_set(sizes[si] / 4);
+
+            for (size_t ri = 0; ri < row_list.size(); ri++) {
+                auto &r = row_list[ri];
+                SimdKernelArg a = buf_set.arg(r.gi);
+                auto f = r.func;
+
+                auto cr = run_calibrated(
+                    g,
+                    [g, f, &a](uint64_t n) {
+                        for (uint64_t i = 0; i < n; i++) {
+                            g->dummy_write(0, f(&a));
+                        }
+                    },
+                    param("duration"));
+
+                (*t)[ri][si] = cr.sec_per_unit() * 1e9 / a.n;
+            }
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 3; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+void simd_kernels_scalar(simd_kernel_t *tbl) {
+    tbl[SK_DOT] = dot_c;
+    tbl[SK_GATHER] = gather_c;
+    tbl[SK_SCATTER] = scatter_c;
+    tbl[SK_PERMUTE] = permute_c;
+    tbl[SK_COMPRESS] = compress_c;
+    tbl[SK_EXPAND] = expand_c;
+    tbl[SK_POPCOUNT] = popcount_c;
+#ifdef X86
+    if (have_popcnt()) {
+        tbl[SK_POPCOUNT] = popcount_popcnt;
+    }
+#endif
+    tbl[SK_PREFIX_SUM] = prefix_sum_c;
+}
+
+std::unique_ptr<BenchDesc> get_simd_kernels_desc() {
+    return std::unique_ptr<BenchDesc>(new SimdKernels());
+}
+
+} // namespace smbm
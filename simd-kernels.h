@@ -0,0 +1,72 @@
+#pragma once
+
+#include "sys-features.h"
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smbm {
+
+/* n is a multiple of 64. all arrays have n elements, words has n/2 */
+struct SimdKernelArg {
+    float const *fa, *fb;
+    uint32_t const *ia;
+    uint32_t const *idx; /* indices into ia (gather) or ib (scatter) */
+    uint64_t const *words;
+    uint32_t *ib;
+    size_t n;
+};
+
+/* returns a value that depends on the whole result */
+typedef uint64_t (*simd_kernel_t)(SimdKernelArg const *a);
+
+enum SimdKernel {
+    SK_DOT,         /* sum fa[i] * fb[i] */
+    SK_GATHER,      /* sum ia[idx[i]] */
+    SK_SCATTER,     /* ib[idx[i]] = ia[i] */
+    SK_PERMUTE,     /* ib = ia with each vector reversed */
+    SK_COMPRESS,    /* ia[i] with bit 0 set, packed into ib */
+    SK_EXPAND,      /* ib[i] = next element of ia if ia[i] & 1, else 0 */
+    SK_POPCOUNT,    /* sum popcount(words[i]) */
+    SK_PREFIX_SUM,  /* ib[i] = ia[0] + ... + ia[i] */
+
+    SK_NUM
+};
+
+enum SimdIsa { ISA_SCALAR, ISA_SSE, ISA_AVX2, ISA_AVX512, ISA_NEON, ISA_NUM };
+
+/* source lane of each of the nlane result lanes, for ISAs that do
+ * compress/expand with a shuffle table. -1 for lanes that are not used (the
+ * expand kernels zero them). returns the number of lanes set in mask */
+inline int simd_compress_lanes(unsigned mask, int nlane, int *lane) {
+    int k = 0;
+    for (int j = 0; j < nlane; j++) {
+        lane[j] = -1;
+    }
+    for (int j = 0; j < nlane; j++) {
+        if (mask & (1u << j)) {
+            lane[k++] = j;
+        }
+    }
+    return k;
+}
+
+inline int simd_expand_lanes(unsigned mask, int nlane, int *lane) {
+    int k = 0;
+    for (int j = 0; j < nlane; j++) {
+        lane[j] = (mask & (1u << j)) ? k++ : -1;
+    }
+    return k;
+}
+
+/* each fills the kernels it implements, the others are left as nullptr */
+void simd_kernels_scalar(simd_kernel_t *tbl);
+#ifdef X86
+void simd_kernels_sse(simd_kernel_t *tbl);
+void simd_kernels_avx2(simd_kernel_t *tbl);
+void simd_kernels_avx512(simd_kernel_t *tbl);
+#endif
+#ifdef AARCH64
+void simd_kernels_neon(simd_kernel_t *tbl);
+#endif
+
+} // namespace smbm
@@ -4,71 +4,225 @@
 #include "oneshot_timer.h"
 #include "barrier.h"
 
+#include <algorithm>
+#include <math.h>
+
 namespace smbm {
 
-template <typename F> double run_test(const GlobalState *g, F *f) {
+/* Iteration count calibration.
+ *
+ * calibrate_count() finds the number of body units per batch so that the
+ * timer read at each batch boundary costs less than
+ * g->calib_max_timer_overhead of the batch, and the timer resolution is
+ * below g->calib_max_relative_error of it.
+ *
+ * run_batches() then runs whole batches without looking at the timer
+ * inside them, until the standard error of the per-batch means drops below
+ * g->calib_max_relative_error (after at least g->calib_min_batch batches),
+ * or max_sec is spent.
+ *
+ * The cost of one timer read (measured by calibrate_timers()) is subtracted
+ * from each batch. sec_error_per_unit() is the uncertainty bound of
+ * sec_per_unit(): two standard errors of the batch means, plus the timer
+ * resolution twice (both batch boundaries) spread over the batch.
+ */
+
+struct CalibratedRun {
+    uint64_t count;      /* units executed */
+    double sec;          /* time spent for them */
+    int nbatch;          /* number of batches */
+    double sem_per_unit; /* standard error of the per-batch means */
+
+    double sec_per_unit() const { return sec / count; }
+    double sec_error_per_unit(const GlobalState *g) const {
+        double batch_count = (double)count / nbatch;
+        return 2 * sem_per_unit +
+               2 * g->get_timer_calibration().userland_timer_resolution_sec /
+                   batch_count;
+    }
+};
+
+template <typename BODY>
+uint64_t calibrate_count(const GlobalState *g, BODY const &body,
+                         double max_sec) {
+    auto &tc = g->get_timer_calibration();
+    double min_batch_sec =
+        std::max(tc.userland_timer_overhead_sec / g->calib_max_timer_overhead,
+                 tc.userland_timer_resolution_sec /
+                     g->calib_max_relative_error);
+
+    /* leave room for calib_min_batch batches in the budget */
+    double max_batch_sec = max_sec / g->calib_min_batch;
+    min_batch_sec = std::min(min_batch_sec, max_batch_sec);
+
+    uint64_t n = 1;
+
+    while (1) {
+        auto t0 = userland_timer_value::get();
+        body(n);
+        auto t1 = userland_timer_value::get();
+
+        double sec = g->userland_timer_delta_to_sec(t1 - t0);
+        if (sec >= min_batch_sec) {
+            break;
+        }
+
+        if (sec <= 0) {
+            n *= 2;
+        } else {
+            /* grow at most x16 per step, the first calls may be cold */
+            double scale = (min_batch_sec / sec) * 1.1;
+            scale = std::min(16.0, std::max(2.0, scale));
+            n = (uint64_t)(n * scale);
+        }
+    }
+
+    return n;
+}
+
+template <typename BODY>
+CalibratedRun run_batches(const GlobalState *g, BODY const &body,
+                          uint64_t batch_count, double max_sec) {
+    auto &tc = g->get_timer_calibration();
+    CalibratedRun ret = {0, 0, 0, 0};
+
+    int nbatch = 0;
+    double sum = 0, sum2 = 0;
+    double sem = 0;
+
+    auto start = userland_timer_value::get();
+
+    while (1) {
+        auto t0 = userland_timer_value::get();
+        body(batch_count);
+        auto t1 = userland_timer_value::get();
+
+        double sec = g->userland_timer_delta_to_sec(t1 - t0) -
+                     tc.userland_timer_overhead_sec;
+        sec = std::max(0.0, sec);
+        ret.count += batch_count;
+        ret.sec += sec;
+        nbatch++;
+
+        double per_unit = sec / batch_count;
+        sum += per_unit;
+        sum2 += per_unit * per_unit;
+
+        double mean = sum / nbatch;
+        if (nbatch >= 2) {
+            double var = (sum2 - nbatch * mean * mean) / (nbatch - 1);
+            sem = sqrt(std::max(0.0, var) / nbatch);
+        }
+
+        if (g->userland_timer_delta_to_sec(t1 - start) >= max_sec) {
+            break;
+        }
+
+        if (nbatch >= g->calib_min_batch) {
+            if (mean > 0 && sem / mean <= g->calib_max_relative_error) {
+                break;
+            }
+        }
+    }
+
+    ret.nbatch = nbatch;
+    ret.sem_per_unit = sem;
+
+    return ret;
+}
+
+template <typename BODY>
+CalibratedRun run_calibrated(const GlobalState *g, BODY const &body,
+                             double max_sec) {
+    uint64_t n = calibrate_count(g, body, max_sec);
+    return run_batches(g, body, n, max_sec);
+}
+
+template <typename F>
+double run_test(const GlobalState *g, F *f, double duration_sec = 0.1,
+                double *error_ns = nullptr) {
     auto a = f->alloc_arg();
 
     f->run(a);
 
-    oneshot_timer ot(2);
-    uint64_t count = 0;
-    ot.start(g, 0.1);
+    auto r = run_calibrated(
+        g,
+        [f, a](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                REP16(f->run(a););
+            }
+        },
+        duration_sec);
 
-    while (!ot.test_end()) {
-        REP16(f->run(a););
-        count++;
+    double ret = (r.sec_per_unit() / 16) * 1e9;
+    if (error_ns) {
+        *error_ns = (r.sec_error_per_unit(g) / 16) * 1e9;
     }
 
-    double dsec = ot.actual_interval_sec(g);
-    double ret = (dsec / (count*16)) * 1e9;
-
     f->free_arg(a);
 
     return ret;
 }
 
-template <typename F> double run_test_g(const GlobalState *g, F *f) {
+template <typename F>
+double run_test_g(const GlobalState *g, F *f, double duration_sec = 0.1,
+                  double *error_ns = nullptr) {
     auto a = f->alloc_arg();
 
     f->run(g, a);
 
-    oneshot_timer ot(2);
-    uint64_t count = 0;
-    ot.start(g, 0.1);
+    auto r = run_calibrated(
+        g,
+        [g, f, a](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                REP16(f->run(g, a); compiler_mb(););
+            }
+        },
+        duration_sec);
 
-    while (!ot.test_end()) {
-        REP16(f->run(g, a);compiler_mb(););
-        count++;
+    double ret = (r.sec_per_unit() / 16) * 1e9;
+    if (error_ns) {
+        *error_ns = (r.sec_error_per_unit(g) / 16) * 1e9;
     }
 
-    double dsec = ot.actual_interval_sec(g);
-    double ret = (dsec / (count*16)) * 1e9;
-
     f->free_arg(a);
 
     return ret;
 }
 
 #ifdef HAVE_HW_PERF_COUNTER
-template <typename F> double run_test_g_cycle(const GlobalState *g, F *f) {
+template <typename F>
+double run_test_g_cycle(const GlobalState *g, F *f, double duration_sec = 0.1,
+                        double *error_cycle = nullptr) {
     auto a = f->alloc_arg();
 
     f->run(g, a);
 
-    oneshot_timer ot(2);
-    uint64_t count = 0;
-    ot.start(g, 0.1);
-    auto c0 = g->get_hw_cpucycle();
+    auto body = [g, f, a](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            REP16(f->run(g, a); compiler_mb(););
+        }
+    };
 
-    while (!ot.test_end()) {
-        REP16(f->run(g, a);compiler_mb(););
-        count++;
-    }
+    uint64_t n = calibrate_count(g, body, duration_sec);
 
+    auto c0 = g->get_hw_cpucycle();
+    auto r = run_batches(g, body, n, duration_sec);
     auto c1 = g->get_hw_cpucycle();
-    double dcycle = c1-c0;
-    double ret = (dcycle / (count*16));
+
+    /* one perf read and the timer reads at the batch boundaries are inside
+     * the window */
+    double dcycle = c1 - c0;
+    auto &tc = g->get_timer_calibration();
+    dcycle -= tc.perf_read_overhead_cycles +
+              (1 + 2 * r.nbatch) * tc.userland_timer_overhead_cycles;
+    dcycle = std::max(0.0, dcycle);
+
+    double ret = (dcycle / (r.count*16));
+    if (error_cycle && r.sec > 0) {
+        double cycle_per_sec = dcycle / r.sec;
+        *error_cycle = (r.sec_error_per_unit(g) / 16) * cycle_per_sec;
+    }
 
     f->free_arg(a);
 
@@ -76,24 +230,29 @@ template <typename F> double run_test_g_cycle(const GlobalState *g, F *f) {
 }
 #endif
 
-template <typename F> double run_test_unroll32(const GlobalState *g, F *f) {
+template <typename F>
+double run_test_unroll32(const GlobalState *g, F *f,
+                         double duration_sec = 0.1,
+                         double *error_ns = nullptr) {
     auto a = f->alloc_arg();
 
     f->run(a);
 
-    oneshot_timer ot(2);
-    uint64_t count = 0;
-    ot.start(g, 0.1);
+    auto r = run_calibrated(
+        g,
+        [f, a](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                REP16(f->run(a););
+                REP16(f->run(a););
+            }
+        },
+        duration_sec);
 
-    while (!ot.test_end()) {
-        REP16(f->run(a););
-        REP16(f->run(a););
-        count++;
+    double ret = (r.sec_per_unit() / 32) * 1e9;
+    if (error_ns) {
+        *error_ns = (r.sec_error_per_unit(g) / 32) * 1e9;
     }
 
-    double dsec = ot.actual_interval_sec(g);
-    double ret = (dsec / (count*32)) * 1e9;
-
     f->free_arg(a);
 
     return ret;
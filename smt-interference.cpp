@@ -0,0 +1,282 @@
+/* SMT sibling interference.
+ *
+ * The victim kernel runs on logical processor 0, the aggressor kernel
+ * loops on its SMT sibling. The first column is the victim alone, the
+ * others are the victim's time with the aggressor, relative to alone.
+ *
+ * chase   : dependent loads over a random cycle of chase_size bytes, as
+ *           random-access-seq
+ * fma     : 8 independent FMA chains (fma64x4_block with AVX2/FMA, scalar
+ *           multiply-add otherwise)
+ * branch  : branches on random bits, half of them mispredicted
+ * stream  : sums a stream_size buffer, one load per cache line
+ * syscall : close(-1)
+ *
+ * Not available without an SMT sibling of processor 0.
+ */
+
+#include "barrier.h"
+#include "cpu-feature.h"
+#include "cpuset.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "thread.h"
+
+#ifdef X86
+#include "x86funcs.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+/* data of one thread */
+struct KernelState {
+    std::vector<uint32_t> chase; /* next index */
+    uint32_t chase_pos = 0;
+    std::vector<uint8_t> bits;
+    std::vector<uint64_t> stream;
+    size_t stream_pos = 0;
+
+    KernelState(size_t chase_size, size_t stream_size) {
+        std::mt19937 rand(1);
+
+        /* Sattolo, one cycle over all the elements */
+        size_t n = std::max<size_t>(2, chase_size / sizeof(uint32_t));
+        chase.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            chase[i] = i;
+        }
+        for (size_t i = n - 1; i > 0; i--) {
+            std::swap(chase[i], chase[rand() % i]);
+        }
+
+        bits.resize(1 << 16);
+        for (auto &b : bits) {
+            b = rand() & 1;
+        }
+
+        stream.assign(std::max<size_t>(8, stream_size / sizeof(uint64_t)), 1);
+    }
+};
+
+/* n units of work, returns something to keep */
+typedef uint64_t (*kernel_t)(KernelState *s, uint64_t n);
+
+uint64_t kernel_chase(KernelState *s, uint64_t n) {
+    uint32_t p = s->chase_pos;
+    for (uint64_t i = 0; i < n; i++) {
+        p = s->chase[p];
+    }
+    s->chase_pos = p;
+    return p;
+}
+
+#ifdef X86
+uint64_t kernel_fma64x4(KernelState *s, uint64_t n) {
+    return fma64x4_block(0, n);
+}
+#endif
+
+uint64_t kernel_fma(KernelState *s, uint64_t n) {
+    double a0 = 1, a1 = 1, a2 = 1, a3 = 1, a4 = 1, a5 = 1, a6 = 1, a7 = 1;
+    for (uint64_t i = 0; i < n; i++) {
+        a0 = a0 * 0.5 + 0.5;
+        a1 = a1 * 0.5 + 0.5;
+        a2 = a2 * 0.5 + 0.5;
+        a3 = a3 * 0.5 + 0.5;
+        a4 = a4 * 0.5 + 0.5;
+        a5 = a5 * 0.5 + 0.5;
+        a6 = a6 * 0.5 + 0.5;
+        a7 = a7 * 0.5 + 0.5;
+    }
+    return (uint64_t)(a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7);
+}
+
+uint64_t kernel_branch(KernelState *s, uint64_t n) {
+    uint64_t sum = 0;
+    size_t mask = s->bits.size() - 1;
+    for (uint64_t i = 0; i < n; i++) {
+        /* the asm keeps it a branch, not a cmov */
+        if (s->bits[i & mask]) {
+            __asm__ __volatile__("" : "+r"(sum));
+            sum += 3;
+        } else {
+            __asm__ __volatile__("" : "+r"(sum));
+            sum ^= i;
+        }
+    }
+    return sum;
+}
+
+uint64_t kernel_stream(KernelState *s, uint64_t n) {
+    uint64_t sum = 0;
+    size_t pos = s->stream_pos;
+    size_t size = s->stream.size();
+    for (uint64_t i = 0; i < n; i++) {
+        sum += s->stream[pos];
+        pos += CACHELINE_SIZE / sizeof(uint64_t);
+        if (pos >= size) {
+            pos = 0;
+        }
+    }
+    s->stream_pos = pos;
+    return sum;
+}
+
+#ifdef HAVE_CLOSE
+uint64_t kernel_syscall(KernelState *s, uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        touch_memory();
+    }
+    return 0;
+}
+#endif
+
+struct Kernel {
+    const char *name;
+    kernel_t func;
+};
+
+/* cpuid is slow under a hypervisor, so have_fma() is not called in the
+ * kernel */
+std::vector<Kernel> kernels() {
+    kernel_t fma = kernel_fma;
+#ifdef X86
+    if (have_fma()) {
+        fma = kernel_fma64x4;
+    }
+#endif
+
+    return {
+        {"chase", kernel_chase},   {"fma", fma},
+        {"branch", kernel_branch}, {"stream", kernel_stream},
+#ifdef HAVE_CLOSE
+        {"syscall", kernel_syscall},
+#endif
+    };
+}
+
+struct Aggressor {
+    thread_handle_t thread;
+    GlobalState const *g;
+    int proc;
+    kernel_t func;
+    KernelState *state;
+    std::atomic<bool> stop;
+    atomic_int_t start_barrier;
+    uint64_t result;
+};
+
+void *aggressor_main(void *p) {
+    Aggressor *a = (Aggressor *)p;
+    auto pi = a->g->proc_table->logical_index_to_processor(
+        a->proc, PROC_ORDER_OUTER_TO_INNER);
+    bind_self_to_1proc(a->g->proc_table, pi, true);
+    wait_barrier(&a->start_barrier, 2);
+
+    uint64_t r = 0;
+    while (!a->stop.load(std::memory_order_relaxed)) {
+        r += a->func(a->state, 1024);
+    }
+    a->result = r;
+    return nullptr;
+}
+
+int sibling_processor(GlobalState const *g) {
+    return g->proc_table->find_related_processor(0, PROC_ORDER_OUTER_TO_INNER,
+                                                 PROC_REL_SMT_SIBLING);
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct SMTInterference : public parent_t {
+    SMTInterference() : parent_t("smt-interference", LOWER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_MEMORY, TAG_THREADING};
+        add_param("chase_size", 4 * 1024 * 1024, "chase range [bytes]");
+        add_param("stream_size", 64 * 1024 * 1024, "stream buffer [bytes]");
+        add_param("duration", 0.1, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        size_t chase_size = (size_t)param("chase_size");
+        size_t stream_size = (size_t)param("stream_size");
+        double duration = param("duration");
+        auto ks = kernels();
+        int nk = ks.size();
+
+        KernelState victim_state(chase_size, stream_size);
+        KernelState aggressor_state(chase_size, stream_size);
+
+        auto t = new table_t("victim", "aggressor", nk, nk + 1);
+        t->column_label[0] = "alone[ns/unit]";
+        for (int a = 0; a < nk; a++) {
+            t->column_label[a + 1] = std::string(ks[a].name) + "[x]";
+        }
+
+        auto pi = g->proc_table->logical_index_to_processor(
+            0, PROC_ORDER_OUTER_TO_INNER);
+        bind_self_to_1proc(g->proc_table, pi, true);
+
+        auto measure = [&](kernel_t func) {
+            return run_calibrated(
+                       g,
+                       [g, func, &victim_state](uint64_t n) {
+                           g->dummy_write(0, func(&victim_state, n));
+                       },
+                       duration)
+                .sec_per_unit();
+        };
+
+        std::vector<double> alone(nk);
+        for (int v = 0; v < nk; v++) {
+            t->row_label[v] = ks[v].name;
+            alone[v] = measure(ks[v].func);
+            (*t)[v][0] = alone[v] * 1e9;
+        }
+
+        for (int a = 0; a < nk; a++) {
+            Aggressor ag;
+            ag.g = g;
+            ag.proc = sibling_processor(g);
+            ag.func = ks[a].func;
+            ag.state = &aggressor_state;
+            ag.stop = false;
+            ag.start_barrier = 0;
+            ag.thread = spawn_thread(aggressor_main, &ag);
+            wait_barrier(&ag.start_barrier, 2);
+
+            for (int v = 0; v < nk; v++) {
+                (*t)[v][a + 1] = measure(ks[v].func) / alone[v];
+            }
+
+            ag.stop = true;
+            wait_thread(ag.thread);
+            g->dummy_write(0, ag.result);
+        }
+
+        bind_self_to_first(g->proc_table, true);
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override {
+        return sibling_processor(g) >= 0;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_smt_interference_desc() {
+    return std::unique_ptr<BenchDesc>(new SMTInterference());
+}
+
+} // namespace smbm
@@ -0,0 +1,771 @@
+/* Sorting and searching.
+ *
+ * sort-algo     : std::sort, LSD radix sort (8bit digits), a SIMD sorting
+ *                 network + bitonic merge sort (keys only), and an OpenMP
+ *                 parallel sort (std::sort per thread, then pairwise
+ *                 std::merge). 32/64bit keys and key-value pairs, over
+ *                 random, sorted, reverse, few-unique and Zipf inputs.
+ *                 [nsec/key]
+ *
+ * search-layout : lower bound in sorted keys with std::lower_bound, an
+ *                 Eytzinger layout, a B-tree (S-tree) layout with 64 byte
+ *                 nodes, and a SIMD linear scan of the whole array. Queries
+ *                 are uniform or Zipf over the keys. Lookups are
+ *                 independent, so this is throughput. [nsec/lookup]
+ *
+ * Columns are the number of keys, from 1Ki to max_keys in x16 steps.
+ */
+
+#include "memalloc.h"
+#include "simple-run.h"
+#include "stats.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "zipf.h"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace smbm {
+
+namespace {
+
+struct KV32 {
+    uint32_t key, value;
+};
+struct KV64 {
+    uint64_t key, value;
+};
+
+inline uint32_t key_of(uint32_t v) { return v; }
+inline uint64_t key_of(uint64_t v) { return v; }
+inline uint32_t key_of(KV32 const &v) { return v.key; }
+inline uint64_t key_of(KV64 const &v) { return v.key; }
+
+inline void set_elem(uint32_t *e, uint64_t key, uint64_t i) { *e = key; }
+inline void set_elem(uint64_t *e, uint64_t key, uint64_t i) { *e = key; }
+inline void set_elem(KV32 *e, uint64_t key, uint64_t i) {
+    e->key = key;
+    e->value = i;
+}
+inline void set_elem(KV64 *e, uint64_t key, uint64_t i) {
+    e->key = key;
+    e->value = i;
+}
+
+struct KeyLess {
+    template <typename T> bool operator()(T const &a, T const &b) const {
+        return key_of(a) < key_of(b);
+    }
+};
+
+std::vector<size_t> key_counts(double max_keys) {
+    std::vector<size_t> ret;
+    size_t max = (size_t)(max_keys * 1024 * 1024);
+    for (size_t n = 1024; n <= max; n *= 16) {
+        ret.push_back(n);
+    }
+    return ret;
+}
+
+std::string key_count_label(size_t n) {
+    char buf[64];
+    if (n >= 1024 * 1024) {
+        sprintf(buf, "%dMi", (int)(n / (1024 * 1024)));
+    } else {
+        sprintf(buf, "%dKi", (int)(n / 1024));
+    }
+    return buf;
+}
+
+/*
+ * sort
+ */
+
+enum Dist { D_RANDOM, D_SORTED, D_REVERSE, D_FEW_UNIQUE, D_ZIPF, D_NUM };
+const char *dist_name[] = {"random", "sorted", "reverse", "few-unique",
+                           "zipf"};
+
+enum SortType { ST_U32, ST_U64, ST_KV32, ST_KV64, ST_NUM };
+const char *sort_type_name[] = {"u32", "u64", "kv32", "kv64"};
+
+enum SortAlgo { SA_STD, SA_RADIX, SA_SIMD, SA_PARALLEL, SA_NUM };
+const char *sort_algo_name[] = {"std::sort", "radix", "simd-merge",
+                                "omp-parallel"};
+
+template <typename T> void gen_input(std::vector<T> &v, Dist d) {
+    std::mt19937_64 rand(1);
+    size_t n = v.size();
+    ZipfGenerator zipf(n);
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k;
+        if (d == D_FEW_UNIQUE) {
+            k = (rand() % 16) * 0x0123456789abcdefULL;
+        } else if (d == D_ZIPF) {
+            k = zipf(rand) * 0x9e3779b97f4a7c15ULL;
+        } else {
+            k = rand();
+        }
+        set_elem(&v[i], k, i);
+    }
+
+    if (d == D_SORTED || d == D_REVERSE) {
+        std::sort(v.begin(), v.end(), KeyLess());
+    }
+    if (d == D_REVERSE) {
+        std::reverse(v.begin(), v.end());
+    }
+}
+
+template <typename T> void radix_sort(T *data, T *tmp, size_t n) {
+    typedef decltype(key_of(T())) K;
+    constexpr int npass = sizeof(K);
+    size_t count[npass][256] = {};
+
+    for (size_t i = 0; i < n; i++) {
+        K k = key_of(data[i]);
+        for (int p = 0; p < npass; p++) {
+            count[p][(k >> (p * 8)) & 0xff]++;
+        }
+    }
+
+    T *src = data, *dst = tmp;
+    for (int p = 0; p < npass; p++) {
+        int shift = p * 8;
+
+        /* every key has the same digit */
+        if (count[p][(key_of(src[0]) >> shift) & 0xff] == n) {
+            continue;
+        }
+
+        size_t off = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = count[p][b];
+            count[p][b] = off;
+            off += c;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            int d = (key_of(src[i]) >> shift) & 0xff;
+            dst[count[p][d]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != data) {
+        std::copy(src, src + n, data);
+    }
+}
+
+/* 4 lane vectors. the vector width follows the build target, 4x32bit is
+ * one SSE/NEON register, 4x64bit is one AVX2 register or two of 128bit.
+ * vectors are only passed by reference, a 32 byte vector argument would
+ * depend on -mavx for its ABI */
+template <typename K> struct Vec4 {
+    typedef K type __attribute__((vector_size(4 * sizeof(K))));
+};
+
+template <typename V, typename K> inline void vec_load(V &v, K const *p) {
+    memcpy(&v, p, sizeof(v));
+}
+
+template <typename V, typename K> inline void vec_store(K *p, V const &v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+template <typename V> inline void vec_minmax(V &a, V &b) {
+    V m = (V)(a < b);
+    V lo = (a & m) | (b & ~m);
+    b = (a & ~m) | (b & m);
+    a = lo;
+}
+
+/* a, b sorted -> a gets the lower 4, b the upper 4, both sorted */
+template <typename V> inline void bitonic_merge4(V &a, V &b) {
+    b = (V){b[3], b[2], b[1], b[0]};
+    vec_minmax(a, b);
+
+    V l = (V){a[0], a[1], b[0], b[1]};
+    V h = (V){a[2], a[3], b[2], b[3]};
+    vec_minmax(l, h);
+
+    V l1 = (V){l[0], h[0], l[2], h[2]};
+    V h1 = (V){l[1], h[1], l[3], h[3]};
+    vec_minmax(l1, h1);
+
+    a = (V){l1[0], h1[0], l1[1], h1[1]};
+    b = (V){l1[2], h1[2], l1[3], h1[3]};
+}
+
+/* sorting network over 4 vectors, then transpose: 4 sorted runs of 4 */
+template <typename V, typename K> inline void sort16(K *p) {
+    V r0, r1, r2, r3;
+    vec_load(r0, p + 0);
+    vec_load(r1, p + 4);
+    vec_load(r2, p + 8);
+    vec_load(r3, p + 12);
+
+    vec_minmax(r0, r1);
+    vec_minmax(r2, r3);
+    vec_minmax(r0, r2);
+    vec_minmax(r1, r3);
+    vec_minmax(r1, r2);
+
+    V c0 = {r0[0], r1[0], r2[0], r3[0]};
+    V c1 = {r0[1], r1[1], r2[1], r3[1]};
+    V c2 = {r0[2], r1[2], r2[2], r3[2]};
+    V c3 = {r0[3], r1[3], r2[3], r3[3]};
+    vec_store(p + 0, c0);
+    vec_store(p + 4, c1);
+    vec_store(p + 8, c2);
+    vec_store(p + 12, c3);
+}
+
+/* na, nb are multiples of 4. the 4 largest so far are kept in hi, the next
+ * 4 come from the run with the smaller head */
+template <typename V, typename K>
+void merge_runs(K const *a, size_t na, K const *b, size_t nb, K *out) {
+    V lo, hi;
+    vec_load(lo, a);
+    vec_load(hi, b);
+    size_t i = 4, j = 4;
+
+    while (1) {
+        bitonic_merge4(lo, hi);
+        vec_store(out, lo);
+        out += 4;
+
+        if (i < na && (j >= nb || a[i] < b[j])) {
+            vec_load(lo, a + i);
+            i += 4;
+        } else if (j < nb) {
+            vec_load(lo, b + j);
+            j += 4;
+        } else {
+            break;
+        }
+    }
+
+    vec_store(out, hi);
+}
+
+/* n is a multiple of 16 */
+template <typename K> void simd_merge_sort(K *data, K *tmp, size_t n) {
+    typedef typename Vec4<K>::type V;
+
+    for (size_t i = 0; i < n; i += 16) {
+        sort16<V>(data + i);
+    }
+
+    K *src = data, *dst = tmp;
+    for (size_t run = 4; run < n; run *= 2) {
+        for (size_t i = 0; i < n; i += run * 2) {
+            if (i + run < n) {
+                size_t nb = std::min(run, n - i - run);
+                merge_runs<V>(src + i, run, src + i + run, nb, dst + i);
+            } else {
+                std::copy(src + i, src + n, dst + i);
+            }
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != data) {
+        std::copy(src, src + n, data);
+    }
+}
+
+#ifdef _OPENMP
+/* the merge tree halves the number of busy threads at each level */
+template <typename T> void parallel_sort(T *data, T *tmp, size_t n) {
+    int nt = omp_get_max_threads();
+    std::vector<size_t> lo(nt + 1);
+    for (int c = 0; c <= nt; c++) {
+        lo[c] = n * c / nt;
+    }
+
+#pragma omp parallel for
+    for (int c = 0; c < nt; c++) {
+        std::sort(data + lo[c], data + lo[c + 1], KeyLess());
+    }
+
+    T *src = data, *dst = tmp;
+    for (int w = 1; w < nt; w *= 2) {
+#pragma omp parallel for
+        for (int c = 0; c < nt; c += w * 2) {
+            size_t b = lo[c];
+            size_t m = lo[std::min(c + w, nt)];
+            size_t e = lo[std::min(c + w * 2, nt)];
+            std::merge(src + b, src + m, src + m, src + e, dst + b,
+                       KeyLess());
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != data) {
+        std::copy(src, src + n, data);
+    }
+}
+#endif
+
+template <typename T> bool sort_available(SortAlgo a) {
+    switch (a) {
+    case SA_SIMD:
+        return std::is_integral<T>::value;
+    case SA_PARALLEL:
+#ifdef _OPENMP
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return true;
+    }
+}
+
+template <typename T> void run_sort(SortAlgo a, T *data, T *tmp, size_t n) {
+    switch (a) {
+    case SA_STD:
+        std::sort(data, data + n, KeyLess());
+        break;
+    case SA_RADIX:
+        radix_sort(data, tmp, n);
+        break;
+    case SA_SIMD:
+        if constexpr (std::is_integral<T>::value) {
+            simd_merge_sort(data, tmp, n);
+        }
+        break;
+    case SA_PARALLEL:
+#ifdef _OPENMP
+        parallel_sort(data, tmp, n);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+struct SortRow {
+    SortType type;
+    Dist dist;
+    SortAlgo algo;
+};
+
+/* median nsec/key, at least one sort. the input is copied back before
+ * each sort, outside of the timed region */
+template <typename T>
+double time_sort(GlobalState const *g, SortAlgo a, std::vector<T> const &orig,
+                 std::vector<T> &work, std::vector<T> &tmp, double duration) {
+    size_t n = orig.size();
+    std::vector<double> t;
+    double total = 0;
+
+    do {
+        std::copy(orig.begin(), orig.end(), work.begin());
+
+        auto t0 = userland_timer_value::get();
+        run_sort(a, work.data(), tmp.data(), n);
+        auto t1 = userland_timer_value::get();
+
+        if (t.size() == 0 &&
+            !std::is_sorted(work.begin(), work.end(), KeyLess())) {
+            fprintf(stderr, "sort-algo: %s did not sort\n",
+                    sort_algo_name[a]);
+            abort();
+        }
+
+        double sec = g->userland_timer_delta_to_sec(t1 - t0);
+        t.push_back(sec * 1e9 / n);
+        total += sec;
+    } while (total < duration);
+
+    return median(t);
+}
+
+template <typename T>
+void sort_rows(GlobalState const *g, std::vector<SortRow> const &rows,
+               SortType type, size_t n, double duration,
+               std::vector<double> *out) {
+    std::vector<T> orig(n), work(n), tmp(n);
+
+    for (int d = 0; d < D_NUM; d++) {
+        bool generated = false;
+
+        for (size_t ri = 0; ri < rows.size(); ri++) {
+            auto &r = rows[ri];
+            if (r.type != type || r.dist != d) {
+                continue;
+            }
+            if (!generated) {
+                gen_input(orig, (Dist)d);
+                generated = true;
+            }
+            (*out)[ri] = time_sort(g, r.algo, orig, work, tmp, duration);
+        }
+    }
+}
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct SortAlgoBench : public parent_t {
+    SortAlgoBench() : parent_t("sort-algo", LOWER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_MEMORY};
+        add_param("max_keys", 4, "largest number of keys [Mi]");
+        add_param("duration", 0.05,
+                  "minimum measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        std::vector<SortRow> rows;
+        for (int ty = 0; ty < ST_NUM; ty++) {
+            for (int d = 0; d < D_NUM; d++) {
+                for (int a = 0; a < SA_NUM; a++) {
+                    SortAlgo algo = (SortAlgo)a;
+                    bool avail = false;
+                    switch (ty) {
+                    case ST_U32:
+                        avail = sort_available<uint32_t>(algo);
+                        break;
+                    case ST_U64:
+                        avail = sort_available<uint64_t>(algo);
+                        break;
+                    case ST_KV32:
+                        avail = sort_available<KV32>(algo);
+                        break;
+                    case ST_KV64:
+                        avail = sort_available<KV64>(algo);
+                        break;
+                    }
+                    if (avail) {
+                        rows.push_back({(SortType)ty, (Dist)d, algo});
+                    }
+                }
+            }
+        }
+
+        auto sizes = key_counts(param("max_keys"));
+        double duration = param("duration");
+
+        auto t = new table_t("algo type input [nsec/key]", "keys",
+                             rows.size(), sizes.size());
+        for (size_t ri = 0; ri < rows.size(); ri++) {
+            auto &r = rows[ri];
+            t->row_label[ri] = std::string(sort_algo_name[r.algo]) + " " +
+                               sort_type_name[r.type] + " " +
+                               dist_name[r.dist];
+        }
+
+        std::vector<double> col(rows.size());
+        for (size_t si = 0; si < sizes.size(); si++) {
+            size_t n = sizes[si];
+            t->column_label[si] = key_count_label(n);
+
+            sort_rows<uint32_t>(g, rows, ST_U32, n, duration, &col);
+            sort_rows<uint64_t>(g, rows, ST_U64, n, duration, &col);
+            sort_rows<KV32>(g, rows, ST_KV32, n, duration, &col);
+            sort_rows<KV64>(g, rows, ST_KV64, n, duration, &col);
+
+            for (size_t ri = 0; ri < rows.size(); ri++) {
+                (*t)[ri][si] = col[ri];
+            }
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+/*
+ * search
+ */
+
+enum SearchMethod { SM_BINARY, SM_EYTZINGER, SM_BTREE, SM_LINEAR, SM_NUM };
+const char *search_method_name[] = {"binary", "eytzinger", "btree",
+                                    "simd-linear"};
+
+enum QueryDist { QD_UNIFORM, QD_ZIPF, QD_NUM };
+const char *query_dist_name[] = {"uniform", "zipf"};
+
+template <typename K> struct SearchData {
+    typedef K V __attribute__((vector_size(16)));
+    typedef decltype(V() < V()) M;
+    static constexpr int lanes = 16 / sizeof(K);
+    static constexpr int node_keys = 64 / sizeof(K);
+    static constexpr K none = std::numeric_limits<K>::max();
+
+    size_t n;
+    std::vector<K> sorted;
+    K *eytz;  /* [1..n], eytz[0] is none */
+    K *btree; /* nblocks nodes of node_keys, padded with none */
+    size_t nblocks;
+
+    SearchData(size_t n) : n(n), sorted(n) {
+        std::mt19937_64 rand(1);
+        for (size_t i = 0; i < n; i++) {
+            sorted[i] = rand() % none;
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        eytz = (K *)aligned_calloc(64, (n + 1) * sizeof(K));
+        eytz[0] = none;
+        size_t t = 0;
+        build_eytz(1, t);
+
+        nblocks = (n + node_keys - 1) / node_keys;
+        btree = (K *)aligned_calloc(64, nblocks * 64);
+        t = 0;
+        build_btree(0, t);
+    }
+
+    ~SearchData() {
+        aligned_free(eytz);
+        aligned_free(btree);
+    }
+
+    void build_eytz(size_t k, size_t &t) {
+        if (k <= n) {
+            build_eytz(2 * k, t);
+            eytz[k] = sorted[t++];
+            build_eytz(2 * k + 1, t);
+        }
+    }
+
+    static size_t child(size_t k, int i) { return k * (node_keys + 1) + i + 1; }
+
+    void build_btree(size_t k, size_t &t) {
+        if (k < nblocks) {
+            for (int i = 0; i < node_keys; i++) {
+                build_btree(child(k, i), t);
+                btree[k * node_keys + i] = (t < n) ? sorted[t++] : none;
+            }
+            build_btree(child(k, node_keys), t);
+        }
+    }
+
+    static V load(K const *p) {
+        V v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /* number of keys < x in a 64 byte node */
+    static int node_rank(K const *node, K x) {
+        V xv = (V){} + x;
+        M c = (load(node) < xv) + (load(node + lanes) < xv) +
+              (load(node + lanes * 2) < xv) + (load(node + lanes * 3) < xv);
+        int r = 0;
+        for (int l = 0; l < lanes; l++) {
+            r -= c[l];
+        }
+        return r;
+    }
+
+    K binary(K x) const {
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), x);
+        return (it == sorted.end()) ? none : *it;
+    }
+
+    /* branchless descent, prefetching the node 4 levels (one line) down */
+    K eytzinger(K x) const {
+        size_t k = 1;
+        while (k <= n) {
+            __builtin_prefetch(eytz + k * node_keys);
+            k = 2 * k + (eytz[k] < x);
+        }
+        k >>= __builtin_ffsll(~k);
+        return eytz[k];
+    }
+
+    K bt(K x) const {
+        size_t k = 0;
+        K ret = none;
+        while (k < nblocks) {
+            int i = node_rank(btree + k * node_keys, x);
+            if (i < node_keys) {
+                ret = btree[k * node_keys + i];
+            }
+            k = child(k, i);
+        }
+        return ret;
+    }
+
+    /* counts the keys < x over the whole array, no early exit */
+    K linear(K x) const {
+        K const *a = sorted.data();
+        V xv = (V){} + x;
+        M c0 = {}, c1 = {}, c2 = {}, c3 = {};
+        size_t i = 0;
+
+        for (; i + lanes * 4 <= n; i += lanes * 4) {
+            c0 += load(a + i) < xv;
+            c1 += load(a + i + lanes) < xv;
+            c2 += load(a + i + lanes * 2) < xv;
+            c3 += load(a + i + lanes * 3) < xv;
+        }
+
+        size_t r = 0;
+        for (; i < n; i++) {
+            r += a[i] < x;
+        }
+        M c = (c0 + c1) + (c2 + c3);
+        for (int l = 0; l < lanes; l++) {
+            r -= c[l];
+        }
+
+        return (r < n) ? a[r] : none;
+    }
+
+    template <SearchMethod method> K search(K x) const {
+        switch (method) {
+        case SM_BINARY:
+            return binary(x);
+        case SM_EYTZINGER:
+            return eytzinger(x);
+        case SM_BTREE:
+            return bt(x);
+        default:
+            return linear(x);
+        }
+    }
+};
+
+template <typename K, SearchMethod method>
+double time_search(GlobalState const *g, SearchData<K> const &d,
+                   std::vector<K> const &q, double duration) {
+    size_t mask = q.size() - 1;
+
+    auto cr = run_calibrated(
+        g,
+        [g, &d, &q, mask](uint64_t count) {
+            K sum = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                sum += d.template search<method>(q[i & mask]);
+            }
+            g->dummy_write(0, sum);
+        },
+        duration);
+
+    return cr.sec_per_unit() * 1e9;
+}
+
+template <typename K>
+double time_search(GlobalState const *g, SearchMethod m,
+                   SearchData<K> const &d, std::vector<K> const &q,
+                   double duration) {
+    switch (m) {
+    case SM_BINARY:
+        return time_search<K, SM_BINARY>(g, d, q, duration);
+    case SM_EYTZINGER:
+        return time_search<K, SM_EYTZINGER>(g, d, q, duration);
+    case SM_BTREE:
+        return time_search<K, SM_BTREE>(g, d, q, duration);
+    default:
+        return time_search<K, SM_LINEAR>(g, d, q, duration);
+    }
+}
+
+/* fills the rows for one key size, in the order method x query dist */
+template <typename K>
+void search_rows(GlobalState const *g, size_t n, double duration,
+                 double *out) {
+    SearchData<K> d(n);
+    std::mt19937_64 rand(2);
+    ZipfGenerator zipf(n);
+    std::vector<K> q[QD_NUM];
+
+    /* more distinct queries than cache lines in the LLC */
+    size_t nq = 1 << 20;
+    for (size_t i = 0; i < nq; i++) {
+        q[QD_UNIFORM].push_back(rand() % SearchData<K>::none);
+        q[QD_ZIPF].push_back(d.sorted[scatter_rank(zipf(rand), n)]);
+    }
+
+    /* all layouts have to agree on the result */
+    for (int i = 0; i < 16; i++) {
+        K x = q[QD_UNIFORM][i], r = d.binary(x);
+        if (d.eytzinger(x) != r || d.bt(x) != r || d.linear(x) != r) {
+            fprintf(stderr, "search-layout: layouts disagree\n");
+            abort();
+        }
+    }
+
+    for (int m = 0; m < SM_NUM; m++) {
+        for (int qd = 0; qd < QD_NUM; qd++) {
+            *out++ = time_search(g, (SearchMethod)m, d, q[qd], duration);
+        }
+    }
+}
+
+struct SearchLayoutBench : public parent_t {
+    SearchLayoutBench() : parent_t("search-layout", LOWER_IS_BETTER) {
+        tags = {TAG_CPU, TAG_MEMORY};
+        add_param("max_keys", 16, "largest number of keys [Mi]");
+        add_param("duration", 0.05, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        const char *key_name[] = {"32", "64"};
+        int nrow_per_key = SM_NUM * QD_NUM;
+
+        auto sizes = key_counts(param("max_keys"));
+        double duration = param("duration");
+
+        auto t = new table_t("method key query [nsec/lookup]", "keys",
+                             nrow_per_key * 2, sizes.size());
+        for (int k = 0; k < 2; k++) {
+            int row = k * nrow_per_key;
+            for (int m = 0; m < SM_NUM; m++) {
+                for (int qd = 0; qd < QD_NUM; qd++) {
+                    t->row_label[row++] = std::string(search_method_name[m]) +
+                                          " " + key_name[k] + " " +
+                                          query_dist_name[qd];
+                }
+            }
+        }
+
+        std::vector<double> col(nrow_per_key * 2);
+        for (size_t si = 0; si < sizes.size(); si++) {
+            t->column_label[si] = key_count_label(sizes[si]);
+
+            search_rows<int32_t>(g, sizes[si], duration, &col[0]);
+            search_rows<int64_t>(g, sizes[si], duration,
+                                 &col[nrow_per_key]);
+
+            for (size_t ri = 0; ri < col.size(); ri++) {
+                (*t)[ri][si] = col[ri];
+            }
+        }
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_sort_algo_desc() {
+    return std::unique_ptr<BenchDesc>(new SortAlgoBench());
+}
+
+std::unique_ptr<BenchDesc> get_search_layout_desc() {
+    return std::unique_ptr<BenchDesc>(new SearchLayoutBench());
+}
+
+} // namespace smbm
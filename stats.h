@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+namespace smbm {
+
+inline double median(std::vector<double> v) {
+    if (v.size() == 0) {
+        return 0;
+    }
+
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+
+    if (n & 1) {
+        return v[n / 2];
+    }
+
+    return (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+/* up to this many samples in total, the p-value without ties comes from
+ * the exact distribution of U. the counts stay exact in a double */
+constexpr size_t MANN_WHITNEY_EXACT_MAX = 40;
+
+/* number of orders of n0 + n1 samples with U = u, for u in 0..n0*n1.
+ * the coefficients of the Gaussian binomial [n0 + n1, n0] */
+inline std::vector<double> mann_whitney_u_counts(size_t n0, size_t n1) {
+    std::vector<double> c(n0 * n1 + n0 + 1, 0);
+    c[0] = 1;
+    for (size_t i = 1; i <= n0; i++) {
+        /* times (1 - q^(n1 + i)) / (1 - q^i) */
+        for (size_t k = c.size() - 1; k >= n1 + i; k--) {
+            c[k] -= c[k - n1 - i];
+        }
+        for (size_t k = i; k < c.size(); k++) {
+            c[k] += c[k - i];
+        }
+    }
+    c.resize(n0 * n1 + 1);
+    return c;
+}
+
+/* two-sided p-value of U = u from the exact distribution, no ties */
+inline double mann_whitney_u_exact_p(size_t n0, size_t n1, size_t u) {
+    auto c = mann_whitney_u_counts(n0, n1);
+    /* the distribution is symmetric around n0 * n1 / 2 */
+    u = std::min(u, n0 * n1 - u);
+
+    double total = 0, tail = 0;
+    for (size_t k = 0; k < c.size(); k++) {
+        total += c[k];
+        if (k <= u) {
+            tail += c[k];
+        }
+    }
+    return std::min(1.0, 2 * tail / total);
+}
+
+/* the smallest two-sided p-value samples of n0 and n1 can give, when all
+ * of one side are below all of the other. with n0 = n1 = 3 it is 0.1, so
+ * no alpha below that can be reached */
+inline double mann_whitney_u_min_p(size_t n0, size_t n1) {
+    if (n0 == 0 || n1 == 0) {
+        return 1.0;
+    }
+    if (n0 + n1 <= MANN_WHITNEY_EXACT_MAX) {
+        return mann_whitney_u_exact_p(n0, n1, 0);
+    }
+    /* C(n0 + n1, n0) is large enough that the exact value is below any
+     * usable alpha */
+    return 0;
+}
+
+/* two-sided p-value of Mann-Whitney U test.
+ * exact for small samples without ties, otherwise normal approximation
+ * with tie and continuity correction. */
+inline double mann_whitney_u_p(std::vector<double> const &a,
+                               std::vector<double> const &b) {
+    size_t n0 = a.size();
+    size_t n1 = b.size();
+
+    if (n0 == 0 || n1 == 0) {
+        return 1.0;
+    }
+
+    struct Elem {
+        double v;
+        int group;
+    };
+
+    std::vector<Elem> all;
+    for (auto x : a) {
+        all.push_back({x, 0});
+    }
+    for (auto x : b) {
+        all.push_back({x, 1});
+    }
+
+    std::sort(all.begin(), all.end(),
+              [](Elem const &l, Elem const &r) { return l.v < r.v; });
+
+    size_t n = all.size();
+    double rank_sum0 = 0;
+    double tie_sum = 0;
+
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && all[j].v == all[i].v) {
+            j++;
+        }
+
+        /* ranks are 1 origin, ties get the average */
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++) {
+            if (all[k].group == 0) {
+                rank_sum0 += rank;
+            }
+        }
+
+        double t = j - i;
+        tie_sum += t * t * t - t;
+
+        i = j;
+    }
+
+    double u0 = rank_sum0 - (n0 * (n0 + 1)) / 2.0;
+
+    if (tie_sum == 0 && n <= MANN_WHITNEY_EXACT_MAX) {
+        return mann_whitney_u_exact_p(n0, n1, (size_t)u0);
+    }
+
+    double mean = (n0 * n1) / 2.0;
+    double var = (n0 * n1 / 12.0) * ((n + 1) - tie_sum / (n * (n - 1.0)));
+
+    if (var <= 0) {
+        return 1.0;
+    }
+
+    double d = fabs(u0 - mean) - 0.5;
+    if (d < 0) {
+        d = 0;
+    }
+
+    double z = d / sqrt(var);
+
+    return erfc(z / sqrt(2.0));
+}
+
+} // namespace smbm
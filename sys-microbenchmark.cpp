@@ -24,8 +24,16 @@
 
 #include "barrier.h"
 #include "cpuset.h"
+#include "json.h"
 #include "memalloc.h"
 
+#include <thread>
+
+#ifdef POSIX
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#endif
+
 namespace smbm {
 #ifdef __linux__
 static int perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu,
@@ -123,7 +131,7 @@ static double ooo_check() {
     return ratio;
 }
 
-static inline void ostimer_delay_loop(GlobalState *g, double sec) {
+static inline void ostimer_delay_loop(GlobalState const *g, double sec) {
     uint64_t target_delta = g->sec_to_ostimer_delta(sec);
 
     auto t0 = ostimer_value::get();
@@ -148,7 +156,10 @@ GlobalState::GlobalState() : proc_table(new ProcessorTable()) {
     this->zero_memory = (uint64_t *)p;
     *this->zero_memory = 0;
 
-    int ncpu = proc_table->get_active_cpu_count();
+    /* topology is not loaded yet, hardware_concurrency() is an upper bound
+     * of the active cpu count */
+    int ncpu = std::max(1, (int)std::thread::hardware_concurrency());
+    this->dustbox_count = ncpu;
     this->dustbox = new uint64_t *[ncpu];
 
     for (int i = 0; i < ncpu; i++) {
@@ -156,11 +167,6 @@ GlobalState::GlobalState() : proc_table(new ProcessorTable()) {
         this->dustbox[i] = (uint64_t *)p;
     }
 
-    bind_self_to_1proc(this->proc_table,
-                       this->proc_table->logical_index_to_processor(
-                           0, PROC_ORDER_OUTER_TO_INNER),
-                       true);
-
 #ifdef WINDOWS
     {
         LARGE_INTEGER freq;
@@ -169,8 +175,31 @@ GlobalState::GlobalState() : proc_table(new ProcessorTable()) {
     }
 #endif
 
+    this->state_file = default_state_file();
+}
+
+const std::vector<std::shared_ptr<BenchDesc>> *
+GlobalState::get_active_benchmark_list() const {
+    std::call_once(this->active_list_once, [this]() {
+        for (auto &&x : get_all_benchmark_list()) {
+            if (x && x->available(this)) {
+                this->bench_list.push_back(x);
+            }
+        }
+    });
+
+    return &this->bench_list;
+}
+
 #ifdef HAVE_USERLAND_CPUCOUNTER
-    {
+double GlobalState::get_userland_cpucounter_freq() const {
+    std::call_once(this->freq_once, [this]() {
+        picojson::value v;
+        if (load_state("userland_cpucounter_freq", &v)) {
+            this->userland_cpucounter_freq = v.get<double>();
+            return;
+        }
+
         double measure_delay_sec = 0.05;
         double delay_to_sec = 1 / measure_delay_sec;
 
@@ -188,54 +217,262 @@ GlobalState::GlobalState() : proc_table(new ProcessorTable()) {
         uint64_t freq = min * delay_to_sec;
 
         this->userland_cpucounter_freq = freq;
-    }
+        store_state("userland_cpucounter_freq", picojson::value((double)freq));
+    });
+
+    return this->userland_cpucounter_freq;
+}
 #endif
 
-    this->ooo_ratio = ooo_check();
+double GlobalState::get_ooo_ratio() const {
+    std::call_once(this->ooo_once, [this]() {
+        picojson::value v;
+        if (load_state("ooo_ratio", &v)) {
+            this->ooo_ratio = v.get<double>();
+            return;
+        }
+
+        this->ooo_ratio = ooo_check();
+        store_state("ooo_ratio", picojson::value(this->ooo_ratio));
+    });
 
-#ifdef __linux__
+    return this->ooo_ratio;
+}
 
-    {
-        struct perf_event_attr attr;
-        memset(&attr, 0, sizeof(attr));
+static picojson::value timer_calibration_to_jv(TimerCalibration const &tc) {
+    using namespace json;
+    std::map<std::string, picojson::value> ret;
+
+    ret["userland_timer_overhead_sec"] = to_jv(tc.userland_timer_overhead_sec);
+    ret["userland_timer_resolution_sec"] =
+        to_jv(tc.userland_timer_resolution_sec);
+    ret["userland_timer_overhead_cycles"] =
+        to_jv(tc.userland_timer_overhead_cycles);
+    ret["perf_read_overhead_cycles"] = to_jv(tc.perf_read_overhead_cycles);
+
+    std::vector<picojson::value> timers;
+    for (auto &&t : tc.timers) {
+        std::map<std::string, picojson::value> o;
+        o["name"] = to_jv(t.name);
+        o["overhead_sec"] = to_jv(t.overhead_sec);
+        o["resolution_sec"] = to_jv(t.resolution_sec);
+        o["backward_step"] = to_jv((double)t.backward_step);
+        o["cross_core_skew_sec"] = to_jv(t.cross_core_skew_sec);
+        o["skew_uncertainty_sec"] = to_jv(t.skew_uncertainty_sec);
+        timers.push_back(picojson::value(o));
+    }
+    ret["timers"] = picojson::value(timers);
+
+    return picojson::value(ret);
+}
 
+static void timer_calibration_from_jv(picojson::value const &v,
+                                      TimerCalibration *tc) {
+    using namespace json;
+
+    from_jv(v.get("userland_timer_overhead_sec"),
+            &tc->userland_timer_overhead_sec);
+    from_jv(v.get("userland_timer_resolution_sec"),
+            &tc->userland_timer_resolution_sec);
+    from_jv(v.get("userland_timer_overhead_cycles"),
+            &tc->userland_timer_overhead_cycles);
+    from_jv(v.get("perf_read_overhead_cycles"),
+            &tc->perf_read_overhead_cycles);
+
+    tc->timers.clear();
+    for (auto &&o : v.get("timers").get<picojson::value::array>()) {
+        TimerCharacteristics t;
+        double backward_step;
+
+        from_jv(o.get("name"), &t.name);
+        from_jv(o.get("overhead_sec"), &t.overhead_sec);
+        from_jv(o.get("resolution_sec"), &t.resolution_sec);
+        from_jv(o.get("backward_step"), &backward_step);
+        from_jv(o.get("cross_core_skew_sec"), &t.cross_core_skew_sec);
+        from_jv(o.get("skew_uncertainty_sec"), &t.skew_uncertainty_sec);
+        t.backward_step = (uint64_t)backward_step;
+
+        tc->timers.push_back(t);
+    }
+}
+
+TimerCalibration const &GlobalState::get_timer_calibration() const {
+    std::call_once(this->timer_once, [this]() {
+        /* the perf entry depends on availability, include it in the name */
+        const char *name = is_hw_perf_counter_available()
+                               ? "timer_calibration_perf"
+                               : "timer_calibration";
+
+        picojson::value v;
+        if (load_state(name, &v)) {
+            timer_calibration_from_jv(v, &this->timer_calibration);
+            return;
+        }
+
+        calibrate_timers(this, &this->timer_calibration);
+        store_state(name, timer_calibration_to_jv(this->timer_calibration));
+    });
+
+    return this->timer_calibration;
+}
+
+#ifdef HAVE_HW_PERF_COUNTER
+bool GlobalState::is_hw_perf_counter_available() const {
+    std::call_once(this->perf_once, [this]() { open_perf_counter(); });
+    return this->hw_perf_counter_available;
+}
+
+void GlobalState::open_perf_counter() const {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    //attr.config = 0x800000000ULL;
+    attr.exclude_kernel = 1;
+
+    this->perf_fd_cycle = perf_event_open(&attr, 0, -1, -1, 0);
+
+    if (this->perf_fd_cycle == -1) {
+        this->hw_perf_counter_available = false;
+
+        perror("perf_event_open");
+        fprintf(stderr, "note : to enable perf counter, run 'echo -1 > "
+                        "/proc/sys/kernel/perf_event_paranoid' in shell\n");
+    } else {
+        this->hw_perf_counter_available = true;
+
+        memset(&attr, 0, sizeof(attr));
         attr.type = PERF_TYPE_HARDWARE;
         attr.size = sizeof(attr);
-        attr.config = PERF_COUNT_HW_CPU_CYCLES;
-        //attr.config = 0x800000000ULL;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
         attr.exclude_kernel = 1;
 
-        this->perf_fd_cycle = perf_event_open(&attr, 0, -1, -1, 0);
+        this->perf_fd_branch = perf_event_open(&attr, 0, -1, -1, 0);
+    }
+}
+#endif
+
+/* state cache.
+ * one json object per file, valid only while "key" matches the running
+ * machine. a different cpu, kernel or a reboot discards all values. */
+
+static std::string read_first_line(const char *path) {
+    std::ifstream ifs;
+    ifs.open(path);
+    std::string line;
+    if (ifs) {
+        std::getline(ifs, line);
+    }
+    return line;
+}
 
-        if (this->perf_fd_cycle == -1) {
-            this->hw_perf_counter_available = false;
+static picojson::value state_key() {
+    std::map<std::string, picojson::value> key;
 
-            perror("perf_event_open");
-            fprintf(stderr, "note : to enable perf counter, run 'echo -1 > "
-                            "/proc/sys/kernel/perf_event_paranoid' in shell\n");
-        } else {
-            this->hw_perf_counter_available = true;
+    key["cpu"] = picojson::value(get_cpu_name());
+    key["userland_timer"] = picojson::value(userland_timer_value::name());
 
-            memset(&attr, 0, sizeof(attr));
-            attr.type = PERF_TYPE_HARDWARE;
-            attr.size = sizeof(attr);
-            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
-            attr.exclude_kernel = 1;
+#ifdef POSIX
+    {
+        struct utsname n;
+        uname(&n);
+        key["kernel"] = picojson::value(std::string(n.release) + " " +
+                                        n.version);
+    }
+#endif
+
+#ifdef __linux__
+    key["boot_id"] =
+        picojson::value(read_first_line("/proc/sys/kernel/random/boot_id"));
+#endif
+
+    return picojson::value(key);
+}
+
+std::string default_state_file() {
+    const char *name = "sys-microbenchmark.state.json";
+
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && cache[0]) {
+        return std::string(cache) + "/" + name;
+    }
+
+    const char *home = getenv("HOME");
+    if (home && home[0]) {
+        return std::string(home) + "/.cache/" + name;
+    }
+
+    return "";
+}
+
+bool GlobalState::load_state(const char *name, picojson::value *ret) const {
+    std::lock_guard<std::mutex> lock(this->state_lock);
+
+    std::call_once(this->state_once, [this]() {
+        if (this->state_file == "" || this->recalibrate) {
+            return;
+        }
 
-            this->perf_fd_branch = perf_event_open(&attr, 0, -1, -1, 0);
+        std::ifstream ifs;
+        ifs.open(this->state_file);
+        if (!ifs) {
+            return;
         }
+
+        picojson::value v;
+        std::string err = picojson::parse(v, ifs);
+        if (!err.empty() || !v.is<picojson::value::object>()) {
+            return;
+        }
+
+        auto &o = v.get<picojson::value::object>();
+        auto it = o.find("key");
+        if (it == o.end() || it->second.serialize() != state_key().serialize()) {
+            return;
+        }
+
+        this->state = o;
+    });
+
+    auto it = this->state.find(name);
+    if (it == this->state.end()) {
+        return false;
     }
 
+    *ret = it->second;
+    return true;
+}
+
+void GlobalState::store_state(const char *name,
+                              picojson::value const &v) const {
+    if (this->state_file == "") {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(this->state_lock);
+
+    this->state["key"] = state_key();
+    this->state[name] = v;
+
+#ifdef POSIX
+    {
+        /* best effort, for ~/.cache */
+        auto pos = this->state_file.rfind('/');
+        if (pos != std::string::npos && pos != 0) {
+            mkdir(this->state_file.substr(0, pos).c_str(), 0755);
+        }
+    }
 #endif
 
-#define F(B)                                                                   \
-    {                                                                          \
-        auto x = std::shared_ptr<BenchDesc>(get_##B##_desc());                 \
-        if (x && x->available(this)) {                                         \
-            this->bench_list.push_back(x);                                     \
-        }                                                                      \
-    };
-    FOR_EACH_BENCHMARK_LIST(F);
+    std::ofstream ofs;
+    ofs.open(this->state_file);
+    if (!ofs) {
+        perror(this->state_file.c_str());
+        return;
+    }
+    ofs << picojson::value(this->state);
 }
 
 std::vector<std::shared_ptr<BenchDesc>> get_all_benchmark_list() {
@@ -252,9 +489,113 @@ std::vector<std::shared_ptr<BenchDesc>> get_all_benchmark_list() {
     return ret;
 }
 
+bool glob_match(const char *pattern, const char *str) {
+    while (*pattern) {
+        if (*pattern == '*') {
+            pattern++;
+            for (const char *p = str;; p++) {
+                if (glob_match(pattern, p)) {
+                    return true;
+                }
+                if (*p == '\0') {
+                    return false;
+                }
+            }
+        }
+
+        if (*str == '\0') {
+            return false;
+        }
+
+        if (*pattern != '?' && *pattern != *str) {
+            return false;
+        }
+
+        pattern++;
+        str++;
+    }
+
+    return *str == '\0';
+}
+
+bool parse_param_value(std::string const &s, double *ret) {
+    const char *p = s.c_str();
+    char *end;
+
+    double v = strtod(p, &end);
+    if (end == p) {
+        return false;
+    }
+
+    switch (*end) {
+    case 'k':
+    case 'K':
+        v *= 1024.0;
+        end++;
+        break;
+    case 'm':
+    case 'M':
+        v *= 1024.0 * 1024.0;
+        end++;
+        break;
+    case 'g':
+    case 'G':
+        v *= 1024.0 * 1024.0 * 1024.0;
+        end++;
+        break;
+    default:
+        break;
+    }
+
+    if (*end != '\0') {
+        return false;
+    }
+
+    *ret = v;
+    return true;
+}
+
+bool apply_param_override(
+    std::vector<std::shared_ptr<BenchDesc>> const &bench_list,
+    std::string const &arg) {
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+        return false;
+    }
+
+    std::string lhs = arg.substr(0, eq);
+    size_t dot = lhs.rfind('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+
+    std::string bench = lhs.substr(0, dot);
+    std::string key = lhs.substr(dot + 1);
+
+    double v;
+    if (!parse_param_value(arg.substr(eq + 1), &v)) {
+        return false;
+    }
+
+    bool found = false;
+    for (auto &&b : bench_list) {
+        if (!glob_match(bench.c_str(), b->name.c_str())) {
+            continue;
+        }
+
+        auto it = b->params.find(key);
+        if (it != b->params.end()) {
+            it->second.value = v;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
 double GlobalState::userland_timer_delta_to_sec(uint64_t delta) const {
 #ifdef HAVE_USERLAND_CPUCOUNTER
-    return delta / this->userland_cpucounter_freq;
+    return delta / get_userland_cpucounter_freq();
 #elif defined HAVE_CLOCK_GETTIME
     return delta / 1e9;
 #elif defined USE_OSTIMER_AS_USERLAND_TIMER
@@ -269,7 +610,7 @@ GlobalState::inc_sec_userland_timer(userland_timer_value const *t0,
                                     double sec) const {
 #ifdef HAVE_USERLAND_CPUCOUNTER
     userland_timer_value t1;
-    t1.v64 = t0->v64 + (uint64_t)(sec * this->userland_cpucounter_freq);
+    t1.v64 = t0->v64 + (uint64_t)(sec * get_userland_cpucounter_freq());
     return t1;
 #elif defined HAVE_CLOCK_GETTIME
     uint64_t isec = t0->v.tv.tv_sec + (uint64_t)floor(sec);
@@ -298,15 +639,16 @@ GlobalState::inc_sec_userland_timer(userland_timer_value const *t0,
 GlobalState::~GlobalState() {
     aligned_free(this->zero_memory);
 
-    int ncpu = proc_table->get_active_cpu_count();
-
-    for (int i = 0; i < ncpu; i++) {
+    for (int i = 0; i < this->dustbox_count; i++) {
         aligned_free(this->dustbox[i]);
     }
 
     delete[] this->dustbox;
 
 #ifdef __linux__
+    /* don't open them just to close */
+    std::call_once(this->perf_once,
+                   [this]() { this->hw_perf_counter_available = false; });
     if (this->hw_perf_counter_available) {
         close(this->perf_fd_cycle);
         close(this->perf_fd_branch);
@@ -340,6 +682,29 @@ uint64_t GlobalState::get_hw_branch_miss() const {
     return val;
 }
 
+int GlobalState::open_thread_cpucycle() const {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+
+    return perf_event_open(&attr, 0, -1, -1, 0);
+}
+uint64_t GlobalState::read_thread_cpucycle(int fd) const {
+    long long val;
+    ssize_t sz = read(fd, &val, sizeof(val));
+    if (sz != sizeof(val)) {
+        perror("read");
+        exit(1);
+    }
+
+    return val;
+}
+void GlobalState::close_thread_cpucycle(int fd) const { close(fd); }
+
 #endif
 
 void warmup_thread(const GlobalState *g) {
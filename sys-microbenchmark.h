@@ -1,7 +1,9 @@
 #pragma once
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -31,10 +33,23 @@ enum class Timer { POSIX_CLOCK_GETTIME, CPU_COUNTER };
 
 struct GlobalState;
 
+struct SampleCell {
+    std::string label;
+    std::vector<double> samples;
+};
+
 struct BenchResult {
     virtual ~BenchResult() {}
     virtual picojson::value dump_json() const = 0;
     virtual void dump_human_readable(std::ostream &, int double_precision) = 0;
+
+    /* fold repeated runs (trials[0] is this) into one result, keeping
+     * per-cell samples */
+    virtual void
+    merge_trials(std::vector<std::shared_ptr<BenchResult>> const &trials) {}
+
+    /* one entry per value cell, used by statistical comparison */
+    virtual std::vector<SampleCell> get_sample_cells() const { return {}; }
 };
 
 typedef std::shared_ptr<BenchResult> result_ptr_t;
@@ -66,8 +81,25 @@ struct ComparableResult {
 static constexpr bool HIGHER_IS_BETTER = false;
 static constexpr bool LOWER_IS_BETTER = true;
 
+static constexpr const char *TAG_MEMORY = "memory";
+static constexpr const char *TAG_CPU = "cpu";
+static constexpr const char *TAG_OS = "os";
+static constexpr const char *TAG_THREADING = "threading";
+static constexpr const char *TAG_LIBC = "libc";
+
+struct BenchParam {
+    double value;
+    std::string description;
+};
+
 struct BenchDesc {
     std::string name;
+    std::vector<std::string> tags;
+
+    /* tunable sizes, durations and thread counts. overridden by
+     * "--param name.key=value" */
+    std::map<std::string, BenchParam> params;
+
     typedef result_ptr_t result_t;
     BenchDesc(std::string const &s) : name(s) {}
     virtual ~BenchDesc() {}
@@ -79,6 +111,21 @@ struct BenchDesc {
     const std::string &get_name() const { return name; }
     virtual bool lower_is_better() const = 0;
 
+    bool has_tag(std::string const &t) const {
+        for (auto &&x : tags) {
+            if (x == t) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void add_param(std::string const &key, double default_value,
+                   std::string const &description) {
+        params[key] = BenchParam{default_value, description};
+    }
+    double param(std::string const &key) const { return params.at(key).value; }
+
     virtual std::vector<ComparableResult>
     compare(std::vector<result_ptr_t> const &results, int base_index) = 0;
 };
@@ -88,6 +135,7 @@ struct BenchDesc {
     F(idiv64)                                                                  \
     F(idiv32_cycle)                                                            \
     F(idiv64_cycle)                                                            \
+    F(div_surface)                                                             \
     F(syscall)                                                                 \
     F(memory_bandwidth_1thread)                                                \
     F(memory_bandwidth_full_thread)                                            \
@@ -97,6 +145,9 @@ struct BenchDesc {
     F(memory_random_access_para)                                               \
     F(openmp)                                                                  \
     F(actual_freq)                                                             \
+    F(actual_freq_timeline)                                                    \
+    F(avx_license_transition)                                                  \
+    F(avx_license_freq)                                                        \
     F(inter_processor_communication)                                           \
     F(inter_processor_communication_yield)                                     \
     F(random_branch)                                                           \
@@ -109,12 +160,35 @@ struct BenchDesc {
     F(iter_random_branch_hit)                                                  \
     F(cos_branch_hit)                                                          \
     F(indirect_branch_hit)                                                     \
+    F(btb_capacity)                                                            \
+    F(rsb_depth)                                                               \
+    F(indirect_target)                                                         \
+    F(icache_footprint)                                                        \
+    F(icache_footprint_knee)                                                   \
     F(instructions)                                                            \
+    F(insn_table)                                                              \
     F(cpucore_pipeline)                                                        \
+    F(cpucore_port_interference)                                               \
     F(libc)                                                                    \
     F(libcxx)                                                                  \
     F(fpu_realtime)                                                            \
-    F(fpu_cycle)
+    F(fpu_cycle)                                                               \
+    F(fpu_special)                                                             \
+    F(simd_kernels)                                                            \
+    F(sort_algo)                                                               \
+    F(search_layout)                                                           \
+    F(hash_table)                                                              \
+    F(number_conv)                                                             \
+    F(number_conv_bulk)                                                        \
+    F(json_throughput)                                                         \
+    F(omp_sched)                                                               \
+    F(work_steal)                                                              \
+    F(queues)                                                                  \
+    F(queues_latency)                                                          \
+    F(fence_cost)                                                              \
+    F(smt_interference)                                                        \
+    F(llc_neighbour)                                                           \
+    F(prefetcher)
 
 #define UNDEF_ENTRY(B)
 
@@ -277,6 +351,18 @@ struct ProcessorTable;
 
 std::vector<std::shared_ptr<BenchDesc>> get_all_benchmark_list();
 
+/* shell style pattern, supports '*' and '?' */
+bool glob_match(const char *pattern, const char *str);
+
+/* accepts K/M/G suffix (1024 based) */
+bool parse_param_value(std::string const &s, double *ret);
+
+/* "bench.key=value", bench may be a glob pattern.
+ * returns false on syntax error or when no parameter matches */
+bool apply_param_override(
+    std::vector<std::shared_ptr<BenchDesc>> const &bench_list,
+    std::string const &arg);
+
 struct ProcessorInfo {
     std::string cpuid;
     std::string uarch;
@@ -315,28 +401,65 @@ struct ResultList {
     SysInfo *get_sysinfo() { return &sysinfo; }
 };
 
+/* characteristics of one clock source, see timer-calib.cpp */
+struct TimerCharacteristics {
+    std::string name;
+    double overhead_sec;   /* cost of one read */
+    double resolution_sec; /* smallest nonzero step between two reads */
+    uint64_t backward_step; /* consecutive reads that went backward */
+
+    /* max offset against processor 0 and its bound. <0 : not measured */
+    double cross_core_skew_sec;
+    double skew_uncertainty_sec;
+};
+
+struct TimerCalibration {
+    /* cost of one userland_timer_value::get() and its smallest step */
+    double userland_timer_overhead_sec;
+    double userland_timer_resolution_sec;
+
+    /* cycles spent by one timer / perf counter read, 0 if perf counter is
+     * not available */
+    double userland_timer_overhead_cycles;
+    double perf_read_overhead_cycles;
+
+    std::vector<TimerCharacteristics> timers;
+};
+
+/* GlobalState measures the machine (counter frequency, ooo ratio, timers,
+ * perf counters, topology) on first use, not at construction. Measured
+ * values are cached in state_file, keyed by cpu name, kernel and boot id, so
+ * "--help" or a single test does not pay for all of them. */
 struct GlobalState {
     std::unique_ptr<ProcessorTable> proc_table;
 
-    std::vector<std::shared_ptr<BenchDesc>> bench_list;
-    const std::vector<std::shared_ptr<BenchDesc>> *get_active_benchmark_list() const {
-        return &bench_list;
-    }
+    /* filters get_all_benchmark_list() by available() on first call */
+    const std::vector<std::shared_ptr<BenchDesc>> *
+    get_active_benchmark_list() const;
+
+    /* "" : don't use the cache. set before the first measurement */
+    std::string state_file;
+    /* ignore cached values and measure again */
+    bool recalibrate = false;
 
 #ifdef HAVE_USERLAND_CPUCOUNTER
-    double userland_cpucounter_freq;
+    double get_userland_cpucounter_freq() const;
 #endif
 
-    double ooo_ratio;
-    bool has_ooo() const { return ooo_ratio < 1.4; }
+    double get_ooo_ratio() const;
+    bool has_ooo() const { return get_ooo_ratio() < 1.4; }
+
+    TimerCalibration const &get_timer_calibration() const;
 
+    /* targets of iteration count calibration (see simple-run.h) */
+    double calib_max_timer_overhead = 0.01;
+    double calib_max_relative_error = 0.01;
+    int calib_min_batch = 5;
+
+    /* perf counters count the thread that opened them, the first call
+     * should come from the main thread */
 #ifdef HAVE_HW_PERF_COUNTER
-    int perf_fd_cycle;
-    int perf_fd_branch;
-    bool hw_perf_counter_available;
-    bool is_hw_perf_counter_available() const {
-        return hw_perf_counter_available;
-    }
+    bool is_hw_perf_counter_available() const;
 #else
     bool is_hw_perf_counter_available() const { return false; }
 #endif
@@ -350,6 +473,7 @@ struct GlobalState {
 
     uint64_t *zero_memory;
     uint64_t **dustbox;
+    int dustbox_count;
 
     uint64_t getzero() const { return *zero_memory; };
 
@@ -359,6 +483,12 @@ struct GlobalState {
     perf_counter_value_t get_hw_cpucycle() const;
     perf_counter_value_t get_hw_branch_miss() const;
     perf_counter_value_t get_hw_cache_miss() const;
+
+    /* cycle counter of the calling thread, for threads other than the one
+     * that opened the counters above. -1 on failure */
+    int open_thread_cpucycle() const;
+    perf_counter_value_t read_thread_cpucycle(int fd) const;
+    void close_thread_cpucycle(int fd) const;
 #endif
 
 #ifdef HAVE_CLOCK_GETTIME
@@ -381,10 +511,50 @@ struct GlobalState {
     uint64_t sec_to_ostimer_delta(double sec) const {
         return (uint64_t)((sec * ostimer_freq) + 0.5);
     }
+
+  private:
+    mutable std::once_flag active_list_once;
+    mutable std::vector<std::shared_ptr<BenchDesc>> bench_list;
+
+#ifdef HAVE_USERLAND_CPUCOUNTER
+    mutable std::once_flag freq_once;
+    mutable double userland_cpucounter_freq;
+#endif
+
+    mutable std::once_flag ooo_once;
+    mutable double ooo_ratio;
+
+    mutable std::once_flag timer_once;
+    mutable TimerCalibration timer_calibration;
+
+#ifdef HAVE_HW_PERF_COUNTER
+    mutable std::once_flag perf_once;
+    mutable int perf_fd_cycle;
+    mutable int perf_fd_branch;
+    mutable bool hw_perf_counter_available;
+    void open_perf_counter() const;
+#endif
+
+    mutable std::once_flag state_once;
+    mutable std::mutex state_lock;
+    mutable picojson::value::object state;
+
+    bool load_state(const char *name, picojson::value *ret) const;
+    void store_state(const char *name, picojson::value const &v) const;
 };
 
 void warmup_thread(GlobalState const *g);
 
+/* measure all clock sources */
+void calibrate_timers(GlobalState const *g, TimerCalibration *dst);
+void print_timer_calibration(TimerCalibration const &tc);
+
+/* cpu brand string */
+std::string get_cpu_name();
+
+/* $XDG_CACHE_HOME/sys-microbenchmark.state.json or ~/.cache/... */
+std::string default_state_file();
+
 std::string byte1024(size_t sz, int prec);
 
 SysInfo get_sysinfo(GlobalState const *g);
@@ -383,7 +383,10 @@ struct GetFileSize1 : public no_arg {
 typedef Table1DBenchDesc<double, std::string> parent_t;
 
 struct Syscall : public parent_t{
-    Syscall() : parent_t("syscall", LOWER_IS_BETTER) {}
+    Syscall() : parent_t("syscall", LOWER_IS_BETTER) {
+        tags = {TAG_OS};
+        add_param("duration", 0.1, "measurement time per test [sec]");
+    }
 
 #ifdef BAREMETAL
     virtual result_t run(GlobalState const *g) override {
@@ -410,7 +413,9 @@ struct Syscall : public parent_t{
 #define RUN(F)                                                                 \
     {                                                                          \
         F t;                                                                   \
-        (*result)[count++] = run_test(g, &t);                                  \
+        double err = -1;                                                       \
+        (*result)[count] = run_test(g, &t, param("duration"), &err);           \
+        result->set_error(count++, err);                                       \
     }
         FOR_EACH_TEST(RUN)
 
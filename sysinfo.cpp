@@ -28,18 +28,7 @@ EM_JS(char*, get_browser_name, (), {
 
 namespace smbm {
 
-SysInfo get_sysinfo(GlobalState const *g) {
-    SysInfo ret;
-
-    ret.ostimer = ostimer_value::name();
-    ret.userland_timer = userland_timer_value::name();
-
-    ret.perf_counter_available = g->is_hw_perf_counter_available();
-    ret.ooo_ratio = g->ooo_ratio;
-
-    std::cout << "perf_counter: "
-              << (g->is_hw_perf_counter_available() ? "yes" : "no") << '\n';
-
+std::string get_cpu_name() {
 #ifdef X86
 
 #define x_cpuid(p, eax) __get_cpuid(eax, &(p)[0], &(p)[1], &(p)[2], &(p)[3]);
@@ -52,17 +41,31 @@ SysInfo get_sysinfo(GlobalState const *g) {
     x_cpuid(data + 4 * 2, 0x80000004);
     data[12] = 0;
 
-    ret.cpuid = (char *)data;
-    puts((char *)data);
+    return (char *)data;
 
 #elif defined HAVE_CPUINFO
-    ret.cpuid = cpuinfo_get_package(0)->name;
-    printf("cpuinfo report: %s\n", ret.cpuid.c_str());
+    return cpuinfo_get_package(0)->name;
 #elif defined EMSCRIPTEN
-    ret.cpuid = "emscripten";
+    return "emscripten";
 #else
-    ret.cpuid = "unknown";
+    return "unknown";
 #endif
+}
+
+SysInfo get_sysinfo(GlobalState const *g) {
+    SysInfo ret;
+
+    ret.ostimer = ostimer_value::name();
+    ret.userland_timer = userland_timer_value::name();
+
+    ret.perf_counter_available = g->is_hw_perf_counter_available();
+    ret.ooo_ratio = g->get_ooo_ratio();
+
+    std::cout << "perf_counter: "
+              << (g->is_hw_perf_counter_available() ? "yes" : "no") << '\n';
+
+    ret.cpuid = get_cpu_name();
+    std::cout << ret.cpuid << '\n';
 
     {
         char buffer[256];
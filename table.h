@@ -1,5 +1,6 @@
 #pragma once
 #include "json.h"
+#include "stats.h"
 #include "sys-microbenchmark.h"
 #include <iomanip>
 #include <iostream>
@@ -36,6 +37,45 @@ inline void set_xlabel(CompareData &cd, const std::string &val) {
 }
 inline void set_xlabel(CompareData &cd, double val) { cd.xval = val; }
 
+inline std::string label_to_string(std::string const &l) { return l; }
+template <typename T> std::string label_to_string(T const &l) {
+    std::ostringstream oss;
+    oss << l;
+    return oss.str();
+}
+
+/* samples[cell][trial] */
+typedef std::vector<std::vector<double>> sample_list_t;
+
+template <typename T, typename TABLE_T>
+void merge_trial_values(TABLE_T *dst, std::vector<TABLE_T const *> const &trials) {
+    size_t nv = dst->v.size();
+    dst->samples.assign(nv, std::vector<double>());
+
+    for (auto t : trials) {
+        if (t->v.size() != nv) {
+            continue;
+        }
+
+        for (size_t i = 0; i < nv; i++) {
+            dst->samples[i].push_back(t->v[i]);
+        }
+    }
+
+    for (size_t i = 0; i < nv; i++) {
+        dst->v[i] = (T)median(dst->samples[i]);
+    }
+}
+
+template <typename TABLE_T>
+std::vector<double> cell_samples(TABLE_T const *t, size_t idx) {
+    if (idx < t->samples.size() && t->samples[idx].size() != 0) {
+        return t->samples[idx];
+    }
+
+    return {(double)t->v[idx]};
+}
+
 template <typename T, typename ROW_LABEL_T,
           typename COLUMN_LABEL_T = ROW_LABEL_T>
 struct Table2D : public BenchResult {
@@ -45,6 +85,7 @@ struct Table2D : public BenchResult {
     std::vector<T> v;
     std::vector<COLUMN_LABEL_T> column_label;
     std::vector<ROW_LABEL_T> row_label;
+    sample_list_t samples;
     int d1, d0;
 
     Table2D(std::string const &d1_label, std::string const &d0_label, int d1,
@@ -78,6 +119,9 @@ struct Table2D : public BenchResult {
         ret["values"] = to_jv(v);
         ret["d0"] = to_jv(d0);
         ret["d1"] = to_jv(d1);
+        if (samples.size() != 0) {
+            ret["samples"] = to_jv(samples);
+        }
 
         return picojson::value(ret);
     }
@@ -100,10 +144,40 @@ struct Table2D : public BenchResult {
         from_jv(value.get("values"), &r->v);
         from_jv(value.get("column_label"), &r->column_label);
         from_jv(value.get("row_label"), &r->row_label);
+        if (value.contains("samples")) {
+            from_jv(value.get("samples"), &r->samples);
+        }
 
         return r;
     }
 
+    void merge_trials(std::vector<result_ptr_t> const &trials) override {
+        std::vector<This_t const *> tables;
+        for (auto &&t : trials) {
+            auto p = dynamic_cast<This_t const *>(t.get());
+            if (p) {
+                tables.push_back(p);
+            }
+        }
+        merge_trial_values<T>(this, tables);
+    }
+
+    std::vector<SampleCell> get_sample_cells() const override {
+        std::vector<SampleCell> ret;
+
+        for (int ri = 0; ri < d1; ri++) {
+            for (int ci = 0; ci < d0; ci++) {
+                SampleCell c;
+                c.label = label_to_string(row_label[ri]) + " / " +
+                          label_to_string(column_label[ci]);
+                c.samples = cell_samples(this, ri * d0 + ci);
+                ret.push_back(c);
+            }
+        }
+
+        return ret;
+    }
+
     static std::optional<double> find_min_max(result_ptr_t const &r, bool min) {
         if (!r) {
             return std::nullopt;
@@ -190,6 +264,12 @@ template <typename T, typename LT> struct Table1D : public BenchResult {
     std::vector<T> v;
     std::vector<LT> row_label;
     std::string column_label;
+    sample_list_t samples;
+
+    /* uncertainty bound of v[i] in the same unit, <0 if unknown.
+     * empty when no cell has one. */
+    std::vector<double> error;
+
     int d0;
     typedef Table1D<T, LT> This_t;
 
@@ -201,6 +281,13 @@ template <typename T, typename LT> struct Table1D : public BenchResult {
     T &operator[](int idx) { return v[idx]; }
     const T &operator[](int idx) const { return v[idx]; }
 
+    void set_error(int idx, double e) {
+        if (error.size() != v.size()) {
+            error.assign(v.size(), -1.0);
+        }
+        error[idx] = e;
+    }
+
     picojson::value dump_json() const override {
         typedef picojson::value v_t;
         using namespace json;
@@ -212,6 +299,12 @@ template <typename T, typename LT> struct Table1D : public BenchResult {
         ret["row_label"] = to_jv(row_label);
         ret["values"] = to_jv(v);
         ret["d0"] = to_jv(d0);
+        if (samples.size() != 0) {
+            ret["samples"] = to_jv(samples);
+        }
+        if (error.size() != 0) {
+            ret["error"] = to_jv(error);
+        }
 
         return picojson::value(ret);
     }
@@ -231,10 +324,54 @@ template <typename T, typename LT> struct Table1D : public BenchResult {
         auto r = new Table1D(label0, d0);
         from_jv(value.get("values"), &r->v);
         from_jv(value.get("row_label"), &r->row_label);
+        if (value.contains("samples")) {
+            from_jv(value.get("samples"), &r->samples);
+        }
+        if (value.contains("error")) {
+            from_jv(value.get("error"), &r->error);
+        }
 
         return r;
     }
 
+    void merge_trials(std::vector<result_ptr_t> const &trials) override {
+        std::vector<This_t const *> tables;
+        for (auto &&t : trials) {
+            auto p = dynamic_cast<This_t const *>(t.get());
+            if (p) {
+                tables.push_back(p);
+            }
+        }
+        merge_trial_values<T>(this, tables);
+
+        /* median of per-trial bounds, the spread between trials is kept in
+         * samples */
+        if (error.size() == v.size()) {
+            for (size_t i = 0; i < v.size(); i++) {
+                std::vector<double> e;
+                for (auto t : tables) {
+                    if (t->error.size() == v.size() && t->error[i] >= 0) {
+                        e.push_back(t->error[i]);
+                    }
+                }
+                error[i] = e.size() ? median(e) : -1.0;
+            }
+        }
+    }
+
+    std::vector<SampleCell> get_sample_cells() const override {
+        std::vector<SampleCell> ret;
+
+        for (int i = 0; i < d0; i++) {
+            SampleCell c;
+            c.label = label_to_string(row_label[i]);
+            c.samples = cell_samples(this, i);
+            ret.push_back(c);
+        }
+
+        return ret;
+    }
+
     static std::optional<double> find_result(result_ptr_t const &r, const LT &label) {
         if (!r) {
             return std::nullopt;
@@ -466,6 +603,10 @@ void dump1d(std::ostream &out, Table1D<T, LT> *t, int double_precision) {
         insert_char_n(out, ' ', max_column - nchar);
         out << v;
 
+        if (i < (int)t->error.size() && t->error[i] >= 0) {
+            out << " +-" << t->error[i];
+        }
+
         out << '\n';
 
         // insert_char_n(out, '-', row_width);
@@ -0,0 +1,326 @@
+#include "sys-microbenchmark.h"
+#include "cpuset.h"
+#include "thread.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace smbm {
+
+namespace {
+
+/* a - b in sec, may be negative */
+template <typename TV, typename TO_SEC>
+double signed_delta_sec(TO_SEC const &to_sec, TV const &a, TV const &b) {
+    if (a >= b) {
+        return to_sec(a - b);
+    }
+    return -to_sec(b - a);
+}
+
+template <typename TV, typename TO_SEC>
+void measure_local(TimerCharacteristics *ret, TO_SEC const &to_sec) {
+    int nread = 1024;
+    uint64_t min_delta = -(1ULL);
+
+    for (int i = 0; i < 8; i++) {
+        auto t0 = TV::get();
+        for (int j = 0; j < nread; j++) {
+            TV::get();
+        }
+        auto t1 = TV::get();
+
+        min_delta = std::min(min_delta, t1 - t0);
+    }
+
+    ret->overhead_sec = to_sec(min_delta) / nread;
+
+    uint64_t min_step = -(1ULL);
+    for (int i = 0; i < 16; i++) {
+        auto t0 = TV::get();
+        auto t1 = t0;
+        while (!((t1 - t0) > 0)) {
+            t1 = TV::get();
+        }
+        min_step = std::min(min_step, t1 - t0);
+    }
+
+    ret->resolution_sec = to_sec(min_step);
+
+    ret->backward_step = 0;
+    auto prev = TV::get();
+    for (int i = 0; i < 65536; i++) {
+        auto cur = TV::get();
+        if (!(cur >= prev)) {
+            ret->backward_step++;
+        }
+        prev = cur;
+    }
+}
+
+#ifdef HAVE_THREAD
+
+enum { SKEW_START, SKEW_READY, SKEW_REQUEST, SKEW_REPLY, SKEW_QUIT };
+
+template <typename TV> struct SkewProbe {
+    GlobalState const *g;
+    int cpu_index;
+    atomic_int_t state;
+    TV remote;
+};
+
+template <typename TV> void *skew_remote_thread(void *ap) {
+    auto p = (SkewProbe<TV> *)ap;
+    auto &tbl = p->g->proc_table;
+
+    bind_self_to_1proc(
+        tbl, tbl->logical_index_to_processor(p->cpu_index,
+                                             PROC_ORDER_OUTER_TO_INNER),
+        false);
+
+    p->state = SKEW_READY;
+
+    while (1) {
+        int s = p->state;
+        if (s == SKEW_QUIT) {
+            break;
+        }
+        if (s == SKEW_REQUEST) {
+            p->remote = TV::get();
+            p->state = SKEW_REPLY;
+        }
+    }
+
+    return nullptr;
+}
+
+template <typename TV, typename TO_SEC> struct SkewReference {
+    GlobalState const *g;
+    TimerCharacteristics *ret;
+    TO_SEC const *to_sec;
+};
+
+/* Offset of the clock on each processor against processor 0, where this
+ * thread is bound. A request/reply round trip brackets the remote read, so
+ * the remote value should be between t0 and t1. The round trip with the
+ * smallest time gives the tightest bound (rtt/2). */
+template <typename TV, typename TO_SEC> void *skew_reference_thread(void *ap) {
+    auto ref = (SkewReference<TV, TO_SEC> *)ap;
+    auto g = ref->g;
+    auto ret = ref->ret;
+    auto const &to_sec = *ref->to_sec;
+
+    int ncpu = g->proc_table->get_active_cpu_count();
+    int nround = 256;
+
+    bind_self_to_first(g->proc_table, false);
+
+    double max_skew = 0;
+    double max_uncertainty = 0;
+
+    for (int ci = 1; ci < ncpu; ci++) {
+        SkewProbe<TV> p;
+        p.g = g;
+        p.cpu_index = ci;
+        p.state = SKEW_START;
+
+        auto t = spawn_thread(skew_remote_thread<TV>, &p);
+
+        while (p.state != SKEW_READY) {
+        }
+
+        double best_rtt = 1e30;
+        double best_offset = 0;
+
+        for (int ri = 0; ri < nround; ri++) {
+            auto t0 = TV::get();
+            p.state = SKEW_REQUEST;
+            while (p.state != SKEW_REPLY) {
+            }
+            auto t1 = TV::get();
+
+            double rtt = to_sec(t1 - t0);
+            if (rtt < best_rtt) {
+                best_rtt = rtt;
+                best_offset = signed_delta_sec(to_sec, p.remote, t0) - rtt / 2;
+            }
+        }
+
+        p.state = SKEW_QUIT;
+        wait_thread(t);
+
+        max_skew = std::max(max_skew, fabs(best_offset));
+        max_uncertainty = std::max(max_uncertainty, best_rtt / 2);
+    }
+
+    ret->cross_core_skew_sec = max_skew;
+    ret->skew_uncertainty_sec = max_uncertainty;
+
+    return nullptr;
+}
+
+template <typename TV, typename TO_SEC>
+void measure_skew(GlobalState const *g, TimerCharacteristics *ret,
+                  TO_SEC const &to_sec) {
+    ret->cross_core_skew_sec = -1;
+    ret->skew_uncertainty_sec = -1;
+
+    if (g->proc_table->get_active_cpu_count() < 2) {
+        return;
+    }
+
+    SkewReference<TV, TO_SEC> ref = {g, ret, &to_sec};
+    auto t = spawn_thread(skew_reference_thread<TV, TO_SEC>, &ref);
+    wait_thread(t);
+}
+
+#else
+
+template <typename TV, typename TO_SEC>
+void measure_skew(GlobalState const *g, TimerCharacteristics *ret,
+                  TO_SEC const &to_sec) {
+    ret->cross_core_skew_sec = -1;
+    ret->skew_uncertainty_sec = -1;
+}
+
+#endif
+
+template <typename TV, typename TO_SEC>
+TimerCharacteristics measure_clock(GlobalState const *g,
+                                   TO_SEC const &to_sec) {
+    TimerCharacteristics ret;
+    ret.name = TV::name();
+
+    measure_local<TV>(&ret, to_sec);
+    measure_skew<TV>(g, &ret, to_sec);
+
+    return ret;
+}
+
+#ifdef HAVE_HW_PERF_COUNTER
+
+/* perf counter is per thread, it has no cross core skew. its cost and the
+ * cost of the userland timer are also recorded in cycles, to be subtracted
+ * from cycle based results. */
+TimerCharacteristics measure_perf_cycle(GlobalState const *g,
+                                        TimerCalibration *tc) {
+    TimerCharacteristics ret;
+    ret.name = "perf_cycle";
+    ret.cross_core_skew_sec = -1;
+    ret.skew_uncertainty_sec = -1;
+
+    double sec_per_cycle;
+    {
+        auto t0 = userland_timer_value::get();
+        auto c0 = g->get_hw_cpucycle();
+        while (g->userland_timer_delta_to_sec(userland_timer_value::get() -
+                                              t0) < 0.01) {
+        }
+        auto c1 = g->get_hw_cpucycle();
+        auto t1 = userland_timer_value::get();
+
+        sec_per_cycle = g->userland_timer_delta_to_sec(t1 - t0) / (c1 - c0);
+    }
+
+    int nread = 1024;
+    uint64_t min_cycle = -(1ULL);
+    uint64_t min_delta = -(1ULL);
+
+    for (int i = 0; i < 8; i++) {
+        auto t0 = userland_timer_value::get();
+        auto c0 = g->get_hw_cpucycle();
+        for (int j = 0; j < nread - 1; j++) {
+            g->get_hw_cpucycle();
+        }
+        auto c1 = g->get_hw_cpucycle();
+        auto t1 = userland_timer_value::get();
+
+        min_cycle = std::min(min_cycle, c1 - c0);
+        min_delta = std::min(min_delta, t1 - t0);
+    }
+
+    tc->perf_read_overhead_cycles = (double)min_cycle / nread;
+    ret.overhead_sec = g->userland_timer_delta_to_sec(min_delta) / nread;
+
+    min_cycle = -(1ULL);
+    for (int i = 0; i < 8; i++) {
+        auto c0 = g->get_hw_cpucycle();
+        for (int j = 0; j < nread; j++) {
+            userland_timer_value::get();
+        }
+        auto c1 = g->get_hw_cpucycle();
+
+        min_cycle = std::min(min_cycle, c1 - c0);
+    }
+
+    tc->userland_timer_overhead_cycles =
+        std::max(0.0, min_cycle - tc->perf_read_overhead_cycles) / nread;
+
+    uint64_t min_step = -(1ULL);
+    ret.backward_step = 0;
+    auto prev = g->get_hw_cpucycle();
+    for (int i = 0; i < 4096; i++) {
+        auto cur = g->get_hw_cpucycle();
+        if (cur < prev) {
+            ret.backward_step++;
+        } else if (cur != prev) {
+            min_step = std::min(min_step, cur - prev);
+        }
+        prev = cur;
+    }
+
+    ret.resolution_sec = min_step * sec_per_cycle;
+
+    return ret;
+}
+
+#endif
+
+void print_timer(TimerCharacteristics const &t) {
+    printf("timer %-14s: overhead=%.2f[nsec] resolution=%.2f[nsec] "
+           "backward=%d",
+           t.name.c_str(), t.overhead_sec * 1e9, t.resolution_sec * 1e9,
+           (int)t.backward_step);
+
+    if (t.cross_core_skew_sec >= 0) {
+        printf(" skew=%.1f(+-%.1f)[nsec]", t.cross_core_skew_sec * 1e9,
+               t.skew_uncertainty_sec * 1e9);
+    }
+
+    printf("\n");
+}
+
+} // namespace
+
+void calibrate_timers(GlobalState const *g, TimerCalibration *tc) {
+    auto &list = tc->timers;
+    list.clear();
+
+    list.push_back(measure_clock<userland_timer_value>(
+        g, [g](uint64_t d) { return g->userland_timer_delta_to_sec(d); }));
+
+    tc->userland_timer_overhead_sec = list[0].overhead_sec;
+    tc->userland_timer_resolution_sec = list[0].resolution_sec;
+
+#ifndef USE_OSTIMER_AS_USERLAND_TIMER
+    list.push_back(measure_clock<ostimer_value>(
+        g, [g](uint64_t d) { return g->ostimer_delta_to_sec(d); }));
+#endif
+
+    tc->perf_read_overhead_cycles = 0;
+    tc->userland_timer_overhead_cycles = 0;
+
+#ifdef HAVE_HW_PERF_COUNTER
+    if (g->is_hw_perf_counter_available()) {
+        list.push_back(measure_perf_cycle(g, tc));
+    }
+#endif
+}
+
+void print_timer_calibration(TimerCalibration const &tc) {
+    for (auto &&t : tc.timers) {
+        print_timer(t);
+    }
+}
+
+} // namespace smbm
@@ -9,6 +9,19 @@ main()
 
     GlobalState g;
 
+    for (auto &&t : g.get_timer_calibration().timers) {
+        if (t.backward_step != 0) {
+            printf("%s is not monotonic (%d backward steps)\n", t.name.c_str(),
+                   (int)t.backward_step);
+            exit(1);
+        }
+        if (t.cross_core_skew_sec > 1e-6) {
+            printf("too large cross core skew @ %s = %e\n", t.name.c_str(),
+                   t.cross_core_skew_sec);
+            exit(1);
+        }
+    }
+
     auto t0 = userland_timer_value::get();
     sleep(1);
     auto t1 = userland_timer_value::get();
@@ -0,0 +1,518 @@
+/* Work stealing task pool vs OpenMP tasks.
+ *
+ * The pool has one Chase-Lev deque per worker (Le et al., "Correct and
+ * Efficient Work-Stealing for Weak Memory Models", PPoPP 2013). Worker i
+ * is pinned to logical processor i, the calling thread is worker 0. The
+ * owner pushes and pops at the bottom, thieves take the top of a random
+ * victim. A worker waiting for a child runs its own tasks or steals.
+ *
+ * Workloads, the same on the pool and on OpenMP:
+ *
+ * fib          : fib(fib_n), one task spawned per call with n >= 2
+ * parallel-for : `iters` iterations of `work` FP steps, split in halves
+ *                down to `grain`. OpenMP hands out `grain` sized chunks
+ *                with schedule(dynamic)
+ *
+ * Columns:
+ *
+ * time[ms]           : one run of the workload. the speedup is the time of
+ *                      the 1t row of the same scheduler over this one
+ * overhead[ns/task]  : (time * threads - serial time) / tasks, tasks are
+ *                      spawns for fib and chunks of `grain` for parallel-for
+ * steal[%task]       : successful steals per task. 0 for OpenMP, which
+ *                      does not expose it
+ */
+
+#include "cpu-feature.h"
+#include "cpuset.h"
+#include "simple-run.h"
+#include "sys-microbenchmark.h"
+#include "table.h"
+#include "thread.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace smbm {
+
+namespace {
+
+struct Worker;
+struct Task;
+typedef void (*task_fn_t)(Worker *w, Task *t);
+
+/* lives in the frame of the spawner, which syncs before returning */
+struct Task {
+    task_fn_t fn;
+    std::atomic<int> done;
+    int64_t a, b;
+    int64_t result;
+    void const *ctx;
+
+    Task(task_fn_t fn, int64_t a, int64_t b, void const *ctx)
+        : fn(fn), done(0), a(a), b(b), result(0), ctx(ctx) {}
+};
+
+/* fixed capacity, a fork-join tree only needs its depth */
+struct Deque {
+    static constexpr int64_t CAPACITY = 1 << 12;
+
+    alignas(CACHELINE_SIZE) std::atomic<int64_t> top;
+    alignas(CACHELINE_SIZE) std::atomic<int64_t> bottom;
+    std::atomic<Task *> buf[CAPACITY];
+
+    Deque() : top(0), bottom(0) {}
+
+    void push(Task *t) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t tp = top.load(std::memory_order_acquire);
+        if (b - tp >= CAPACITY) {
+            fprintf(stderr, "work-steal: deque overflow\n");
+            abort();
+        }
+        buf[b & (CAPACITY - 1)].store(t, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    Task *pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t tp = top.load(std::memory_order_relaxed);
+
+        if (tp > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task *t = buf[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (tp == b) {
+            /* the last one, race with the thieves */
+            if (!top.compare_exchange_strong(tp, tp + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                t = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    Task *steal() {
+        int64_t tp = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (tp >= b) {
+            return nullptr;
+        }
+
+        Task *t = buf[tp & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return t;
+    }
+};
+
+struct Pool;
+
+struct alignas(CACHELINE_SIZE) Worker {
+    Deque dq;
+    Pool *pool;
+    int id;
+    thread_handle_t thread;
+    std::minstd_rand rand;
+
+    /* written by the worker, read by Pool::steals() from the main thread */
+    alignas(CACHELINE_SIZE) std::atomic<uint64_t> steals{0};
+};
+
+struct Pool {
+    GlobalState const *g;
+    int nworker;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stop;
+    atomic_int_t start_barrier;
+
+    Task *try_steal(Worker *w) {
+        if (nworker == 1) {
+            return nullptr;
+        }
+        int victim = w->rand() % (nworker - 1);
+        if (victim >= w->id) {
+            victim++;
+        }
+        Task *t = workers[victim]->dq.steal();
+        if (t) {
+            w->steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    Pool(GlobalState const *g, int nworker);
+    ~Pool();
+
+    uint64_t steals() const {
+        uint64_t sum = 0;
+        for (auto &w : workers) {
+            sum += w->steals.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+};
+
+void execute(Worker *w, Task *t) {
+    t->fn(w, t);
+    t->done.store(1, std::memory_order_release);
+}
+
+void spawn(Worker *w, Task *t) { w->dq.push(t); }
+
+void sync(Worker *w, Task *t) {
+    while (!t->done.load(std::memory_order_acquire)) {
+        Task *x = w->dq.pop();
+        if (x == nullptr) {
+            x = w->pool->try_steal(w);
+        }
+        if (x) {
+            execute(w, x);
+        } else {
+            yield_thread();
+        }
+    }
+}
+
+void bind_worker(GlobalState const *g, int id) {
+    auto pi = g->proc_table->logical_index_to_processor(
+        id, PROC_ORDER_OUTER_TO_INNER);
+    bind_self_to_1proc(g->proc_table, pi, true);
+}
+
+void *worker_main(void *p) {
+    Worker *w = (Worker *)p;
+    Pool *pool = w->pool;
+
+    bind_worker(pool->g, w->id);
+    wait_barrier(&pool->start_barrier, pool->nworker);
+
+    while (!pool->stop.load(std::memory_order_relaxed)) {
+        Task *t = pool->try_steal(w);
+        if (t) {
+            execute(w, t);
+        } else {
+            yield_thread();
+        }
+    }
+
+    return nullptr;
+}
+
+Pool::Pool(GlobalState const *g, int nworker)
+    : g(g), nworker(nworker), stop(false) {
+    start_barrier = 0;
+    for (int i = 0; i < nworker; i++) {
+        workers.emplace_back(new Worker());
+        workers[i]->pool = this;
+        workers[i]->id = i;
+        workers[i]->rand.seed(i + 1);
+    }
+    for (int i = 1; i < nworker; i++) {
+        workers[i]->thread = spawn_thread(worker_main, workers[i].get());
+    }
+    bind_worker(g, 0);
+    wait_barrier(&start_barrier, nworker);
+}
+
+Pool::~Pool() {
+    stop.store(true);
+    for (int i = 1; i < nworker; i++) {
+        wait_thread(workers[i]->thread);
+    }
+    bind_self_to_first(g->proc_table, true);
+}
+
+/* fib */
+
+__attribute__((noinline)) int64_t fib_serial(int64_t n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+int64_t fib_pool(Worker *w, int64_t n);
+
+void fib_task(Worker *w, Task *t) { t->result = fib_pool(w, t->a); }
+
+int64_t fib_pool(Worker *w, int64_t n) {
+    if (n < 2) {
+        return n;
+    }
+    Task child(fib_task, n - 1, 0, nullptr);
+    spawn(w, &child);
+    int64_t r = fib_pool(w, n - 2);
+    sync(w, &child);
+    return child.result + r;
+}
+
+/* calls with n >= 2, each spawns one task */
+uint64_t fib_spawns(int64_t n) {
+    uint64_t a = 0, b = 0; /* spawns(n - 2), spawns(n - 1) */
+    for (int64_t i = 2; i <= n; i++) {
+        uint64_t c = a + b + 1;
+        a = b;
+        b = c;
+    }
+    return n < 2 ? 0 : b;
+}
+
+/* parallel for */
+
+struct ForRange {
+    int64_t grain;
+    uint32_t work;
+    double *out;
+};
+
+/* not inlined, so that every scheduler runs the same code */
+__attribute__((noinline)) void for_body(ForRange const *r, int64_t begin,
+                                        int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+        double x = (double)i;
+        for (uint32_t k = 0; k < r->work; k++) {
+            x = x * 0.999 + 1.0;
+        }
+        r->out[i] = x;
+    }
+}
+
+void for_pool(Worker *w, ForRange const *r, int64_t begin, int64_t end);
+
+void for_task(Worker *w, Task *t) {
+    for_pool(w, (ForRange const *)t->ctx, t->a, t->b);
+}
+
+void for_pool(Worker *w, ForRange const *r, int64_t begin, int64_t end) {
+    if (end - begin <= r->grain) {
+        for_body(r, begin, end);
+        return;
+    }
+    int64_t mid = begin + (end - begin) / 2;
+    Task child(for_task, mid, end, r);
+    spawn(w, &child);
+    for_pool(w, r, begin, mid);
+    sync(w, &child);
+}
+
+uint64_t for_chunks(int64_t n, int64_t grain) {
+    if (n <= grain) {
+        return 1;
+    }
+    return for_chunks(n / 2, grain) + for_chunks(n - n / 2, grain);
+}
+
+#ifdef _OPENMP
+int64_t fib_omp(int64_t n) {
+    if (n < 2) {
+        return n;
+    }
+    int64_t a, b;
+#pragma omp task shared(a)
+    a = fib_omp(n - 1);
+    b = fib_omp(n - 2);
+#pragma omp taskwait
+    return a + b;
+}
+
+int64_t fib_omp_root(int64_t n) {
+    int64_t r = 0;
+#pragma omp parallel
+#pragma omp single
+    r = fib_omp(n);
+    return r;
+}
+
+void for_omp(ForRange const *r, int64_t n) {
+    int64_t grain = r->grain;
+    int64_t nchunk = (n + grain - 1) / grain;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int64_t c = 0; c < nchunk; c++) {
+        for_body(r, c * grain, std::min(n, (c + 1) * grain));
+    }
+}
+#endif
+
+enum Column { COL_TIME, COL_OVERHEAD, COL_STEAL, COL_NUM };
+
+enum Workload { WL_FIB, WL_FOR, WL_NUM };
+const char *workload_name[] = {"fib", "parallel-for"};
+
+enum Scheduler { SC_POOL, SC_OMP, SC_NUM };
+const char *scheduler_name[] = {"pool", "omp"};
+
+typedef Table2DBenchDesc<double, std::string, std::string> parent_t;
+
+struct WorkSteal : public parent_t {
+    WorkSteal() : parent_t("work-steal", LOWER_IS_BETTER) {
+        tags = {TAG_THREADING};
+        add_param("fib_n", 25, "fib argument");
+        add_param("iters", 1 << 20, "parallel-for iterations");
+        add_param("grain", 1024, "parallel-for iterations per task");
+        add_param("work", 16, "parallel-for FP steps per iteration");
+        add_param("threads", 0, "max number of threads (0 = all)");
+        add_param("duration", 0.2, "measurement time per cell [sec]");
+    }
+
+    result_t run(GlobalState const *g) override {
+        int64_t fib_n = (int64_t)param("fib_n");
+        int64_t iters = std::max(1, (int)param("iters"));
+        double duration = param("duration");
+
+        std::vector<double> out(iters);
+        ForRange range;
+        range.grain = std::max(1, (int)param("grain"));
+        range.work = (uint32_t)param("work");
+        range.out = out.data();
+
+        int max_thread = g->proc_table->get_active_cpu_count();
+        if (param("threads") > 0) {
+            max_thread = std::min(max_thread, (int)param("threads"));
+        }
+        std::vector<int> threads;
+        for (int i = 1; i < max_thread; i *= 2) {
+            threads.push_back(i);
+        }
+        threads.push_back(max_thread);
+
+        int nsched = 1;
+#ifdef _OPENMP
+        nsched = SC_NUM;
+#endif
+
+        double serial_sec[WL_NUM];
+        uint64_t ntask[WL_NUM] = {fib_spawns(fib_n),
+                                  for_chunks(iters, range.grain)};
+
+        bind_self_to_first(g->proc_table, true);
+        serial_sec[WL_FIB] = run_calibrated(
+                                 g,
+                                 [g, fib_n](uint64_t count) {
+                                     for (uint64_t i = 0; i < count; i++) {
+                                         g->dummy_write(0, fib_serial(fib_n));
+                                     }
+                                 },
+                                 duration)
+                                 .sec_per_unit();
+        serial_sec[WL_FOR] = run_calibrated(
+                                 g,
+                                 [&range, iters](uint64_t count) {
+                                     for (uint64_t i = 0; i < count; i++) {
+                                         for_body(&range, 0, iters);
+                                     }
+                                 },
+                                 duration)
+                                 .sec_per_unit();
+
+        int nrow = WL_NUM * nsched * threads.size();
+        auto t = new table_t("workload", "measure", nrow, COL_NUM);
+        t->column_label[COL_TIME] = "time[ms]";
+        t->column_label[COL_OVERHEAD] = "overhead[ns/task]";
+        t->column_label[COL_STEAL] = "steal[%task]";
+
+        for (int sc = 0; sc < nsched; sc++) {
+            for (size_t ti = 0; ti < threads.size(); ti++) {
+                int nthread = threads[ti];
+                double sec[WL_NUM];
+                double steals[WL_NUM] = {0, 0};
+
+                if (sc == SC_POOL) {
+                    Pool pool(g, nthread);
+                    Worker *w0 = pool.workers[0].get();
+
+                    for (int wl = 0; wl < WL_NUM; wl++) {
+                        auto body = [g, w0, wl, fib_n, &range,
+                                     iters](uint64_t count) {
+                            for (uint64_t i = 0; i < count; i++) {
+                                if (wl == WL_FIB) {
+                                    g->dummy_write(0, fib_pool(w0, fib_n));
+                                } else {
+                                    for_pool(w0, &range, 0, iters);
+                                }
+                            }
+                        };
+                        /* only the steals of the measured batches */
+                        uint64_t n = calibrate_count(g, body, duration);
+                        uint64_t s0 = pool.steals();
+                        auto cr = run_batches(g, body, n, duration);
+                        sec[wl] = cr.sec_per_unit();
+                        steals[wl] = (double)(pool.steals() - s0) / cr.count;
+                    }
+                }
+#ifdef _OPENMP
+                else {
+                    bind_self_to_all(g->proc_table);
+                    int nthread0 = omp_get_max_threads();
+                    omp_set_num_threads(nthread);
+
+                    for (int wl = 0; wl < WL_NUM; wl++) {
+                        auto cr = run_calibrated(
+                            g,
+                            [g, wl, fib_n, &range, iters](uint64_t count) {
+                                for (uint64_t i = 0; i < count; i++) {
+                                    if (wl == WL_FIB) {
+                                        g->dummy_write(0, fib_omp_root(fib_n));
+                                    } else {
+                                        for_omp(&range, iters);
+                                    }
+                                }
+                            },
+                            duration);
+                        sec[wl] = cr.sec_per_unit();
+                    }
+
+                    omp_set_num_threads(nthread0);
+                    bind_self_to_first(g->proc_table, true);
+                }
+#endif
+
+                for (int wl = 0; wl < WL_NUM; wl++) {
+                    int r = (wl * nsched + sc) * threads.size() + ti;
+                    t->row_label[r] = std::string(workload_name[wl]) + " " +
+                                      scheduler_name[sc] + " " +
+                                      std::to_string(nthread) + "t";
+                    (*t)[r][COL_TIME] = sec[wl] * 1e3;
+                    (*t)[r][COL_OVERHEAD] =
+                        (sec[wl] * nthread - serial_sec[wl]) / ntask[wl] * 1e9;
+                    (*t)[r][COL_STEAL] = 100.0 * steals[wl] / ntask[wl];
+                }
+            }
+        }
+
+        g->dummy_write(0, out[0]);
+
+        return result_t(t);
+    }
+
+    int double_precision() override { return 2; }
+
+    bool available(const GlobalState *g) override { return true; }
+};
+
+} // namespace
+
+std::unique_ptr<BenchDesc> get_work_steal_desc() {
+    return std::unique_ptr<BenchDesc>(new WorkSteal());
+}
+
+} // namespace smbm
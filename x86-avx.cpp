@@ -1,5 +1,6 @@
 #include "x86funcs.h"
 #include "actual-freq.h"
+#include "simd-kernels.h"
 
 #ifdef X86
 #include <immintrin.h>
@@ -121,6 +122,210 @@ uint64_t busy_fma64x4(uint64_t zero, oneshot_timer *ot) {
     return ret[0] + ret[1] + ret[2] + ret[3];
 }
 
+/* n iterations of 8 independent vfmadd231pd ymm. acc = acc*0.5 + 0.5
+ * converges to 1, so no denormal or overflow shows up */
+__attribute__((target("fma"))) uint64_t fma64x4_block(uint64_t zero,
+                                                      uint64_t n) {
+    __m256d a = _mm256_set1_pd(0.5 + zero);
+    __m256d acc0 = _mm256_set1_pd(1.0), acc1 = acc0, acc2 = acc0,
+            acc3 = acc0, acc4 = acc0, acc5 = acc0, acc6 = acc0, acc7 = acc0;
+
+    for (uint64_t i = 0; i < n; i++) {
+        acc0 = _mm256_fmadd_pd(acc0, a, a);
+        acc1 = _mm256_fmadd_pd(acc1, a, a);
+        acc2 = _mm256_fmadd_pd(acc2, a, a);
+        acc3 = _mm256_fmadd_pd(acc3, a, a);
+        acc4 = _mm256_fmadd_pd(acc4, a, a);
+        acc5 = _mm256_fmadd_pd(acc5, a, a);
+        acc6 = _mm256_fmadd_pd(acc6, a, a);
+        acc7 = _mm256_fmadd_pd(acc7, a, a);
+    }
+
+    __m256d sum = (acc0 + acc1) + (acc2 + acc3) + (acc4 + acc5) + (acc6 + acc7);
+    return (uint64_t)(sum[0] + sum[1] + sum[2] + sum[3]);
+}
+
+#define AVX2_KERNEL __attribute__((target("avx2,fma")))
+
+namespace {
+
+/* vpermd indices for 8 lanes of 32bit. expand zeroes the unused lanes with
+ * the selector, so they can point anywhere */
+struct AVX2PermuteLUT {
+    alignas(32) int32_t compress[256][8], expand[256][8];
+    int count[256];
+
+    AVX2PermuteLUT() {
+        int lane[8];
+        for (unsigned m = 0; m < 256; m++) {
+            count[m] = simd_compress_lanes(m, 8, lane);
+            for (int j = 0; j < 8; j++) {
+                compress[m][j] = lane[j] & 7;
+            }
+            simd_expand_lanes(m, 8, lane);
+            for (int j = 0; j < 8; j++) {
+                expand[m][j] = lane[j] & 7;
+            }
+        }
+    }
+};
+
+AVX2PermuteLUT const &avx2_permute_lut() {
+    static AVX2PermuteLUT lut;
+    return lut;
+}
+
+AVX2_KERNEL uint64_t dot_avx2(SimdKernelArg const *a) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    float const *fa = a->fa, *fb = a->fb;
+
+    for (size_t i = 0; i < a->n; i += 32) {
+        s0 = _mm256_fmadd_ps(_mm256_load_ps(fa + i + 0),
+                             _mm256_load_ps(fb + i + 0), s0);
+        s1 = _mm256_fmadd_ps(_mm256_load_ps(fa + i + 8),
+                             _mm256_load_ps(fb + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_load_ps(fa + i + 16),
+                             _mm256_load_ps(fb + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_load_ps(fa + i + 24),
+                             _mm256_load_ps(fb + i + 24), s3);
+    }
+
+    __m256 s = (s0 + s1) + (s2 + s3);
+    return (uint64_t)((s[0] + s[1]) + (s[2] + s[3]) + (s[4] + s[5]) +
+                      (s[6] + s[7]));
+}
+
+/* sum is kept in 64bit lanes like gather_c */
+AVX2_KERNEL uint64_t gather_avx2(SimdKernelArg const *a) {
+    __m256i s0 = _mm256_setzero_si256(), s1 = s0;
+    int const *base = (int const *)a->ia;
+
+    for (size_t i = 0; i < a->n; i += 8) {
+        __m256i idx = _mm256_load_si256((__m256i const *)(a->idx + i));
+        __m256i v = _mm256_i32gather_epi32(base, idx, 4);
+        s0 = _mm256_add_epi64(
+            s0, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+        s1 = _mm256_add_epi64(
+            s1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+
+    __m256i s = _mm256_add_epi64(s0, s1);
+    return _mm256_extract_epi64(s, 0) + _mm256_extract_epi64(s, 1) +
+           _mm256_extract_epi64(s, 2) + _mm256_extract_epi64(s, 3);
+}
+
+AVX2_KERNEL uint64_t permute_avx2(SimdKernelArg const *a) {
+    __m256i const *src = (__m256i const *)a->ia;
+    __m256i *dst = (__m256i *)a->ib;
+    __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    for (size_t i = 0; i < a->n / 8; i++) {
+        dst[i] = _mm256_permutevar8x32_epi32(src[i], rev);
+    }
+    return a->ib[0];
+}
+
+AVX2_KERNEL inline int select_mask_avx2(__m256i v) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(v, 31)));
+}
+
+AVX2_KERNEL uint64_t compress_avx2(SimdKernelArg const *a) {
+    auto const &lut = avx2_permute_lut();
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 8) {
+        __m256i v = _mm256_load_si256((__m256i const *)(a->ia + i));
+        int m = select_mask_avx2(v);
+        __m256i p = _mm256_load_si256((__m256i const *)lut.compress[m]);
+        _mm256_storeu_si256((__m256i *)(a->ib + k),
+                            _mm256_permutevar8x32_epi32(v, p));
+        k += lut.count[m];
+    }
+    return k;
+}
+
+AVX2_KERNEL uint64_t expand_avx2(SimdKernelArg const *a) {
+    auto const &lut = avx2_permute_lut();
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 8) {
+        __m256i sel = _mm256_load_si256((__m256i const *)(a->ia + i));
+        int m = select_mask_avx2(sel);
+        __m256i p = _mm256_load_si256((__m256i const *)lut.expand[m]);
+        __m256i v = _mm256_loadu_si256((__m256i const *)(a->ia + k));
+        __m256i keep = _mm256_srai_epi32(_mm256_slli_epi32(sel, 31), 31);
+        _mm256_store_si256(
+            (__m256i *)(a->ib + i),
+            _mm256_and_si256(_mm256_permutevar8x32_epi32(v, p), keep));
+        k += lut.count[m];
+    }
+    return k;
+}
+
+/* popcount of each byte with a vpshufb nibble table (W. Mula) */
+AVX2_KERNEL inline __m256i popcount8_avx2(__m256i v) {
+    __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                     3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                     2, 3, 2, 3, 3, 4);
+    __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, low);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+                           _mm256_shuffle_epi8(table, hi));
+}
+
+AVX2_KERNEL uint64_t popcount_avx2(SimdKernelArg const *a) {
+    __m256i const *src = (__m256i const *)a->words;
+    __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+
+    for (size_t i = 0; i < a->n / 8; i += 4) {
+        __m256i c =
+            _mm256_add_epi8(_mm256_add_epi8(popcount8_avx2(src[i + 0]),
+                                            popcount8_avx2(src[i + 1])),
+                            _mm256_add_epi8(popcount8_avx2(src[i + 2]),
+                                            popcount8_avx2(src[i + 3])));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(c, zero));
+    }
+
+    return _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+           _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+}
+
+/* scan in each 128bit lane, then add the low lane total to the high lane */
+AVX2_KERNEL uint64_t prefix_sum_avx2(SimdKernelArg const *a) {
+    __m256i const *src = (__m256i const *)a->ia;
+    __m256i *dst = (__m256i *)a->ib;
+    __m256i zero = _mm256_setzero_si256();
+    __m256i lane3 = _mm256_set1_epi32(3), lane7 = _mm256_set1_epi32(7);
+    __m256i carry = zero;
+
+    for (size_t i = 0; i < a->n / 8; i++) {
+        __m256i x = src[i];
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        __m256i low = _mm256_permutevar8x32_epi32(x, lane3);
+        x = _mm256_add_epi32(x, _mm256_blend_epi32(zero, low, 0xf0));
+        x = _mm256_add_epi32(x, carry);
+        dst[i] = x;
+        carry = _mm256_permutevar8x32_epi32(x, lane7);
+    }
+    return a->ib[a->n - 1];
+}
+
+} // namespace
+
+/* AVX2 has gather but no scatter */
+void simd_kernels_avx2(simd_kernel_t *tbl) {
+    tbl[SK_DOT] = dot_avx2;
+    tbl[SK_GATHER] = gather_avx2;
+    tbl[SK_PERMUTE] = permute_avx2;
+    tbl[SK_COMPRESS] = compress_avx2;
+    tbl[SK_EXPAND] = expand_avx2;
+    tbl[SK_POPCOUNT] = popcount_avx2;
+    tbl[SK_PREFIX_SUM] = prefix_sum_avx2;
+}
+
 }
 
 #endif
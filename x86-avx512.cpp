@@ -1,5 +1,6 @@
 #include "x86funcs.h"
 #include "actual-freq.h"
+#include "simd-kernels.h"
 
 #ifdef X86
 
@@ -122,6 +123,163 @@ uint64_t busy_fma64x8(uint64_t zero, oneshot_timer *ot) {
     return ret[0] + ret[1] + ret[2] + ret[3];
 }
 
+/* 512bit version of fma64x4_block */
+uint64_t fma64x8_block(uint64_t zero, uint64_t n) {
+    __m512d a = _mm512_set1_pd(0.5 + zero);
+    __m512d acc0 = _mm512_set1_pd(1.0), acc1 = acc0, acc2 = acc0,
+            acc3 = acc0, acc4 = acc0, acc5 = acc0, acc6 = acc0, acc7 = acc0;
+
+    for (uint64_t i = 0; i < n; i++) {
+        acc0 = _mm512_fmadd_pd(acc0, a, a);
+        acc1 = _mm512_fmadd_pd(acc1, a, a);
+        acc2 = _mm512_fmadd_pd(acc2, a, a);
+        acc3 = _mm512_fmadd_pd(acc3, a, a);
+        acc4 = _mm512_fmadd_pd(acc4, a, a);
+        acc5 = _mm512_fmadd_pd(acc5, a, a);
+        acc6 = _mm512_fmadd_pd(acc6, a, a);
+        acc7 = _mm512_fmadd_pd(acc7, a, a);
+    }
+
+    __m512d sum = (acc0 + acc1) + (acc2 + acc3) + (acc4 + acc5) + (acc6 + acc7);
+    return (uint64_t)_mm512_reduce_add_pd(sum);
+}
+
+namespace {
+
+uint64_t dot_avx512(SimdKernelArg const *a) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    float const *fa = a->fa, *fb = a->fb;
+
+    for (size_t i = 0; i < a->n; i += 64) {
+        s0 = _mm512_fmadd_ps(_mm512_load_ps(fa + i + 0),
+                             _mm512_load_ps(fb + i + 0), s0);
+        s1 = _mm512_fmadd_ps(_mm512_load_ps(fa + i + 16),
+                             _mm512_load_ps(fb + i + 16), s1);
+        s2 = _mm512_fmadd_ps(_mm512_load_ps(fa + i + 32),
+                             _mm512_load_ps(fb + i + 32), s2);
+        s3 = _mm512_fmadd_ps(_mm512_load_ps(fa + i + 48),
+                             _mm512_load_ps(fb + i + 48), s3);
+    }
+
+    return (uint64_t)_mm512_reduce_add_ps((s0 + s1) + (s2 + s3));
+}
+
+uint64_t gather_avx512(SimdKernelArg const *a) {
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0;
+
+    for (size_t i = 0; i < a->n; i += 16) {
+        __m512i idx = _mm512_load_si512(a->idx + i);
+        __m512i v = _mm512_i32gather_epi32(idx, a->ia, 4);
+        s0 = _mm512_add_epi64(
+            s0, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(v)));
+        s1 = _mm512_add_epi64(
+            s1, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+    }
+
+    return _mm512_reduce_add_epi64(_mm512_add_epi64(s0, s1));
+}
+
+uint64_t scatter_avx512(SimdKernelArg const *a) {
+    for (size_t i = 0; i < a->n; i += 16) {
+        __m512i idx = _mm512_load_si512(a->idx + i);
+        __m512i v = _mm512_load_si512(a->ia + i);
+        _mm512_i32scatter_epi32(a->ib, idx, v, 4);
+    }
+    return a->ib[0];
+}
+
+uint64_t permute_avx512(SimdKernelArg const *a) {
+    __m512i const *src = (__m512i const *)a->ia;
+    __m512i *dst = (__m512i *)a->ib;
+    __m512i rev = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4,
+                                    3, 2, 1, 0);
+
+    for (size_t i = 0; i < a->n / 16; i++) {
+        dst[i] = _mm512_permutexvar_epi32(rev, src[i]);
+    }
+    return a->ib[0];
+}
+
+__attribute__((target("popcnt"))) uint64_t compress_avx512(
+    SimdKernelArg const *a) {
+    __m512i one = _mm512_set1_epi32(1);
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 16) {
+        __m512i v = _mm512_load_si512(a->ia + i);
+        __mmask16 m = _mm512_test_epi32_mask(v, one);
+        _mm512_mask_compressstoreu_epi32(a->ib + k, m, v);
+        k += _mm_popcnt_u32(m);
+    }
+    return k;
+}
+
+__attribute__((target("popcnt"))) uint64_t expand_avx512(
+    SimdKernelArg const *a) {
+    __m512i one = _mm512_set1_epi32(1);
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 16) {
+        __m512i sel = _mm512_load_si512(a->ia + i);
+        __mmask16 m = _mm512_test_epi32_mask(sel, one);
+        _mm512_store_si512(a->ib + i,
+                           _mm512_maskz_expandloadu_epi32(m, a->ia + k));
+        k += _mm_popcnt_u32(m);
+    }
+    return k;
+}
+
+/* only used when cpu-feature reports avx512vpopcntdq */
+__attribute__((target("avx512vpopcntdq"))) uint64_t popcount_avx512(
+    SimdKernelArg const *a) {
+    __m512i const *src = (__m512i const *)a->words;
+    __m512i s0 = _mm512_setzero_si512(), s1 = s0, s2 = s0, s3 = s0;
+
+    for (size_t i = 0; i < a->n / 16; i += 4) {
+        s0 = _mm512_add_epi64(s0, _mm512_popcnt_epi64(src[i + 0]));
+        s1 = _mm512_add_epi64(s1, _mm512_popcnt_epi64(src[i + 1]));
+        s2 = _mm512_add_epi64(s2, _mm512_popcnt_epi64(src[i + 2]));
+        s3 = _mm512_add_epi64(s3, _mm512_popcnt_epi64(src[i + 3]));
+    }
+
+    return _mm512_reduce_add_epi64(
+        _mm512_add_epi64(_mm512_add_epi64(s0, s1), _mm512_add_epi64(s2, s3)));
+}
+
+/* valignd with zero shifts the vector up by s lanes */
+uint64_t prefix_sum_avx512(SimdKernelArg const *a) {
+    __m512i const *src = (__m512i const *)a->ia;
+    __m512i *dst = (__m512i *)a->ib;
+    __m512i zero = _mm512_setzero_si512();
+    __m512i last = _mm512_set1_epi32(15);
+    __m512i carry = zero;
+
+    for (size_t i = 0; i < a->n / 16; i++) {
+        __m512i x = src[i];
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 15));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 14));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 12));
+        x = _mm512_add_epi32(x, _mm512_alignr_epi32(x, zero, 8));
+        x = _mm512_add_epi32(x, carry);
+        dst[i] = x;
+        carry = _mm512_permutexvar_epi32(last, x);
+    }
+    return a->ib[a->n - 1];
+}
+
+} // namespace
+
+void simd_kernels_avx512(simd_kernel_t *tbl) {
+    tbl[SK_DOT] = dot_avx512;
+    tbl[SK_GATHER] = gather_avx512;
+    tbl[SK_SCATTER] = scatter_avx512;
+    tbl[SK_PERMUTE] = permute_avx512;
+    tbl[SK_COMPRESS] = compress_avx512;
+    tbl[SK_EXPAND] = expand_avx512;
+    tbl[SK_POPCOUNT] = popcount_avx512;
+    tbl[SK_PREFIX_SUM] = prefix_sum_avx512;
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "x86funcs.h"
 #include "memory-bandwidth.h"
 #include "cpu-feature.h"
+#include "simd-kernels.h"
 
 #ifdef X86
 #include <immintrin.h>
@@ -155,6 +156,155 @@ MemFuncs get_fastest_memfunc(GlobalState const *g) {
     return ret;
 }
 
+#define SSE_KERNEL __attribute__((target("ssse3,sse4.1")))
+
+namespace {
+
+/* pshufb controls for 4 lanes of 32bit. 0x80 zeroes the byte */
+struct SSEShuffleLUT {
+    __m128i compress[16], expand[16];
+    int count[16];
+
+    static __m128i to_bytes(int const *lane) {
+        alignas(16) uint8_t b[16];
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 4; k++) {
+                b[j * 4 + k] = (lane[j] < 0) ? 0x80 : lane[j] * 4 + k;
+            }
+        }
+        return _mm_load_si128((__m128i *)b);
+    }
+
+    SSEShuffleLUT() {
+        int lane[4];
+        for (unsigned m = 0; m < 16; m++) {
+            count[m] = simd_compress_lanes(m, 4, lane);
+            compress[m] = to_bytes(lane);
+            simd_expand_lanes(m, 4, lane);
+            expand[m] = to_bytes(lane);
+        }
+    }
+};
+
+SSEShuffleLUT const &sse_shuffle_lut() {
+    static SSEShuffleLUT lut;
+    return lut;
+}
+
+SSE_KERNEL uint64_t dot_sse(SimdKernelArg const *a) {
+    __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    float const *fa = a->fa, *fb = a->fb;
+
+    for (size_t i = 0; i < a->n; i += 16) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_load_ps(fa + i + 0),
+                                       _mm_load_ps(fb + i + 0)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_load_ps(fa + i + 4),
+                                       _mm_load_ps(fb + i + 4)));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_load_ps(fa + i + 8),
+                                       _mm_load_ps(fb + i + 8)));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_load_ps(fa + i + 12),
+                                       _mm_load_ps(fb + i + 12)));
+    }
+
+    __m128 s = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+    return (uint64_t)(s[0] + s[1] + s[2] + s[3]);
+}
+
+SSE_KERNEL uint64_t permute_sse(SimdKernelArg const *a) {
+    __m128i const *src = (__m128i const *)a->ia;
+    __m128i *dst = (__m128i *)a->ib;
+
+    for (size_t i = 0; i < a->n / 4; i++) {
+        dst[i] = _mm_shuffle_epi32(src[i], 0x1b);
+    }
+    return a->ib[0];
+}
+
+SSE_KERNEL uint64_t compress_sse(SimdKernelArg const *a) {
+    auto const &lut = sse_shuffle_lut();
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 4) {
+        __m128i v = _mm_load_si128((__m128i const *)(a->ia + i));
+        int m = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(v, 31)));
+        _mm_storeu_si128((__m128i *)(a->ib + k),
+                         _mm_shuffle_epi8(v, lut.compress[m]));
+        k += lut.count[m];
+    }
+    return k;
+}
+
+SSE_KERNEL uint64_t expand_sse(SimdKernelArg const *a) {
+    auto const &lut = sse_shuffle_lut();
+    size_t k = 0;
+
+    for (size_t i = 0; i < a->n; i += 4) {
+        __m128i sel = _mm_load_si128((__m128i const *)(a->ia + i));
+        int m = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(sel, 31)));
+        __m128i v = _mm_loadu_si128((__m128i const *)(a->ia + k));
+        _mm_store_si128((__m128i *)(a->ib + i),
+                        _mm_shuffle_epi8(v, lut.expand[m]));
+        k += lut.count[m];
+    }
+    return k;
+}
+
+/* popcount of each byte with a pshufb nibble table */
+SSE_KERNEL inline __m128i popcount8_sse(__m128i v) {
+    __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3,
+                                  3, 4);
+    __m128i low = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_and_si128(v, low);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+    return _mm_add_epi8(_mm_shuffle_epi8(table, lo),
+                        _mm_shuffle_epi8(table, hi));
+}
+
+/* 4 vectors are summed in bytes before psadbw */
+SSE_KERNEL uint64_t popcount_sse(SimdKernelArg const *a) {
+    __m128i const *src = (__m128i const *)a->words;
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+
+    for (size_t i = 0; i < a->n / 4; i += 4) {
+        __m128i c = _mm_add_epi8(_mm_add_epi8(popcount8_sse(src[i + 0]),
+                                              popcount8_sse(src[i + 1])),
+                                 _mm_add_epi8(popcount8_sse(src[i + 2]),
+                                              popcount8_sse(src[i + 3])));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(c, zero));
+    }
+
+    return _mm_extract_epi64(acc, 0) + _mm_extract_epi64(acc, 1);
+}
+
+SSE_KERNEL uint64_t prefix_sum_sse(SimdKernelArg const *a) {
+    __m128i const *src = (__m128i const *)a->ia;
+    __m128i *dst = (__m128i *)a->ib;
+    __m128i carry = _mm_setzero_si128();
+
+    for (size_t i = 0; i < a->n / 4; i++) {
+        __m128i x = src[i];
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        dst[i] = x;
+        carry = _mm_shuffle_epi32(x, 0xff);
+    }
+    return a->ib[a->n - 1];
+}
+
+} // namespace
+
+/* no gather/scatter in SSE */
+void simd_kernels_sse(simd_kernel_t *tbl) {
+    tbl[SK_DOT] = dot_sse;
+    tbl[SK_PERMUTE] = permute_sse;
+    tbl[SK_COMPRESS] = compress_sse;
+    tbl[SK_EXPAND] = expand_sse;
+    tbl[SK_POPCOUNT] = popcount_sse;
+    tbl[SK_PREFIX_SUM] = prefix_sum_sse;
+}
+
 }
 
 
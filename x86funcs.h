@@ -45,6 +45,9 @@ extern uint64_t busy_fadd64x8(uint64_t zero, oneshot_timer *ot);
 extern uint64_t busy_fmul64x8(uint64_t zero, oneshot_timer *ot);
 extern uint64_t busy_fma64x8(uint64_t zero, oneshot_timer *ot);
 
+extern uint64_t fma64x4_block(uint64_t zero, uint64_t n);
+extern uint64_t fma64x8_block(uint64_t zero, uint64_t n);
+
 #endif
 
 
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdint.h>
+
+namespace smbm {
+
+/* Zipf (s = 1) distributed ranks in [0, n). rank 0 is the most frequent.
+ * uses the inverse of the continuous approximation of the CDF, so it needs
+ * no table and works for any n. */
+struct ZipfGenerator {
+    uint64_t n;
+    double log_n1;
+
+    ZipfGenerator(uint64_t n) : n(n), log_n1(log((double)n + 1)) {}
+
+    template <typename RNG> uint64_t operator()(RNG &rand) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rand);
+        uint64_t k = (uint64_t)exp(u * log_n1) - 1;
+        return std::min(k, n - 1);
+    }
+};
+
+/* spreads ranks over [0, n), so that the hot ranks are not adjacent */
+inline uint64_t scatter_rank(uint64_t rank, uint64_t n) {
+    return (rank * 0x9e3779b97f4a7c15ULL) % n;
+}
+
+} // namespace smbm